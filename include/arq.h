@@ -0,0 +1,124 @@
+/**
+ * arq.h - 链路层选择重传 ARQ（滑动窗口）
+ *
+ * 开启后数据帧的载荷以 ARQ 头开头（类型字段带 FRAME_ARQ，见 common.h），后面总是子包序列（同聚合帧）：
+ *   [序号 1][窗口起点 1][确认号 1][确认有效位 1 比特 + SACK 位图 15 比特，大端]
+ *   序号        本帧的 8 位序号；只有 ARQ 头、没有子包的纯确认帧不占序号（此字段无意义）
+ *   窗口起点    发送端最早的未完成序号：之前的帧都已被确认或放弃重传，接收端据此跳过放弃的帧、发现对端重启
+ *   确认号      本端下一个期望收到的对端序号（之前的全部收到）
+ *   SACK 位图   第 i 位（最低位为 0）为 1 表示确认号 + 1 + i 已收到；确认有效位为 0 时（还没收到过对端的帧）整段忽略
+ * 确认搭在反方向的数据帧上；没有数据要发时稍等 ARQ_ACK_DELAY_MS 再发纯确认帧。
+ * 发送端保存封装好（已压缩）、纠错编码之前的帧，判定丢失后按当时的纠错方式重新编码再发，
+ * 速率自适应（ratectl.h）在两次发送之间换了档也不影响：
+ *   - SACK 显示比它晚发出的帧已经收到（中间有洞），立即重发，只需一个链路往返；
+ *     多声道时只和同一声道上的帧比先后：各声道的解调线程进度不同，另一声道上晚放完的帧可能先被收到；
+ *   - 超时：从调制线程放完这一帧起计时，RTO 按往返时间估计（RFC 6298，重传的帧不取样），超时后加倍。
+ * 重传 ARQ_MAX_RETRIES 次仍未确认就放弃，窗口起点越过它，接收端见到新的窗口起点后不再等这一帧。
+ * 接收端按序交付：乱序到达的帧先放进重排缓冲，缺的帧补上后一起交出，TCP 看不到乱序也就不会误触发快速重传。
+ * 一个 arq_t 同时是本端的发送窗口与接收窗口；内部加锁，封装线程、调制线程与 RX 线程可同时调用。
+ */
+
+#ifndef ARQ_H
+#define ARQ_H
+
+#include "common.h"
+#include <stdint.h>
+
+/** 发送 / 接收窗口（帧数）：不超过 SACK 位数加 1，也远小于 8 位序号空间的一半 */
+#define ARQ_WINDOW        16
+
+/** SACK 位图的位数 */
+#define ARQ_SACK_BITS     15
+
+/** 一个 IP 包能走 ARQ 帧的最大长度（ARQ 头与 2 字节子长度之后仍在 MAX_FRAME_PAYLOAD 以内）；更长的包按普通帧发，不重传 */
+#define ARQ_MAX_PACKET    (MAX_FRAME_PAYLOAD - ARQ_HDR_BYTES - 2)
+
+/** 一帧最多重传次数 */
+#define ARQ_MAX_RETRIES   6
+
+/** RTO 初值与上下限 (ms)：1200 bps 下一个 200 字节的帧就要 1.3 s，确认还可能排在对端正在发的一帧之后 */
+#define ARQ_RTO_INIT_MS   4000
+#define ARQ_RTO_MIN_MS    1000
+#define ARQ_RTO_MAX_MS    30000
+
+/** 收到数据帧后等这么久 (ms) 还没有数据帧可搭载确认，就发纯确认帧 */
+#define ARQ_ACK_DELAY_MS  50
+
+typedef struct arq arq_t;
+
+/** arq_tx_poll 的结果 */
+typedef enum {
+    ARQ_POLL_NONE,        /* 没有要发的 */
+    ARQ_POLL_RETRANSMIT,  /* frame_out 里是要重发的帧（纠错编码前） */
+    ARQ_POLL_ACK          /* hdr_out 里是纯确认帧的 ARQ 头 */
+} arq_poll_t;
+
+/** 计数（自创建累计），srtt_ms / rto_ms 为当前值 */
+typedef struct {
+    unsigned long tx_frames;     /* 新发的数据帧 */
+    unsigned long tx_acks;       /* 纯确认帧 */
+    unsigned long rtx_sack;      /* 按 SACK 判定丢失而重发 */
+    unsigned long rtx_timeout;   /* 超时重发 */
+    unsigned long gave_up;       /* 重传次数用完而放弃 */
+    unsigned long rx_frames;     /* 收到的新数据帧 */
+    unsigned long rx_dup;        /* 重复（已收过）的数据帧 */
+    unsigned long rx_reordered;  /* 先进重排缓冲、等前面的帧补齐才交付的帧 */
+    unsigned long rx_skipped;    /* 对端放弃、本端不再等的帧 */
+    double srtt_ms;
+    double rto_ms;
+} arq_stats_t;
+
+/**
+ * 创建：初始序号随机，对端重启后新旧序号不易混淆
+ * @return 失败返回 NULL
+ */
+arq_t *arq_create(void);
+
+void arq_destroy(arq_t *a);
+
+/** 发送窗口还能放新数据帧时返回 1 */
+int arq_tx_window_open(arq_t *a);
+
+/**
+ * 为下一个数据帧填 ARQ 头（序号、窗口起点、当前的确认号与 SACK），搭载了确认就不必再发纯确认帧
+ * 序号要等 arq_tx_commit 才算用掉；两次调用之间只能由同一个线程发新帧
+ */
+void arq_tx_prepare(arq_t *a, uint8_t hdr[ARQ_HDR_BYTES]);
+
+/**
+ * 新数据帧已封装好：用掉 arq_tx_prepare 给的序号，保存帧供重传
+ * @param frame protocol_encapsulate_arq 的输出（纠错编码前），不超过 MAX_FRAME_LEN 字节
+ * @return      该帧的序号，窗口已满或参数非法返回 -1
+ */
+int arq_tx_commit(arq_t *a, const uint8_t *frame, int len);
+
+/**
+ * 调制线程放完序号为 seq 的帧（新帧或重发）后调用，超时从此刻计时
+ * @param lane 放这一帧的声道（0 ~ AUDIO_MAX_CHANNELS-1），SACK 丢失判定只在同一声道的帧之间进行
+ */
+void arq_tx_sent(arq_t *a, int seq, int lane, int64_t now_ns);
+
+/**
+ * 取下一件要发的事：先是判定丢失 / 超时的重发（序号小的先），其次是到期的纯确认帧
+ * @param frame_out 至少 MAX_FRAME_LEN 字节；ARQ_POLL_RETRANSMIT 时写入纠错编码前的帧，*len 为字节数、*seq 为序号
+ * @param hdr_out   ARQ_POLL_ACK 时写入纯确认帧的 ARQ 头
+ */
+arq_poll_t arq_tx_poll(arq_t *a, int64_t now_ns, uint8_t *frame_out, int *len, int *seq,
+                       uint8_t hdr_out[ARQ_HDR_BYTES]);
+
+/**
+ * 处理收到的一个 ARQ 帧：对端的确认推进本端发送窗口，窗口起点推进接收窗口，数据帧放进重排缓冲
+ * @param body 解封装后的整帧载荷（ARQ 头 + 子包序列），见 protocol_rx_next_link
+ * @return     0；ARQ 头不完整返回 -1
+ */
+int arq_rx_frame(arq_t *a, const uint8_t *body, int len, int64_t now_ns);
+
+/**
+ * 取下一个可按序交付的数据帧的子包序列（不含 ARQ 头），用 protocol_aggregate_next 拆包
+ * @return 字节数；没有可交付的返回 0
+ */
+int arq_rx_next(arq_t *a, uint8_t *out, int max_out);
+
+void arq_get_stats(arq_t *a, arq_stats_t *st);
+
+#endif /* ARQ_H */
@@ -1,45 +1,126 @@
 /**
- * audio_dev.h - 声卡设备接口（基于 PortAudio）
+ * audio_dev.h - 声卡设备接口（可插拔后端）
  *
  * 负责初始化声卡、写入采样到扬声器、从麦克风读取采样。
- * 采样率为 common.h 中的 SAMPLE_RATE，数据类型为 sample_t (float)。
+ * 采样率与声道数由打开时的 phy_config_t 给出（默认为 common.h 中的 SAMPLE_RATE、单声道），数据类型为 sample_t (float)。
+ * 多声道时读写的单位是"帧"（一个时刻各声道各一个采样），缓冲区按声道交错排列：L0 R0 L1 R1 ...
+ *
+ * 读写经后端函数表转发，内置三种后端，由 audio_open 的描述串选择：
+ *   "portaudio[:参数]"   默认声卡（编译时需 HAVE_PORTAUDIO），回调模式，与 TX / RX 线程之间各隔一个无锁环；
+ *                        参数为逗号分隔的 frames=每次回调采样数（0 由 PortAudio 决定）、ring=发送环采样数、
+ *                        latency=建议设备延迟 ms，调小可降低延迟，例如 "portaudio:frames=256,ring=2048"
+ *   "loopback"           进程内回环：写入的采样原样被同一句柄读回（无锁单生产者单消费者环），
+ *                        不按实时节拍，用于在无声卡的机器上跑满 TX→RX 全链路
+ *   "loopback:信道描述"   同上，写入的采样先经 channel.h 的信道模拟（噪声、回波、ppm 等，见 channel_config_parse）
+ *   "fifo:收路径,发路径"  裸 float32 采样（多声道时交错）走一对命名管道（不存在时创建）
+ *   "unix:路径"          裸 float32 采样（多声道时交错）走 UNIX 流套接字（先尝试连接，没有对端则监听并等待连接）
+ * 两个 ipo_sound 用交叉的一对 FIFO 或同一个套接字路径即可在一台机器上互联。
  */
 
 #ifndef AUDIO_DEV_H
 #define AUDIO_DEV_H
 
 #include "common.h"
+#include "phy_config.h"
 
-/** 音频设备句柄，内部为 PortAudio 流指针，对外不透明 */
+/** 音频设备句柄，内部为后端函数表 + 后端私有状态，对外不透明 */
 typedef void* audio_handle_t;
 
+/** 实时后端的断流 / 丢采样计数（自打开起累计） */
+typedef struct {
+    unsigned long underruns;        /* 播放断流：发送环在播放途中被取空（或声卡报告输出欠载）的次数 */
+    unsigned long overruns;         /* 录音溢出：接收环满、新采样被丢弃（或声卡报告输入溢出）的次数 */
+    unsigned long dropped_samples;  /* 因接收环满丢弃的采样数（多声道时为帧数） */
+} audio_stats_t;
+
+/**
+ * 音频后端函数表：open 返回后端私有状态，其余函数的第一个参数即该状态
+ * read / write / close 的语义同 audio_read / audio_write / audio_cleanup，nframes 为帧数、缓冲区按声道交错
+ */
+typedef struct audio_backend {
+    const char *name;                                        /* 描述串中冒号前的名字 */
+    void *(*open)(const char *arg, int sample_rate, int channels);  /* arg 为冒号后的部分，没有时为 "" */
+    int  (*write)(void *ctx, const sample_t *buf, int nframes);
+    int  (*read)(void *ctx, sample_t *buf, int nframes);
+    void (*close)(void *ctx);
+    int  (*stats)(void *ctx, audio_stats_t *st);             /* 可为 NULL：后端不会断流 / 丢采样 */
+} audio_backend_t;
+
+/** 内置后端（audio_dev.c / audio_loopback.c / audio_stream.c） */
+#ifdef HAVE_PORTAUDIO
+extern const audio_backend_t audio_backend_portaudio;
+#endif
+extern const audio_backend_t audio_backend_loopback;
+extern const audio_backend_t audio_backend_fifo;
+extern const audio_backend_t audio_backend_unix;
+
+/** audio_init 使用的默认描述串 */
+#ifdef HAVE_PORTAUDIO
+#define AUDIO_DEFAULT_SPEC  "portaudio"
+#else
+#define AUDIO_DEFAULT_SPEC  "loopback"
+#endif
+
+/**
+ * 初始化音频：打开默认后端（有 PortAudio 时为默认输入/输出设备，按 cfg 的采样率、声道数和 AUDIO_FRAMES_PER_BUFFER 配置）
+ * @param cfg 物理层配置（只用采样率与声道数），NULL 为默认配置
+ * @return    成功返回句柄，失败返回 NULL
+ */
+audio_handle_t audio_init(const phy_config_t *cfg);
+
+/**
+ * 按描述串打开音频后端
+ * @param spec "名字" 或 "名字:参数"，见文件头；NULL 等同 AUDIO_DEFAULT_SPEC
+ * @param cfg  物理层配置（只用采样率与声道数：声卡按它们打开，回环信道按采样率换算 ms），NULL 为默认配置
+ * @return     成功返回句柄，名字未知或后端打开失败返回 NULL
+ */
+audio_handle_t audio_open(const char *spec, const phy_config_t *cfg);
+
+/**
+ * 用指定的函数表打开音频（内置以外的后端）
+ * @param backend 后端函数表，须在句柄关闭前一直有效
+ * @param arg     传给 backend->open 的参数
+ * @param cfg     其采样率与声道数传给 backend->open，NULL 为默认配置
+ * @return        成功返回句柄，失败返回 NULL
+ */
+audio_handle_t audio_open_backend(const audio_backend_t *backend, const char *arg, const phy_config_t *cfg);
+
 /**
- * 初始化音频：打开默认输入/输出设备，按 SAMPLE_RATE 和 AUDIO_FRAMES_PER_BUFFER 配置
- * @return 成功返回句柄，失败返回 NULL
+ * 句柄所用后端的名字
  */
-audio_handle_t audio_init(void);  
-/** 初始化音频设备，打开默认输入/输出设备，按 SAMPLE_RATE 和 AUDIO_FRAMES_PER_BUFFER 配置
-/**这个audio_init函数定义在audio_dev.c文件中，函数返回一个audio_handle_t类型的句柄，用于后续的音频操作。*/
+const char *audio_backend_name(audio_handle_t h);
 
 /**
- * 向扬声器写入一帧采样（播放）
+ * 句柄的声道数（打开时 phy_config_t 的 channels）
+ */
+int audio_channels(audio_handle_t h);
+
+/**
+ * 向扬声器写入一块采样（播放）
  * @param h      audio_init 返回的句柄
- * @param buf    采样数据，长度为 nframes
- * @param nframes 本帧采样数
+ * @param buf    采样数据，nframes × 声道数个，按声道交错
+ * @param nframes 帧数（单声道时即采样数）
  * @return       0 成功，非 0 失败
  */
 int audio_write(audio_handle_t h, const sample_t *buf, int nframes);
 /**这个const sample_t *buf表示输入的采样数据，int nframes表示本帧采样数，const是常量指针，表示buf指向的内存地址不能被修改。*/
 
 /**
- * 从麦克风读取一帧采样（录音）
+ * 从麦克风读取一块采样（录音）
+ * 在一段时间内等不到 nframes 帧时返回已有的部分（可能为 0，总是整帧），以便调用线程检查退出标志
  * @param h      audio_init 返回的句柄
- * @param buf    输出缓冲区，至少 nframes 个 sample_t
- * @param nframes 要读取的采样数
- * @return       实际读取的采样数，失败返回 <0
+ * @param buf    输出缓冲区，至少 nframes × 声道数个 sample_t，按声道交错
+ * @param nframes 要读取的帧数
+ * @return       实际读取的帧数，失败返回 <0
  */
 int audio_read(audio_handle_t h, sample_t *buf, int nframes);
 
+/**
+ * 读取断流 / 丢采样计数
+ * @return 0 成功；后端不统计（回环、管道、套接字不会丢采样）时返回 -1，st 清零
+ */
+int audio_get_stats(audio_handle_t h, audio_stats_t *st);
+
 /**
  * 关闭音频设备并释放资源
  * @param h audio_init 返回的句柄
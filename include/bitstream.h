@@ -0,0 +1,58 @@
+/**
+ * bitstream.h - 比特流读写与拷贝（全项目统一的比特布局）
+ *
+ * 比特流按字节存放，每字节 8 比特，高位先发：第 i 个比特是 buf[i / 8] 的第 (7 - i % 8) 位。
+ * 这正是帧字节在内存里的原样，所以“帧转比特”不需要任何拷贝，帧缓冲区直接当比特流用。
+ * 批量读写与拷贝按 64 位字进行（大端装载 + 移位拼接），起止位置字节对齐时直接 memmove。
+ */
+
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 取第 pos 个比特
+ * @return 0 或 1
+ */
+static inline int bs_get_bit(const uint8_t *buf, size_t pos)
+{
+    return (buf[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+/**
+ * 写第 pos 个比特，其余比特不变
+ * @param bit 非 0 写 1，0 写 0
+ */
+static inline void bs_put_bit(uint8_t *buf, size_t pos, int bit)
+{
+    uint8_t mask = (uint8_t)(0x80 >> (pos & 7));
+    if (bit)
+        buf[pos >> 3] |= mask;
+    else
+        buf[pos >> 3] &= (uint8_t)~mask;
+}
+
+/**
+ * 从 pos 起读 n 个比特，先读到的在高位
+ * 只访问这 n 个比特所在的字节，不会越过比特流末尾
+ * @param n 0 ~ 64
+ * @return  右对齐的比特值
+ */
+uint64_t bs_read(const uint8_t *buf, size_t pos, int n);
+
+/**
+ * 把 val 的低 n 位写到 pos 起的 n 个比特（高位先写），范围外的比特不变
+ * @param n 0 ~ 64
+ */
+void bs_write(uint8_t *buf, size_t pos, uint64_t val, int n);
+
+/**
+ * 比特拷贝：src 的 [src_pos, src_pos + nbits) → dst 的 [dst_pos, dst_pos + nbits)，dst 范围外的比特不变
+ * 两个起点在字节内的偏移相同时走 memmove（含首尾不满一字节的掩码），否则按 64 位字移位拼接。
+ * 同一缓冲区内 dst_pos <= src_pos（向前搬移，如删除开头的比特）时允许重叠。
+ */
+void bs_copy(uint8_t *dst, size_t dst_pos, const uint8_t *src, size_t src_pos, size_t nbits);
+
+#endif /* BITSTREAM_H */
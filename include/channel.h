@@ -0,0 +1,93 @@
+/**
+ * channel.h - 声学信道模拟：放在调制器输出与解调器输入之间
+ *
+ * 流式处理，按以下顺序作用于每块采样：
+ *   多径回波（直达声 + 若干延迟衰减的回波）→ 增益斜坡 → 突发掉线（信号置零）
+ *   → 高斯白噪声 → 限幅 → 收发采样率偏差（ppm，加窗 sinc 多相重采样）
+ * 噪声与掉线由句柄自带的随机数产生，同一配置同一种子、同样的输入分块，输出逐比特相同。
+ * 所有参数默认关闭；全部关闭时输出与输入完全相同。
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "common.h"
+#include <stdint.h>
+
+/** 多径回波最多条数 */
+#define CHANNEL_MAX_ECHOES  8
+
+/** 回波最大延迟 (ms) */
+#define CHANNEL_MAX_ECHO_MS 500.0
+
+typedef struct {
+    uint64_t seed;             /* 随机数种子（噪声、掉线） */
+    int    sample_rate;        /* 采样率 (Hz)，把 ms / s 换算成采样数，默认 SAMPLE_RATE */
+
+    int    awgn;               /* 非 0 时加噪声 */
+    double snr_db;             /* 相对 signal_power 的信噪比 (dB)，按 0..SAMPLE_RATE/2 全带宽计 */
+    double signal_power;       /* 信噪比的参考功率；<= 0 时用已输入的非静音采样的平均功率（开头全静音时不加噪声） */
+
+    int    num_echoes;
+    double echo_delay_ms[CHANNEL_MAX_ECHOES];  /* 回波相对直达声的延迟 (ms)，按采样取整 */
+    float  echo_gain[CHANNEL_MAX_ECHOES];      /* 回波相对直达声的幅度，可为负 */
+
+    double ppm;                /* 采样率偏差：> 0 表示接收端时钟偏慢，输出采样比输入少 ppm 百万分之一 */
+
+    double gain_start_db;      /* 增益 (dB) */
+    double gain_end_db;        /* gain_ramp_sec > 0 时在 start 与 end 之间按 dB 线性往返 */
+    double gain_ramp_sec;      /* 单程时长 (s)，0 表示恒为 gain_start_db */
+
+    float  clip_level;         /* 限幅电平（绝对幅度），<= 0 不限幅 */
+
+    double dropout_per_sec;    /* 平均每秒掉线次数（泊松），0 不掉线 */
+    double dropout_ms;         /* 每次掉线时长 (ms) */
+} channel_config_t;
+
+typedef struct channel channel_t;
+
+/**
+ * 理想信道：全部损伤关闭，种子为 1，采样率 SAMPLE_RATE
+ */
+void channel_config_default(channel_config_t *cfg);
+
+/**
+ * 解析描述串并叠加到 cfg 上（先调用 channel_config_default）
+ * 逗号分隔的 键=值：
+ *   snr=DB  power=P  echo=MS:GAIN（可多次）  ppm=X  gain=DB[:END_DB:RAMP_S]
+ *   clip=LEVEL  drop=PER_SEC:MS  seed=N
+ * 例："snr=15,echo=3:0.5,echo=11:-0.25,ppm=150,drop=0.2:40"
+ * @return 成功 0，键未知或值非法返回 -1
+ */
+int channel_config_parse(channel_config_t *cfg, const char *spec);
+
+/**
+ * 创建信道
+ * @return 参数非法或分配失败返回 NULL
+ */
+channel_t *channel_create(const channel_config_t *cfg);
+
+/**
+ * 输入 n 个采样时 channel_process 最多输出的采样数（有 ppm 偏差时与 n 不同）
+ */
+int channel_max_output(const channel_t *ch, int n);
+
+/**
+ * 处理一段采样，回波、重采样等状态跨调用保持
+ * 有 ppm 偏差时输出比输入晚 CHANNEL_RESAMPLE_DELAY 个采样（重采样滤波器的群延迟）
+ * @param out 输出缓冲区，至少 channel_max_output(ch, n) 个采样，不能与 in 重叠
+ * @return    写入 out 的采样数
+ */
+int channel_process(channel_t *ch, const sample_t *in, int n, sample_t *out);
+
+/**
+ * 清空回波与重采样的历史、回到时间 0，随机数回到种子
+ */
+void channel_reset(channel_t *ch);
+
+void channel_destroy(channel_t *ch);
+
+/** 重采样滤波器的群延迟（采样） */
+#define CHANNEL_RESAMPLE_DELAY  16
+
+#endif /* CHANNEL_H */
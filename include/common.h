@@ -15,6 +15,10 @@
 /** 每次从声卡读/写的采样帧大小，影响延迟与 CPU 占用 */
 #define AUDIO_FRAMES_PER_BUFFER  1024   /** 表示每次从声卡读/写的采样帧大小为1024次 */
 
+/** 最多声道数：多声道时每个声道各跑一路独立的调制解调与帧流（见 phy_config.h 的 channels），
+ *  声卡读写的采样按声道交错排列 */
+#define AUDIO_MAX_CHANNELS       2
+
 /** 音频采样数据类型：每个采样为 [-1.0, 1.0] 的浮点数 */
 typedef float sample_t;
 
@@ -30,9 +34,49 @@ typedef float sample_t;
 /** 每秒发送的比特数 (bps)，影响每比特对应的采样点数 */
 #define FSK_BAUD_RATE      1200  /** 表示每秒发送1200个比特 ，每个比特的持续时间为1/1200秒*/
 
-/** 每比特对应的采样点数 = SAMPLE_RATE / FSK_BAUD_RATE */
+/**
+ * 每比特对应的采样点数一般不是整数（44100/1200 = 36.75），调制/解调内部用分数定时累加器，
+ * 比特 n 的起点为 floor(n * SAMPLE_RATE / FSK_BAUD_RATE)，长期无漂移，任意波特率都可用。
+ */
+/** 每比特精确采样数（浮点） */
+#define SAMPLES_PER_BIT_F  ((double)SAMPLE_RATE / FSK_BAUD_RATE)
+
+/** 每比特整数采样数（向下取整），即解调判决窗口长度 */
 #define SAMPLES_PER_BIT    (SAMPLE_RATE / FSK_BAUD_RATE)
 
+/** 每比特最多采样数（向上取整），分配调制输出缓冲区时按 nbits * SAMPLES_PER_BIT_MAX 计算 */
+#define SAMPLES_PER_BIT_MAX  ((SAMPLE_RATE + FSK_BAUD_RATE - 1) / FSK_BAUD_RATE)
+
+/** MSK/GMSK 模式的中心频率 (Hz)：两音为中心 ± FSK_BAUD_RATE/4；DBPSK/DQPSK 也用它作单载波频率 */
+#define MSK_CENTER_FREQ    ((FSK_FREQ_0 + FSK_FREQ_1) / 2)
+
+/** GMSK 高斯滤波器的带宽-比特周期积 BT，越小频谱越窄、码间干扰越大 */
+#define GMSK_BT            0.5
+
+/* ========== 多音调制参数 (MFSK / OFDM，物理层) ========== */
+/**
+ * 扬声器到麦克风大约能通过 300 Hz ~ 16 kHz，二进制 FSK 只用了其中一小段。
+ * MFSK 每个符号发 16 或 32 个音中的一个（4 / 5 比特）；OFDM 同时在很多子载波上各发 1 / 2 比特。
+ * 两者的子载波都落在 FFT 的整数频点上，接收端一次 FFT 即得到全部子载波。
+ */
+/** MFSK 符号长度（采样）= FFT 长度，音间距 SAMPLE_RATE / MFSK_FFT_SIZE ≈ 344.5 Hz */
+#define MFSK_FFT_SIZE      128
+
+/** MFSK 最低音所在 FFT 频点（4 → 约 1378 Hz），32 音时最高约 12 kHz */
+#define MFSK_FIRST_BIN     4
+
+/** OFDM FFT 长度（采样），子载波间距 SAMPLE_RATE / OFDM_FFT_SIZE ≈ 86.1 Hz */
+#define OFDM_FFT_SIZE      512
+
+/** OFDM 循环前缀长度（采样，约 1.45 ms），吸收房间回声并用于接收端符号同步 */
+#define OFDM_CP_LEN        64
+
+/** OFDM 第一个子载波所在 FFT 频点（4 → 约 345 Hz） */
+#define OFDM_FIRST_BIN     4
+
+/** OFDM 子载波数，频点 OFDM_FIRST_BIN ~ OFDM_FIRST_BIN + 179，约 345 Hz ~ 15.8 kHz */
+#define OFDM_NUM_CARRIERS  180
+
 /* ========== 协议/帧参数 (链路层) ========== */
 /**这边帧指的是封装后的数据帧，包括同步字、长度、载荷、CRC。 在声波链路上传输时，把“一块要传的数据”包成的一个带格式的单元。*/
 /** 最大一帧的载荷长度（即单个 IP 包最大字节数），与 TUN MTU 一致 */
@@ -51,17 +95,90 @@ IP 包：网络层概念，内核/TUN 给你的就是“一个 IP 包”。
 /** 同步字节取值（0x7E 为 HDLC 常用，避免与常见数据冲突） */
 #define SYNC_BYTE          0x7E  /** 表示同步字节取值为0x7E*/
 
+/** 接收端组帧器找同步时容许的错误比特数（汉明距离），噪声翻转同步字中的一个比特时仍能锁定；
+ *  假同步由长度检查和 CRC 剔除 */
+#define SYNC_MAX_ERRORS    1
+
 /** 长度字段占用字节数 */
 #define LEN_FIELD_BYTES    2  /** 表示长度字段占用2字节，足够表示1500字节的载荷长度*/
 
 /** CRC 校验占用字节数 (CRC-16) */
 #define CRC_BYTES          2
 
-/** 帧头总长度：同步字 + 长度 = SYNC_LEN + LEN_FIELD_BYTES */
-#define FRAME_HEADER_LEN   (SYNC_LEN + LEN_FIELD_BYTES)
+/** 长帧的 CRC 校验占用字节数 (CRC-32C) */
+#define CRC32C_BYTES       4
+
+/** 载荷不少于该字节数的帧改用 CRC-32C 校验：帧越长出错越多，CRC-16 漏检概率 2^-16 不够用。
+ *  收发双方由长度字段推出用哪种 CRC；设为 MAX_FRAME_PAYLOAD + 1 即全部用 CRC-16 */
+#define CRC32C_MIN_PAYLOAD 256
+
+/** 载荷 len 字节的帧尾 CRC 字节数 */
+#define FRAME_CRC_BYTES(len) ((len) >= CRC32C_MIN_PAYLOAD ? CRC32C_BYTES : CRC_BYTES)
+
+/**
+ * 帧类型字段字节数：长度字段之后 1 字节，放 FRAME_AGGREGATE 等标志，长度字段只放载荷字节数。
+ * 标志若占长度字段的高位，每多一个标志，随机比特里长度「合法」的比例就翻一倍
+ */
+#define TYPE_FIELD_BYTES   1
+
+/**
+ * 帧头校验字节数：长度与类型字段之后跟 1 字节 CRC-8（多项式 0x07）。
+ * 同步字只有 SYNC_LEN 字节且容许 SYNC_MAX_ERRORS 个错比特，随机比特常被当成同步字；
+ * 没有这个校验时只能靠「长度合法」把关，假同步会让组帧器空等一段并不存在的载荷
+ */
+#define HDR_CHECK_BYTES    1
+
+/** 同步字之后、载荷之前的帧头字段：长度 + 类型 + 帧头校验 */
+#define HDR_FIELD_BYTES    (LEN_FIELD_BYTES + TYPE_FIELD_BYTES + HDR_CHECK_BYTES)
+
+/** 帧头总长度：同步字 + 长度 + 类型 + 帧头校验 = SYNC_LEN + HDR_FIELD_BYTES */
+#define FRAME_HEADER_LEN   (SYNC_LEN + HDR_FIELD_BYTES)
 
 /** 一帧最大字节数（头 + 载荷 + CRC） */
-#define MAX_FRAME_LEN      (FRAME_HEADER_LEN + MAX_FRAME_PAYLOAD + CRC_BYTES)
+#define MAX_FRAME_LEN      (FRAME_HEADER_LEN + MAX_FRAME_PAYLOAD + FRAME_CRC_BYTES(MAX_FRAME_PAYLOAD))
+
+/**
+ * 聚合帧：类型字段最高位置 1 时，载荷是多个 IP 包依次排列，每个包前有子长度字段
+ * （包长 < AGG_SHORT_LEN 时 1 字节，否则 2 字节大端且首字节最高位为 1），一帧只付一次同步 + 帧头 + CRC。
+ * 长度字段仍是载荷总字节数，不超过 MAX_FRAME_PAYLOAD
+ */
+#define FRAME_AGGREGATE    0x80
+
+/**
+ * 压缩帧：类型字段次高位置 1 时，载荷是 lz_compress 的输出（见 lzcomp.h），长度字段为压缩后字节数；
+ * 接收端校验 CRC 后先解压，再按 FRAME_AGGREGATE 拆包。只有压缩后变短的帧才这样发
+ */
+#define FRAME_COMPRESSED   0x40
+
+/**
+ * ARQ 帧：类型字段第三高位置 1 时，载荷（解压后）以 ARQ_HDR_BYTES 字节的 ARQ 头开头（序号与确认，见 arq.h），
+ * 后面是子包序列（格式同聚合帧，只有一个包也带子长度）；只有 ARQ 头的是纯确认帧
+ */
+#define FRAME_ARQ          0x20
+
+/** ARQ 头字节数 */
+#define ARQ_HDR_BYTES      5
+
+/**
+ * 控制帧：类型字段第四高位置 1 时，载荷是链路控制消息（首字节为消息类型，见 ratectl.h），
+ * 不含 IP 包、不压缩、不走 ARQ；不认识的接收端直接丢弃
+ */
+#define FRAME_CONTROL      0x10
+
+/** 类型字段中已定义的标志位，其余位发送端总置 0，接收端见到非 0 即当作假同步 */
+#define FRAME_TYPE_MASK    (FRAME_AGGREGATE | FRAME_COMPRESSED | FRAME_ARQ | FRAME_CONTROL)
+
+/** 子长度字段用 1 字节表示的包长上限（不含） */
+#define AGG_SHORT_LEN      0x80
+
+/** 聚合帧中一个 len 字节的包（子长度 + 包）占用的载荷字节数 */
+#define AGG_ENTRY_BYTES(len) (((len) < AGG_SHORT_LEN ? 1 : 2) + (len))
+
+/** TX 聚合的大小上限：载荷（含子长度）累计到这么多字节就发；单个包更大时单独成帧 */
+#define TX_AGGREGATE_MAX_BYTES  512
+
+/** TX 聚合的时间上限 (ms)：从一帧的第一个包起最多再等这么久，等后续包一起发；0 只合并已在排队的包 */
+#define TX_AGGREGATE_WINDOW_MS  10
 
 /* ========== TUN 设备 ========== */
 /** 默认 TUN 设备名称，若 /dev/net/tun 已存在则使用 tun0 等 */
@@ -0,0 +1,158 @@
+/**
+ * fec.h - 前向纠错：RS(255,223) 外码 + K=7 码率 1/2 卷积码内码（Viterbi 译码）
+ *
+ * 位于帧封装与比特流之间，收发两端按链路配置同一种方式（FEC_NONE / FEC_RS / FEC_CONV / FEC_RS_CONV）：
+ *   RS：GF(256)（本原多项式 0x11D），每块至多 FEC_RS_K 个数据字节加 FEC_RS_PARITY 个校验字节，
+ *       每块纠 16 个错误字节；不满一块的按缩短码处理，长数据平均分成若干块；
+ *   卷积码：生成多项式 0x4F / 0x6D（即八进制 117 / 155），自由距离 10，末尾补 6 个 0 比特回到零状态，
+ *       硬判决 Viterbi 译码；加比选 (ACS) 有 SSE2 实现，运行时自动选用。
+ * 两者同时用时先 RS 后卷积（卷积码译错往往是一串，落在少数几个字节里，正好交给 RS 纠）。
+ * 交织（FEC_INTERLEAVE，只与卷积码同用）：卷积编码后的比特按行写入每行 64 比特的矩阵、按列读出，
+ *   声学信道上一串连续的错比特（关门声、咳嗽、声卡断流）解交织后彼此相隔 64 比特，Viterbi 能逐个纠正。
+ *   矩阵行数随帧长而定，不补比特，线路字节数不变；行列互换用 64x64 比特矩阵的字级转置完成。
+ * 比特均按字节高位在前（同 bitstream.h）。
+ */
+
+#ifndef FEC_H
+#define FEC_H
+
+#include "common.h"
+#include <stdint.h>
+
+/** 纠错方式（位组合） */
+#define FEC_NONE     0
+#define FEC_RS       0x1
+#define FEC_CONV     0x2
+#define FEC_RS_CONV  (FEC_RS | FEC_CONV)
+#define FEC_INTERLEAVE 0x4
+
+/** 合法的纠错方式：只含上面几位，交织须与卷积码同用 */
+#define FEC_MODE_VALID(mode) \
+    (!((mode) & ~(FEC_RS_CONV | FEC_INTERLEAVE)) && (!((mode) & FEC_INTERLEAVE) || ((mode) & FEC_CONV)))
+
+/** RS 码参数 */
+#define FEC_RS_N       255
+#define FEC_RS_K       223
+#define FEC_RS_PARITY  (FEC_RS_N - FEC_RS_K)
+
+/** 卷积码参数：约束长度、生成多项式、尾比特数 */
+#define FEC_CONV_K      7
+#define FEC_CONV_POLYA  0x4F
+#define FEC_CONV_POLYB  0x6D
+#define FEC_CONV_TAIL   (FEC_CONV_K - 1)
+
+/** n 字节分成的 RS 块数 */
+#define FEC_RS_BLOCKS(n)  (((n) + FEC_RS_K - 1) / FEC_RS_K)
+
+/** n 字节经 RS 编码后的字节数 */
+#define FEC_RS_BYTES(n)   ((n) + FEC_RS_BLOCKS(n) * FEC_RS_PARITY)
+
+/** n 字节经卷积编码后的字节数：(8n + 6 尾比特) x 2，补齐到字节 */
+#define FEC_CONV_BYTES(n) ((2 * (8 * (n) + FEC_CONV_TAIL) + 7) / 8)
+
+/** 纠错方式 mode 下 n 字节编码后的字节数 */
+#define FEC_CODED_BYTES(mode, n) \
+    ((mode) & FEC_CONV ? FEC_CONV_BYTES((mode) & FEC_RS ? FEC_RS_BYTES(n) : (n)) \
+                       : ((mode) & FEC_RS ? FEC_RS_BYTES(n) : (n)))
+
+/** 开启纠错时帧头字段（长度 + 类型 + 帧头校验）单独用卷积码保护后的字节数（先得知长度，才知道后面收多少） */
+#define FEC_HDR_BYTES  FEC_CONV_BYTES(HDR_FIELD_BYTES)
+
+/** 开启纠错时一帧在线路上的最大字节数：同步字 + 帧头字段 + 载荷与 CRC 经 RS + 卷积编码 */
+#define FEC_MAX_FRAME_LEN \
+    (SYNC_LEN + FEC_HDR_BYTES + FEC_CONV_BYTES(FEC_RS_BYTES(MAX_FRAME_PAYLOAD + CRC32C_BYTES)))
+
+/** 卷积码一次能译的最多信息比特 */
+#define FEC_CONV_MAX_BITS  (FEC_RS_BYTES(MAX_FRAME_PAYLOAD + CRC32C_BYTES) * 8)
+
+/** 交织器一次最多处理的比特（最长一帧的载荷与 CRC 经 RS + 卷积编码后） */
+#define FEC_IL_MAX_BITS  (FEC_CONV_BYTES(FEC_RS_BYTES(MAX_FRAME_PAYLOAD + CRC32C_BYTES)) * 8)
+
+/**
+ * 由名字取纠错方式：none / rs / conv / rs+conv，以及加交织的 conv+il / rs+conv+il
+ * @return 成功 0，不认识返回 -1
+ */
+int fec_mode_from_name(const char *name, int *mode);
+
+/** 纠错方式的名字 */
+const char *fec_mode_name(int mode);
+
+/**
+ * RS 编码一块：在 data 后写 FEC_RS_PARITY 个校验字节
+ * @param block 前 len 字节为数据，校验写在 block + len
+ * @param len   1 ~ FEC_RS_K
+ */
+void fec_rs_encode(uint8_t *block, int len);
+
+/**
+ * RS 译码一块（原地纠正）
+ * @param block 数据 + 校验
+ * @param len   数据字节数（1 ~ FEC_RS_K），块长 len + FEC_RS_PARITY
+ * @return      纠正的字节数，无法纠正返回 -1
+ */
+int fec_rs_decode(uint8_t *block, int len);
+
+/**
+ * 卷积编码（含尾比特）
+ * @param in    输入比特
+ * @param nbits 输入比特数
+ * @param out   输出，至少 (2 * (nbits + FEC_CONV_TAIL) + 7) / 8 字节，最后不满一字节的比特补 0
+ * @return      输出比特数 2 * (nbits + FEC_CONV_TAIL)
+ */
+int fec_conv_encode(const uint8_t *in, int nbits, uint8_t *out);
+
+/** Viterbi 译码器（保存每步判决，供回溯；一个线程用一个） */
+typedef struct fec_viterbi fec_viterbi_t;
+
+/**
+ * 创建译码器
+ * @return 失败返回 NULL
+ */
+fec_viterbi_t *fec_viterbi_create(void);
+
+void fec_viterbi_destroy(fec_viterbi_t *v);
+
+/**
+ * 硬判决 Viterbi 译码（以零状态结尾），有 SSE2 时用向量化的加比选
+ * @param in    编码比特，2 * (nbits + FEC_CONV_TAIL) 个
+ * @param nbits 信息比特数，不超过 FEC_CONV_MAX_BITS
+ * @param out   输出信息比特，(nbits + 7) / 8 字节，末尾不满一字节的比特补 0
+ * @return      成功 0，参数非法返回 -1
+ */
+int fec_viterbi_decode(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out);
+
+/**
+ * 同 fec_viterbi_decode，分别固定用逐状态的标量实现与 SIMD 实现（没有 SIMD 时退回标量），供基准对比
+ */
+int fec_viterbi_decode_scalar(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out);
+int fec_viterbi_decode_simd(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out);
+
+/**
+ * 块交织：in 的 nbits 个比特按行写入每行 64 比特的矩阵（末行可不满），按列读出到 out
+ * @param nbits 1 ~ FEC_IL_MAX_BITS
+ * @param out   (nbits + 7) / 8 字节，不能与 in 重叠；末尾不满一字节的比特不变
+ * @return      成功 0，参数非法返回 -1
+ */
+int fec_interleave(const uint8_t *in, int nbits, uint8_t *out);
+
+/** fec_interleave 的逆 */
+int fec_deinterleave(const uint8_t *in, int nbits, uint8_t *out);
+
+/**
+ * 按纠错方式编码一段字节（RS 分块 → 卷积 → 交织）
+ * @param out 至少 FEC_CODED_BYTES(mode, len) 字节，不能与 in 重叠
+ * @return    输出字节数
+ */
+int fec_encode(int mode, const uint8_t *in, int len, uint8_t *out);
+
+/**
+ * 按纠错方式译码（解交织 → 卷积 → RS 分块）
+ * @param v   卷积译码器（mode 不含 FEC_CONV 时可为 NULL）
+ * @param in  FEC_CODED_BYTES(mode, len) 字节
+ * @param len 原始字节数
+ * @param out 输出 len 字节，不能与 in 重叠
+ * @return    RS 纠正的字节数（无 RS 时为 0），有 RS 块无法纠正返回 -1
+ */
+int fec_decode(fec_viterbi_t *v, int mode, const uint8_t *in, int len, uint8_t *out);
+
+#endif /* FEC_H */
@@ -0,0 +1,41 @@
+/**
+ * fft.h - 基 2 复数 FFT（多音调制 MFSK / OFDM 使用）
+ *
+ * 实部、虚部分开存放，原地变换；旋转因子与位反转表在创建时算好，变换过程不调用 sin/cos。
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+/** FFT 计划：长度、旋转因子表、位反转表，对外不透明 */
+typedef struct fft_plan fft_plan_t;
+
+/**
+ * 创建长度为 n 的 FFT 计划
+ * @param n 变换长度，必须是 2 的幂且 >= 2
+ * @return  计划指针，失败（含 n 非法）返回 NULL
+ */
+fft_plan_t *fft_create(int n);
+
+/**
+ * 释放 FFT 计划
+ */
+void fft_destroy(fft_plan_t *plan);
+
+/**
+ * 正变换 X[k] = Σ x[n] e^{-j2πkn/N}，原地
+ * @param plan fft_create 返回的计划
+ * @param re   实部，长度 N
+ * @param im   虚部，长度 N
+ */
+void fft_forward(const fft_plan_t *plan, float *re, float *im);
+
+/**
+ * 逆变换 x[n] = Σ X[k] e^{+j2πkn/N}，原地，不除以 N
+ * @param plan fft_create 返回的计划
+ * @param re   实部，长度 N
+ * @param im   虚部，长度 N
+ */
+void fft_inverse(const fft_plan_t *plan, float *re, float *im);
+
+#endif /* FFT_H */
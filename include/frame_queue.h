@@ -0,0 +1,74 @@
+/**
+ * frame_queue.h - TX 流水线的帧描述符、有界无锁队列与描述符池
+ *
+ * TX 分成 TUN 读 → 封装 → 调制 / 写声卡 几个线程，线程之间只传递描述符指针。
+ * 描述符在启动时一次分配好放进池里，运行中不再 malloc；池空即说明下游积压，上游暂停读 TUN。
+ * 队列是按槽位序号实现的有界多生产者多消费者环（不加锁、不阻塞），池本身也是这样一个队列，
+ * 所以描述符可以从任一线程归还（例如封装失败时由封装线程直接放回池里）。
+ */
+
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include "common.h"
+#include "fec.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/** 一个待发送的包：TUN 读线程填 payload，封装线程填 frame（开启纠错时为编码后的线路帧） */
+typedef struct {
+    int     payload_len;
+    int     frame_len;
+    int     arq_seq;      /* 封装线程填：ARQ 数据帧的序号（调制线程放完后报给 arq_tx_sent），其他帧为 -1 */
+    int     rung;         /* 封装线程填：速率自适应的档（见 ratectl.h），调制线程按它换调制方式；未开启为 0 */
+    uint8_t payload[MAX_FRAME_PAYLOAD];
+    uint8_t frame[FEC_MAX_FRAME_LEN];
+} frame_desc_t;
+
+typedef struct frame_queue frame_queue_t;
+
+/**
+ * 创建队列
+ * @param min_slots 最少容量，向上取到 2 的幂
+ * @return          失败返回 NULL
+ */
+frame_queue_t *frame_queue_create(size_t min_slots);
+
+void frame_queue_destroy(frame_queue_t *q);
+
+/**
+ * 入队（不阻塞）
+ * @return 成功 0，队列满返回 -1
+ */
+int frame_queue_push(frame_queue_t *q, frame_desc_t *d);
+
+/**
+ * 出队（不阻塞）
+ * @return 队首描述符，队列空返回 NULL
+ */
+frame_desc_t *frame_queue_pop(frame_queue_t *q);
+
+/** 当前排队个数（其他线程同时读写时只是近似值） */
+size_t frame_queue_count(const frame_queue_t *q);
+
+typedef struct frame_pool frame_pool_t;
+
+/**
+ * 分配 count 个描述符并全部放进池里
+ * @return 失败返回 NULL
+ */
+frame_pool_t *frame_pool_create(int count);
+
+/** 释放池及其全部描述符（调用前须确保各线程已不再使用任何描述符） */
+void frame_pool_destroy(frame_pool_t *p);
+
+/** 取一个空闲描述符，池空返回 NULL */
+frame_desc_t *frame_pool_get(frame_pool_t *p);
+
+/** 归还描述符 */
+void frame_pool_put(frame_pool_t *p, frame_desc_t *d);
+
+/** 描述符总数（下游队列按这个容量建，入队就永远不会满） */
+int frame_pool_size(const frame_pool_t *p);
+
+#endif /* FRAME_QUEUE_H */
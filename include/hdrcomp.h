@@ -0,0 +1,103 @@
+/**
+ * hdrcomp.h - IPv4 / TCP / UDP 头压缩（仿 ROHC），位于 TUN 与帧封装之间
+ *
+ * 收发两端按流（源/目的地址、协议、端口）各保存一份上下文，上下文编号 CID 随包发送：
+ *   IR  [HDRCOMP_IR][CID][原始 IP 包]              新流、定期刷新、对端要求时发完整头，两端据此建立上下文
+ *   CO  [HDRCOMP_CO][CID][标志][CRC-8][变化字段][L4 校验和][载荷]
+ *       只发变化的字段：IP-ID（低 8 位或 2 字节原值）、TCP 序号 / 确认号 / 时间戳（低 16 位）、窗口、TCP 标志；
+ *       只发低位的字段由接收端取离上下文最近的值，中间丢几个包也能还原；
+ *       总长度与 IP 校验和由接收端算出；CRC-8 覆盖还原后的整个头，对不上即丢包
+ *   FB  [HDRCOMP_FEEDBACK][CID]                    接收端上下文缺失或 CRC 错时发给对端，对端下一个包改发 IR
+ * 其他包（IPv6、ICMP、分片、带 IP 选项）原样发送，首字节为 IP 版本号，与上面三种类型不冲突。
+ * 压缩端只在一个线程里用；hdrcomp_tx_refresh 可从其他线程调用。
+ */
+
+#ifndef HDRCOMP_H
+#define HDRCOMP_H
+
+#include <stdint.h>
+
+/** 包类型（首字节），IPv4 / IPv6 包首字节高 4 位为 4 / 6，不会与之相同 */
+#define HDRCOMP_IR        0xFD
+#define HDRCOMP_CO        0xFC
+#define HDRCOMP_FEEDBACK  0xFE
+
+/** 每个方向的上下文个数（同时压缩的流数），超出时替换最久未用的 */
+#define HDRCOMP_MAX_CONTEXTS  16
+
+/** 每隔这么多个包对同一条流重发一次 IR：没有反向链路时靠它从丢包中恢复 */
+#define HDRCOMP_REFRESH_PACKETS  64
+
+/** 接收端同一上下文每丢这么多个包再发一次反馈（前一个反馈可能也丢了） */
+#define HDRCOMP_NACK_EVERY  8
+
+/** IR 比原包多出的字节数 */
+#define HDRCOMP_IR_OVERHEAD  2
+
+/** 反馈包长度 */
+#define HDRCOMP_FEEDBACK_LEN  2
+
+typedef struct hdrcomp_tx hdrcomp_tx_t;
+typedef struct hdrcomp_rx hdrcomp_rx_t;
+
+/**
+ * 创建压缩端
+ * @return 失败返回 NULL
+ */
+hdrcomp_tx_t *hdrcomp_tx_create(void);
+
+void hdrcomp_tx_destroy(hdrcomp_tx_t *c);
+
+/**
+ * 压缩一个 IP 包
+ * @param pkt     原始 IP 包
+ * @param len     包长度
+ * @param out     输出缓冲区，不能与 pkt 重叠
+ * @param max_out 输出缓冲区大小；IR 放不下时原样输出（不建上下文）
+ * @return        输出字节数，失败（len 非法或 max_out < len）返回 -1
+ */
+int hdrcomp_compress(hdrcomp_tx_t *c, const uint8_t *pkt, int len, uint8_t *out, int max_out);
+
+/**
+ * 对端要求刷新 cid：该流下一个包改发 IR（可从其他线程调用）
+ */
+void hdrcomp_tx_refresh(hdrcomp_tx_t *c, int cid);
+
+/**
+ * 创建解压端
+ * @return 失败返回 NULL
+ */
+hdrcomp_rx_t *hdrcomp_rx_create(void);
+
+void hdrcomp_rx_destroy(hdrcomp_rx_t *d);
+
+/**
+ * 还原一个包
+ * @param in      链路上收到的包（IR / CO / 原样的 IP 包）
+ * @param out     输出缓冲区，不能与 in 重叠
+ * @param max_out 输出缓冲区大小
+ * @return        还原出的 IP 包长度；上下文缺失、CRC 错或格式非法时丢弃并返回 0
+ *                （需要对端刷新时由 hdrcomp_rx_take_nack 取出 CID）
+ */
+int hdrcomp_decompress(hdrcomp_rx_t *d, const uint8_t *in, int len, uint8_t *out, int max_out);
+
+/**
+ * 取出一个待发反馈的 CID
+ * @return CID，没有则返回 -1
+ */
+int hdrcomp_rx_take_nack(hdrcomp_rx_t *d);
+
+/**
+ * 构造反馈包
+ * @param out 至少 HDRCOMP_FEEDBACK_LEN 字节
+ * @return    包长度
+ */
+int hdrcomp_build_feedback(int cid, uint8_t *out);
+
+/**
+ * 判断收到的包是否为反馈包
+ * @return 对端要求刷新的 CID，不是反馈包返回 -1
+ */
+int hdrcomp_feedback_cid(const uint8_t *pkt, int len);
+
+#endif /* HDRCOMP_H */
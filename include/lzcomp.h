@@ -0,0 +1,45 @@
+/**
+ * lzcomp.h - 帧载荷的轻量 LZ77 压缩（LZ4 块格式 + 内置静态字典）
+ *
+ * 一帧不过几百字节，单靠帧内重复压不了多少；压缩 / 解压两端都先假想在输出前面放了同一份静态字典
+ * （HTTP 头、DNS、JSON、日志里常见的串），匹配可以引用字典，短帧也能压。
+ * 序列格式同 LZ4 块：[标记 1 字节：高 4 位字面量长度、低 4 位匹配长度 - LZ_MIN_MATCH]
+ * [字面量长度续 0xFF...][字面量][偏移 2 字节小端][匹配长度续 0xFF...]，最后一个序列只有字面量。
+ * 无状态，可在多个线程里同时调用。
+ */
+
+#ifndef LZCOMP_H
+#define LZCOMP_H
+
+#include <stdint.h>
+
+/** 最短匹配长度 */
+#define LZ_MIN_MATCH  4
+
+/** 一次压缩的输入上限（字节）：字典加输入不超过 2 字节偏移能表示的范围 */
+#define LZ_MAX_INPUT  4096
+
+/** 比这短的输入不值得压（标记与偏移的开销抵不过省下的字节） */
+#define LZ_MIN_INPUT  24
+
+/**
+ * 压缩
+ * @param src     输入
+ * @param len     输入字节数，不超过 LZ_MAX_INPUT
+ * @param dst     输出缓冲区，不能与 src 重叠
+ * @param max_out 输出缓冲区大小；通常给 len - 1，即只接受变短的结果
+ * @return        压缩后字节数；放不下 max_out（压不短）或参数非法返回 0
+ */
+int lz_compress(const uint8_t *src, int len, uint8_t *dst, int max_out);
+
+/**
+ * 解压
+ * @param src     压缩数据
+ * @param len     压缩数据字节数
+ * @param dst     输出缓冲区，不能与 src 重叠
+ * @param max_out 输出缓冲区大小
+ * @return        解压后字节数；格式非法、偏移越界或输出超过 max_out 返回 -1
+ */
+int lz_decompress(const uint8_t *src, int len, uint8_t *dst, int max_out);
+
+#endif /* LZCOMP_H */
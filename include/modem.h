@@ -19,6 +19,8 @@
 #define MODEM_H
 
 #include "common.h"
+#include "fec.h"
+#include "phy_config.h"
 #include <stdint.h>
 
 /** 调制器状态/句柄，内部保存相位等，对外不透明 */
@@ -27,22 +29,101 @@ typedef void* modem_tx_handle_t;
 /** 解调器状态/句柄，内部保存缓冲区与状态 */
 typedef void* modem_rx_handle_t;
 
+/** 调制方式，收发两端通过 modem_tx_set_mode / modem_rx_set_mode 设置为一致 */
+typedef enum {
+    MODEM_MODE_FSK   = 0, /* 两载波各自保持相位，比特跳变处相位突变（旧行为），频谱外溢大 */
+    MODEM_MODE_CPFSK = 1, /* 连续相位 FSK：单一相位累加器，只切换频率（默认），可与 FSK 互通 */
+    MODEM_MODE_MSK   = 2, /* 最小频移键控：h = 0.5，两音 MSK_CENTER_FREQ ± baud/4，带宽更窄 */
+    MODEM_MODE_GMSK  = 3, /* 高斯滤波 MSK (BT = GMSK_BT)：频率平滑过渡，旁瓣最低 */
+    MODEM_MODE_MFSK16 = 4, /* 16 音 MFSK：每符号 4 比特，非相干检测，最抗噪 */
+    MODEM_MODE_MFSK32 = 5, /* 32 音 MFSK：每符号 5 比特 */
+    MODEM_MODE_OFDM_DBPSK = 6, /* OFDM，每子载波 DBPSK（相邻符号间差分），每符号 OFDM_NUM_CARRIERS 比特 */
+    MODEM_MODE_OFDM_DQPSK = 7, /* OFDM，每子载波 DQPSK，每符号 2 * OFDM_NUM_CARRIERS 比特 */
+    MODEM_MODE_DBPSK = 8, /* 单载波差分 BPSK：载波 MSK_CENTER_FREQ，符号率 FSK_BAUD_RATE，相位翻转 π 为 1 */
+    MODEM_MODE_DQPSK = 9, /* 单载波差分 QPSK：同一符号率每符号 2 比特，带宽与 DBPSK 相同 */
+    MODEM_MODE_COUNT          /* 模式个数，不是有效模式 */
+} modem_mode_t;
+
+/** 解调算法（FSK/CPFSK 下每比特的判决方式），通过 modem_rx_set_demod 选择 */
+typedef enum {
+    MODEM_DEMOD_ZEROCROSS = 0, /* 过零计数：最简单，但宽带噪声会增加过零次数导致误判 */
+    MODEM_DEMOD_CORR      = 1  /* 正交相关能量检测（非相干，等价于 Goertzel）：默认 */
+} modem_demod_t;
+
+/**
+ * 按名字查调制方式（不区分大小写），供命令行 --mode 使用
+ * @param name 如 "cpfsk"、"gmsk"、"dqpsk"、"ofdm-dqpsk"，完整列表见 modem_mode_name
+ * @param mode 输出：对应的 MODEM_MODE_*
+ * @return     0 成功，-1 未知名字
+ */
+int modem_mode_from_name(const char *name, modem_mode_t *mode);
+
+/**
+ * 调制方式的名字（小写，与 modem_mode_from_name 互逆）
+ * @return 名字，非法值返回 "?"
+ */
+const char *modem_mode_name(modem_mode_t mode);
+
 /**
  * 创建调制器（用于发送），初始化调制器内部状态
- * @return 句柄，失败返回 NULL
+ * @param cfg 采样率、波特率与两音频率（见 phy_config.h），NULL 为默认配置；只在创建时读取
+ * @return    句柄，配置不合法（phy_config_check）或分配失败返回 NULL
+ */
+modem_tx_handle_t modem_tx_create(const phy_config_t *cfg);
+
+/**
+ * 设置调制方式，可在帧间切换
+ * @param h    modem_tx_create 返回的句柄
+ * @param mode MODEM_MODE_*
+ * @return     0 成功，-1 参数非法
  */
-modem_tx_handle_t modem_tx_create(void);
+int modem_tx_set_mode(modem_tx_handle_t h, modem_mode_t mode);
+
+/**
+ * 调制 nbits 个比特最多输出多少个采样，用于分配 modem_tx_modulate 的输出缓冲区
+ * 多符号比特的模式按整符号发送（末尾不足一个符号补 0；OFDM 与 DBPSK/DQPSK 每次调用另加一个参考符号），
+ * 可能多于 nbits * 每比特最多采样数（默认配置即 SAMPLES_PER_BIT_MAX）
+ * @param h     modem_tx_create 返回的句柄
+ * @param nbits 比特数
+ * @return      采样数上限，参数非法返回 0
+ */
+int modem_tx_max_samples(modem_tx_handle_t h, int nbits);
 
 /**
  * 将一段比特流调制为音频采样，写入 out_buf
  * @param h       modem_tx_create 返回的句柄
  * @param bits    比特数组，每个字节存 8 个比特，高位先发
  * @param nbits   比特总数
- * @param out_buf 输出采样缓冲区，需预分配足够空间 (约 nbits * SAMPLES_PER_BIT)，缓冲区的大小用采样数来表示
+ * @param out_buf 输出采样缓冲区，需预分配足够空间 (modem_tx_max_samples，默认配置的二进制模式即 nbits * SAMPLES_PER_BIT_MAX)，缓冲区的大小用采样数来表示
  * @return        实际写入的采样数
  */
 int modem_tx_modulate(modem_tx_handle_t h, const uint8_t *bits, int nbits, sample_t *out_buf);
 
+/** modem_tx_queue_bits 一次最多排队的比特数（一个最长的帧，含纠错编码） */
+#define MODEM_TX_QUEUE_BITS  (FEC_MAX_FRAME_LEN * 8)
+
+/**
+ * 流式调制：排队一段比特，之后用 modem_tx_next_samples 按需取采样
+ * 比特拷贝进句柄；一段相当于一次 modem_tx_modulate（差分模式段首有参考符号，末尾不足一符号补 0），
+ * 两者输出逐采样相同。句柄内只存这一段比特和一个符号的采样（几 KB），不需要整帧的采样缓冲区。
+ * 不要与 modem_tx_modulate 在同一句柄上交替使用；modem_tx_set_mode 丢弃排队内容。
+ * @param h     modem_tx_create 返回的句柄
+ * @param bits  比特数组，每个字节存 8 个比特，高位先发
+ * @param nbits 比特数，不超过 MODEM_TX_QUEUE_BITS
+ * @return      0 成功；上一段比特还没有全部调制完（modem_tx_next_samples 还没取到不足 n 个）或参数非法返回 -1
+ */
+int modem_tx_queue_bits(modem_tx_handle_t h, const uint8_t *bits, int nbits);
+
+/**
+ * 取接下来最多 n 个采样，只合成够用的符号（多出的半个符号留到下次）
+ * 返回值小于 n 说明排队的比特已全部输出，可以排下一段；前后两段的波形首尾相接、相位连续
+ * @param h   modem_tx_create 返回的句柄
+ * @param out 输出缓冲区，至少 n 个采样
+ * @param n   想要的采样数，通常为 AUDIO_FRAMES_PER_BUFFER
+ * @return    写入 out 的采样数，没有待发比特时为 0
+ */
+int modem_tx_next_samples(modem_tx_handle_t h, sample_t *out, int n);
+
 /**
  * 销毁调制器
  * @param h 句柄
@@ -51,12 +132,45 @@ void modem_tx_destroy(modem_tx_handle_t h);
 
 /**
  * 创建解调器（用于接收）
- * @return 句柄，失败返回 NULL
+ * 采样率、波特率、两音与某个特化内核（44100 / 48000 Hz、FSK_BAUD_RATE、FSK_FREQ_0 / FSK_FREQ_1）相同时
+ * 逐比特解调用窗口长度为常量的特化代码，否则用通用代码；cfg->force_generic 强制用通用代码，两者输出相同
+ * @param cfg 见 phy_config.h，NULL 为默认配置；只在创建时读取
+ * @return    句柄，配置不合法（phy_config_check）或分配失败返回 NULL
+ */
+modem_rx_handle_t modem_rx_create(const phy_config_t *cfg);
+
+/**
+ * 创建时是否选中了特化内核（见 modem_rx_create）
+ * @param h modem_rx_create 返回的句柄
+ * @return  1 特化内核，0 通用内核
+ */
+int modem_rx_specialized(modem_rx_handle_t h);
+
+/**
+ * 设置解调方式，须与发送端的调制方式一致；切换时清空跨块拼接的采样
+ * @param h    modem_rx_create 返回的句柄
+ * @param mode MODEM_MODE_*
+ * @return     0 成功，-1 参数非法
+ */
+int modem_rx_set_mode(modem_rx_handle_t h, modem_mode_t mode);
+
+/**
+ * 选择解调算法（仅对 FSK/CPFSK 有效），可在运行时随时切换
+ * @param h     modem_rx_create 返回的句柄
+ * @param demod MODEM_DEMOD_ZEROCROSS 或 MODEM_DEMOD_CORR
+ * @return      0 成功，-1 参数非法
  */
-modem_rx_handle_t modem_rx_create(void);
+int modem_rx_set_demod(modem_rx_handle_t h, modem_demod_t demod);
 
 /**
- * 将一段音频采样解调为比特，写入 bits 缓冲区
+ * 清空跨块拼接的剩余采样并重置比特定时（换一段不相关的音频输入时调用）
+ * @param h modem_rx_create 返回的句柄
+ */
+void modem_rx_reset(modem_rx_handle_t h);
+
+/**
+ * 将一段音频采样解调为比特（流式：可按任意长度分块喂入，
+ * 不足一比特的尾部采样保留在句柄内与下一块拼接，比特定时由早/迟门自动跟踪），写入 bits 缓冲区
  * @param h        modem_rx_create 返回的句柄
  * @param samples  输入采样
  * @param nsamples 采样数
@@ -67,6 +181,27 @@ modem_rx_handle_t modem_rx_create(void);
 int modem_rx_demodulate(modem_rx_handle_t h, const sample_t *samples, int nsamples,
                         uint8_t *bits, int max_bits);
 
+/**
+ * 解调质量（判决域），供速率自适应估计信噪比与定时抖动：
+ * 每个符号的判决量拆成信号部分与噪声部分——FSK / MFSK 为获胜音与其余音的能量差、其余音的平均能量，
+ * 差分 PSK 为差分相量在判决轴上与垂直于判决轴的分量的平方，MSK 为相位差偏离 ±π/2 的程度；
+ * 定时修正量为每符号早/迟门（OFDM 为循环前缀跟踪）挪动的采样数，以符号长度为单位
+ */
+typedef struct {
+    unsigned long symbols;   /* 计入的符号数（过零计数解调、OFDM 未同步时不计） */
+    double signal;           /* 各符号判决量的信号能量之和 */
+    double noise;            /* 各符号判决量的噪声能量之和 */
+    double timing_sq;        /* 各符号定时修正量的平方和 */
+} modem_rx_quality_t;
+
+/**
+ * 取出自上次调用（或 modem_rx_set_mode）以来的解调质量累计，并清零
+ * 不区分有无信号：静音、噪声也会被判决，调用者按组帧结果决定取舍
+ * @param h 句柄
+ * @param q 输出
+ */
+void modem_rx_take_quality(modem_rx_handle_t h, modem_rx_quality_t *q);
+
 /**
  * 销毁解调器
  * @param h 句柄
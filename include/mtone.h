@@ -0,0 +1,87 @@
+/**
+ * mtone.h - 多音调制引擎：MFSK（16/32 音）与 OFDM（子载波 DBPSK/DQPSK）
+ *
+ * 由 modem.c 在选择 MODEM_MODE_MFSK* / MODEM_MODE_OFDM_* 时调用，对外仍只暴露 modem_tx_* / modem_rx_*。
+ * 两种方式都以整符号为单位：MFSK 一个符号 MFSK_FFT_SIZE 个采样，
+ * OFDM 一个符号 OFDM_CP_LEN + OFDM_FFT_SIZE 个采样，接收端对每个符号做一次 FFT。
+ */
+
+#ifndef MTONE_H
+#define MTONE_H
+
+#include "modem.h"
+#include <stdint.h>
+
+/** 各模式中最长的一个符号（OFDM 含循环前缀）的采样数 */
+#define MTONE_MAX_SYMBOL_SAMPLES  (OFDM_CP_LEN + OFDM_FFT_SIZE)
+
+typedef struct mtone_tx mtone_tx_t;
+typedef struct mtone_rx mtone_rx_t;
+
+/**
+ * 判断调制方式是否由本引擎处理
+ * @return 1 是 MFSK / OFDM，0 否
+ */
+int mtone_is_mode(modem_mode_t mode);
+
+/**
+ * 每符号比特数
+ * @return MFSK16 为 4，MFSK32 为 5，OFDM 为 OFDM_NUM_CARRIERS 或其 2 倍；非本引擎模式返回 0
+ */
+int mtone_bits_per_symbol(modem_mode_t mode);
+
+/**
+ * 每符号采样数（OFDM 含循环前缀）
+ */
+int mtone_symbol_samples(modem_mode_t mode);
+
+/**
+ * 调制 nbits 个比特最多输出的采样数
+ */
+int mtone_tx_max_samples(modem_mode_t mode, int nbits);
+
+/**
+ * 创建发送端
+ * @param mode MODEM_MODE_MFSK16 / MFSK32 / OFDM_DBPSK / OFDM_DQPSK
+ * @return     失败或模式不属于本引擎返回 NULL
+ */
+mtone_tx_t *mtone_tx_create(modem_mode_t mode);
+
+/**
+ * 调制一个符号；一段比特依次调用 idx = -1, 0, bps, 2·bps, ...，总采样数不超过 mtone_tx_max_samples
+ * OFDM 每段先发一个参考符号作为差分起点
+ * @param bits  整段比特，nbits 为其长度，末尾不足一个符号的部分补 0
+ * @param idx   本符号首比特的下标；-1 表示段首的参考符号（OFDM 重置各子载波相位，MFSK 没有参考符号）
+ * @param out   至少 MTONE_MAX_SYMBOL_SAMPLES 个采样
+ * @return      写入 out 的采样数（MFSK 的 idx = -1 为 0）
+ */
+int mtone_tx_symbol(mtone_tx_t *tx, const uint8_t *bits, int nbits, int idx, sample_t *out);
+
+void mtone_tx_destroy(mtone_tx_t *tx);
+
+/**
+ * 创建接收端
+ * @param mode 同 mtone_tx_create
+ */
+mtone_rx_t *mtone_rx_create(modem_mode_t mode);
+
+/**
+ * 流式解调，语义同 modem_rx_demodulate：不足一个符号的采样留到下次；
+ * 剩余空间不够一个符号的比特时停止，采样留到下次
+ * OFDM 未同步（静音、噪声）时不输出比特
+ * @return 写入 bits 的比特数
+ */
+int mtone_rx_demodulate(mtone_rx_t *rx, const sample_t *samples, int nsamples,
+                        uint8_t *bits, int max_bits);
+
+/**
+ * 丢弃缓存的采样与同步状态
+ */
+void mtone_rx_reset(mtone_rx_t *rx);
+
+/** 取出并清零解调质量累计，见 modem_rx_take_quality */
+void mtone_rx_take_quality(mtone_rx_t *rx, modem_rx_quality_t *q);
+
+void mtone_rx_destroy(mtone_rx_t *rx);
+
+#endif /* MTONE_H */
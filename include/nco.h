@@ -0,0 +1,67 @@
+/**
+ * nco.h - 数控振荡器 (NCO)：相位累加器 + 正弦查表
+ *
+ * 相位用 32 位无符号整数表示一整周 (2^32 = 2π)，自然溢出即取模，长期运行无累积误差。
+ * 供调制器生成载波使用，替代逐采样调用 sin()。
+ */
+
+#ifndef NCO_H
+#define NCO_H
+
+#include "common.h"
+#include <stdint.h>
+
+/** 振荡器状态：嵌入到调制器等结构体中使用 */
+typedef struct {
+    uint32_t phase;  /* 当前相位 (2^32 = 2π) */
+    uint32_t step;   /* 每采样相位增量 */
+    float rot_c;     /* SIMD 递推用的 4 步旋转因子 cos(4·step)，双精度算出，避免查表误差累积 */
+    float rot_s;     /* sin(4·step) */
+} nco_t;
+
+/**
+ * 频率换算为每采样相位增量
+ * @param freq        频率 (Hz)，可为负
+ * @param sample_rate 采样率 (Hz)
+ * @return            相位增量 (2^32 = 一整周)
+ */
+uint32_t nco_step(double freq, int sample_rate);
+
+/**
+ * 初始化振荡器，相位从 0 开始
+ * @param nco         振荡器
+ * @param freq        频率 (Hz)
+ * @param sample_rate 采样率 (Hz)
+ */
+void nco_init(nco_t *nco, double freq, int sample_rate);
+
+/**
+ * 查表求 sin(phase)，表间线性插值
+ * @param phase 相位 (2^32 = 2π)
+ * @return      正弦值
+ */
+float nco_sin(uint32_t phase);
+
+/**
+ * 查表求 cos(phase)
+ * @param phase 相位 (2^32 = 2π)
+ * @return      余弦值
+ */
+float nco_cos(uint32_t phase);
+
+/**
+ * 生成一段正弦 out[i] = amp * sin(phase + i*step)，并把相位推进 n 个采样
+ * 内部用 4 路 SIMD 递推振荡器，一次出 4 个采样；每段起点由整数相位查表重新定标，误差不累积
+ * @param nco 振荡器，返回时相位已推进
+ * @param amp 振幅
+ * @param n   采样数
+ * @param out 输出缓冲区，至少 n 个采样
+ */
+void nco_generate(nco_t *nco, float amp, int n, sample_t *out);
+
+/**
+ * 与 nco_generate 相同，但逐采样查表（标量参考实现，供对比与无 SIMD 的平台使用）
+ */
+void nco_generate_scalar(nco_t *nco, float amp, int n, sample_t *out);
+
+#endif /* NCO_H */
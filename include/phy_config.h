@@ -0,0 +1,65 @@
+/**
+ * phy_config.h - 物理层 / 帧参数的运行时配置
+ *
+ * common.h 里的 SAMPLE_RATE、FSK_BAUD_RATE、FSK_FREQ_0/1、MAX_FRAME_PAYLOAD 是默认值；
+ * 运行时可以用描述串（命令行 --phy）或配置文件（--config）改，再传给 modem_tx_create / modem_rx_create / audio_init。
+ * MAX_FRAME_PAYLOAD 同时是各处静态缓冲区的容量，运行时的 max_payload 只能调小，不能超过它。
+ * MFSK / OFDM 的子载波落在 FFT 频点上，随采样率一起缩放，不受这里的频率影响。
+ * 收发两端须用同一份配置；只用单载波方式（FSK / CPFSK / MSK / GMSK / DBPSK / DQPSK）时采样率可以不同，
+ * 只要两端的波特率与频率一致；MFSK / OFDM 的符号率与子载波随采样率变，两端采样率必须相同。
+ * channels=2 时左右声道各跑一路独立的调制解调，帧轮流分到空闲的声道上，接收端每个声道一个解调线程。
+ */
+
+#ifndef PHY_CONFIG_H
+#define PHY_CONFIG_H
+
+#include "common.h"
+
+/** 采样率范围 (Hz) */
+#define PHY_RATE_MIN        8000
+#define PHY_RATE_MAX        192000
+
+/** 每比特至少这么多个采样：早/迟门偏移取它的 1/8，太少时定时环路没有分辨率 */
+#define PHY_MIN_SAMPLES_PER_BIT  8
+
+/** 配置文件一行最长字节数 */
+#define PHY_CONFIG_LINE_MAX 256
+
+typedef struct {
+    int sample_rate;    /* 采样率 (Hz) */
+    int baud_rate;      /* 二进制 FSK / MSK / DPSK 的符号率 (baud) */
+    int freq0;          /* 比特 0 的载波频率 (Hz)；MSK 中心频率与 DPSK 载波取两音的中点 */
+    int freq1;          /* 比特 1 的载波频率 (Hz) */
+    int max_payload;    /* 一帧载荷上限（字节），即 TUN MTU，1 ~ MAX_FRAME_PAYLOAD */
+    int channels;       /* 声道数 1 ~ AUDIO_MAX_CHANNELS，每个声道一路独立的帧流 */
+    int force_generic;  /* 非 0 时不用为常见配置特化的解调内核（对比测试用） */
+} phy_config_t;
+
+/**
+ * 默认配置：common.h 中的各宏
+ */
+void phy_config_default(phy_config_t *cfg);
+
+/**
+ * 解析描述串并叠加到 cfg 上（先调用 phy_config_default）
+ * 逗号分隔的 键=值：rate=HZ  baud=N  f0=HZ  f1=HZ  payload=BYTES  channels=N  kernel=auto|generic
+ * 例："rate=48000,baud=1200,f0=1200,f1=2400"
+ * @return 成功 0，键未知或值非法返回 -1（不检查参数之间的约束，见 phy_config_check）
+ */
+int phy_config_parse(phy_config_t *cfg, const char *spec);
+
+/**
+ * 读配置文件并叠加到 cfg 上：每行一个 键=值（键同 phy_config_parse），# 之后为注释，空行忽略
+ * @return 成功 0，文件打不开或某行非法返回 -1（错误写到 stderr，带行号）
+ */
+int phy_config_load(phy_config_t *cfg, const char *path);
+
+/**
+ * 检查参数之间的约束：采样率在 PHY_RATE_MIN ~ PHY_RATE_MAX，每比特不少于 PHY_MIN_SAMPLES_PER_BIT 个采样，
+ * 两音不同且 MSK 两音（中点 ± baud/4）都在 0 ~ 采样率/2 之间，DPSK 积分窗放得进一个符号，载荷上限不超过 MAX_FRAME_PAYLOAD，
+ * 声道数在 1 ~ AUDIO_MAX_CHANNELS
+ * @return 合法返回 0，否则把原因写到 stderr 并返回 -1
+ */
+int phy_config_check(const phy_config_t *cfg);
+
+#endif /* PHY_CONFIG_H */
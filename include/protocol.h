@@ -1,37 +1,121 @@
 /**
  * protocol.h - 帧封装与解析（链路层）
  *
- * 发送：给 IP 包加帧头（同步字 + 长度）+ 帧尾（CRC），得到一帧字节流
- * 接收：从比特流中找同步字、取长度、校验 CRC，拆出 IP 包
+ * 发送：给 IP 包加帧头（同步字 + 长度 + 类型 + 帧头校验）+ 帧尾（CRC），得到一帧字节流
+ * 接收：从比特流中找同步字、取长度并核对帧头校验、校验 CRC，拆出 IP 包
+ * 可选前向纠错（fec.h）：发送端封装后再编码，接收端组帧器按同一方式译码
  */
 
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
 #include "common.h"
+#include "fec.h"
 #include <stdint.h>
 #include <stddef.h>  /* size_t */
 
 /**
- * 将 IP 包封装为一帧（同步 + 长度 + 载荷 + CRC），输出为字节数组
+ * 将 IP 包封装为一帧（同步 + 长度 + 类型 + 帧头校验 + 载荷 + CRC），输出为字节数组
  * @param payload    IP 包数据
  * @param payload_len 包长度
- * @param frame_out  输出缓冲区，至少 FRAME_HEADER_LEN + payload_len + CRC_BYTES
+ * @param frame_out  输出缓冲区，至少 FRAME_HEADER_LEN + payload_len + FRAME_CRC_BYTES(payload_len)
  * @return           输出帧的总字节数，失败返回 0
  */
 int protocol_encapsulate(const uint8_t *payload, int payload_len, uint8_t *frame_out);
 
+/**
+ * 把多个 IP 包聚合成一帧：载荷为各包依次排列、每包前加 1 / 2 字节子长度，类型字段带 FRAME_AGGREGATE
+ * count 为 1 时与 protocol_encapsulate 相同（不加子长度）
+ * @param payloads  各包数据
+ * @param lens      各包长度
+ * @param count     包数
+ * @param frame_out 输出缓冲区，至少 MAX_FRAME_LEN
+ * @return          输出帧的总字节数；各包 AGG_ENTRY_BYTES 之和超过 MAX_FRAME_PAYLOAD 等失败返回 0
+ */
+int protocol_encapsulate_multi(const uint8_t *const *payloads, const int *lens, int count,
+                               uint8_t *frame_out);
+
+/**
+ * 封装一个 ARQ 帧：载荷为 ARQ 头 + 各包（每包都带子长度，格式同聚合帧），类型字段带 FRAME_ARQ
+ * @param hdr       ARQ 头 ARQ_HDR_BYTES 字节（arq_tx_prepare 等填好）
+ * @param count     包数，0 即纯确认帧（payloads / lens 可为 NULL）
+ * @param frame_out 输出缓冲区，至少 MAX_FRAME_LEN
+ * @return          输出帧的总字节数；ARQ 头加各包 AGG_ENTRY_BYTES 超过 MAX_FRAME_PAYLOAD 等失败返回 0
+ */
+int protocol_encapsulate_arq(const uint8_t *hdr, const uint8_t *const *payloads, const int *lens,
+                             int count, uint8_t *frame_out);
+
+/**
+ * 封装一个控制帧（类型字段带 FRAME_CONTROL），载荷原样放入，不压缩
+ * @param body      控制消息，首字节为消息类型
+ * @param len       1 ~ MAX_FRAME_PAYLOAD
+ * @param frame_out 输出缓冲区，至少 FRAME_HEADER_LEN + len + FRAME_CRC_BYTES(len)
+ * @return          输出帧的总字节数，失败返回 0
+ */
+int protocol_encapsulate_control(const uint8_t *body, int len, uint8_t *frame_out);
+
 /**
  * 从字节流中解析一帧：找同步字、读长度、校验 CRC，拆出载荷
  * @param frame     一帧完整数据（含头+载荷+CRC）
  * @param frame_len 帧长度
  * @param payload_out 输出载荷（IP 包）缓冲区
  * @param max_payload  缓冲区最大长度
- * @return          成功返回载荷字节数，失败返回 -1（如 CRC 错误）
+ * @return          成功返回载荷字节数，失败返回 -1（如 CRC 错误、压缩帧解压失败）
+ *                  压缩帧返回解压后的载荷；聚合帧返回的是子包序列，用 protocol_aggregate_next 拆分
  */
 int protocol_decapsulate(const uint8_t *frame, int frame_len,
                          uint8_t *payload_out, int max_payload);
 
+/**
+ * 帧头类型字段是否带聚合标志
+ * @param frame 至少含帧头 FRAME_HEADER_LEN 字节
+ */
+int protocol_frame_is_aggregate(const uint8_t *frame);
+
+/**
+ * 从聚合帧载荷中取下一个包
+ * @param body     聚合帧载荷（protocol_decapsulate 的输出）
+ * @param body_len 载荷字节数
+ * @param pos      游标（字节），首次调用前置 0
+ * @param pkt      输出：指向 body 内该包的起点
+ * @return         包长度；取完返回 0，子长度越界返回 -1
+ */
+int protocol_aggregate_next(const uint8_t *body, int body_len, int *pos, const uint8_t **pkt);
+
+/**
+ * 发送端载荷压缩开关（进程内全局，默认关闭）：打开后 protocol_encapsulate / protocol_encapsulate_multi
+ * 对不短于 LZ_MIN_INPUT 的载荷试压缩，变短才发压缩版并在类型字段带 FRAME_COMPRESSED。
+ * 接收端总是能解压，与此开关无关
+ */
+void protocol_set_compression(int enable);
+
+/** 载荷压缩计数（自进程启动累计） */
+typedef struct {
+    unsigned long tx_frames;      /* 开关打开时封装的帧数 */
+    unsigned long tx_compressed;  /* 其中压缩后发出的帧数 */
+    unsigned long tx_bytes_in;    /* 这些帧压缩前的载荷字节数 */
+    unsigned long tx_bytes_out;   /* 实际发出的载荷字节数（压缩或原样） */
+    unsigned long tx_ns;          /* 压缩耗时 (ns)，含压不短的 */
+    unsigned long rx_frames;      /* 解压的帧数 */
+    unsigned long rx_bytes_in;    /* 解压前字节数 */
+    unsigned long rx_bytes_out;   /* 解压后字节数 */
+    unsigned long rx_ns;          /* 解压耗时 (ns) */
+} protocol_comp_stats_t;
+
+/** 读出载荷压缩计数（可从任意线程调用） */
+void protocol_get_comp_stats(protocol_comp_stats_t *st);
+
+/**
+ * 把封装好的帧按纠错方式编码成线路上的帧（见 fec.h）：同步字原样，帧头字段（长度 + 类型 + 帧头校验）单独卷积编码，
+ * 载荷 + CRC 按 fec 编码；FEC_NONE 时原样拷贝
+ * @param fec       FEC_NONE / FEC_RS / FEC_CONV / FEC_RS_CONV
+ * @param frame     protocol_encapsulate / protocol_encapsulate_multi 的输出
+ * @param frame_len 帧字节数
+ * @param out       输出缓冲区，至少 FEC_MAX_FRAME_LEN 字节，不能与 frame 重叠
+ * @return          线路帧字节数，帧不合法返回 0
+ */
+int protocol_fec_encode(int fec, const uint8_t *frame, int frame_len, uint8_t *out);
+
 /**
  * 在比特流中查找帧同步位置（连续 SYNC_LEN 个同步字节的起始比特下标）
  * @param bits    比特数组（每字节 8 比特，高位在前）
@@ -40,4 +124,96 @@ int protocol_decapsulate(const uint8_t *frame, int frame_len,
  */
 int protocol_find_sync(const uint8_t *bits, int nbits);
 
+/**
+ * 同 protocol_find_sync，但容许同步字中最多 max_errors 个比特不符（汉明距离）
+ * 每次装载 64 比特，一个窗口内的所有起点用移位 + 异或 + popcount 比较
+ * @param max_errors 0 即精确匹配
+ * @return           第一个满足条件的起始比特下标，未找到返回 -1
+ */
+int protocol_find_sync_tolerant(const uint8_t *bits, int nbits, int max_errors);
+
+/**
+ * 接收端组帧器：解调出的比特先进环形缓冲区，再由状态机逐步拼帧
+ * 搜同步 (HUNT) → 长度 (HEADER) → 载荷 (PAYLOAD) → CRC，每次只处理新到的比特，跨多次 push 的半帧不会丢；
+ * CRC 错或帧头非法（帧头校验错、长度越界、标志组合发送端不会发）时从假同步的下一比特重新搜（同步之后的比特还在环里），
+ * 不会吞掉紧随其后的真帧；拼帧时若环中它后面已有一个完整的真帧，也放弃当前帧重新搜，不再等假长度对应的比特。
+ */
+typedef struct protocol_rx protocol_rx_t;
+
+/**
+ * 创建组帧器
+ * @return 失败返回 NULL
+ */
+protocol_rx_t *protocol_rx_create(void);
+
+/**
+ * 丢弃环中所有比特，回到搜同步状态
+ */
+void protocol_rx_reset(protocol_rx_t *rx);
+
+/**
+ * 设置找同步时容许的错误比特数，创建时为 SYNC_MAX_ERRORS
+ * @param max_errors 0 ~ SYNC_LEN * 8 / 4，超出范围时截断
+ */
+void protocol_rx_set_sync_tolerance(protocol_rx_t *rx, int max_errors);
+
+/**
+ * 设置纠错方式（须与发送端 protocol_fec_encode 所用一致），创建时为 FEC_NONE；会丢弃环中的比特
+ * @return 成功 0，方式非法或分配译码器失败返回 -1
+ */
+int protocol_rx_set_fec(protocol_rx_t *rx, int fec);
+
+/** 纠错计数（自创建累计）：一帧的计数在 CRC 通过后才计入 */
+typedef struct {
+    unsigned long frames;      /* 译码后 CRC 正确的帧 */
+    unsigned long failed;      /* RS 无法纠正而丢弃的帧（含假同步） */
+    unsigned long rs_fixed;    /* RS 纠正的字节数（含未通过 CRC 的帧） */
+    unsigned long coded_bits;  /* 正确帧的编码比特数（帧头字段 + 载荷 + CRC） */
+    unsigned long bit_errors;  /* 其中被纠正的比特：译码结果重新编码后与收到的比较 */
+} protocol_fec_stats_t;
+
+void protocol_rx_get_fec_stats(const protocol_rx_t *rx, protocol_fec_stats_t *st);
+
+/**
+ * 追加解调出的比特（每字节 8 比特，高位在前）
+ * 环的容量够放一帧最大长度再加上一次 push，每次 push 后把 protocol_rx_next 取到返回 0 即不会溢出；
+ * 仍溢出时放弃正在拼的帧和最旧的未处理比特
+ * @param bits  比特数组
+ * @param nbits 比特数
+ */
+void protocol_rx_push(protocol_rx_t *rx, const uint8_t *bits, int nbits);
+
+/**
+ * 处理环中的新比特，拼出一帧且 CRC 正确时取出载荷；聚合帧中的包逐次取出，每次一个
+ * ARQ 帧跳过 ARQ 头，其中的包同聚合帧逐次取出（不重排、不去重）；控制帧丢弃
+ * @param payload_out 输出载荷（IP 包）缓冲区
+ * @param max_payload 缓冲区最大长度
+ * @return            载荷字节数；需要更多比特时返回 0（可继续 push）
+ */
+int protocol_rx_next(protocol_rx_t *rx, uint8_t *payload_out, int max_payload);
+
+/** protocol_rx_next_link 交出的载荷种类 */
+typedef enum {
+    PROTOCOL_RX_PACKET,   /* 一个 IP 包（普通帧，或聚合帧中的一个） */
+    PROTOCOL_RX_ARQ,      /* 整个 ARQ 帧的载荷：ARQ 头 + 子包序列，交给 arq_rx_frame */
+    PROTOCOL_RX_CONTROL   /* 整个控制帧的载荷 */
+} protocol_rx_kind_t;
+
+/**
+ * 同 protocol_rx_next，但 ARQ 帧与控制帧整帧交出，由 *kind 区分；普通帧与聚合帧照旧逐包取出
+ * @param max_payload 至少 MAX_FRAME_PAYLOAD，否则放不下的 ARQ 帧被丢弃
+ * @param kind        输出：PROTOCOL_RX_*
+ */
+int protocol_rx_next_link(protocol_rx_t *rx, uint8_t *payload_out, int max_payload, protocol_rx_kind_t *kind);
+
+/**
+ * 组帧器是否正在拼帧（已找到同步字、CRC 还没校验）；为 0 时环中新比特都在搜同步
+ */
+int protocol_rx_in_frame(const protocol_rx_t *rx);
+
+/** 自创建以来 CRC 校验通过的帧数（任何种类） */
+unsigned long protocol_rx_frame_count(const protocol_rx_t *rx);
+
+void protocol_rx_destroy(protocol_rx_t *rx);
+
 #endif /* PROTOCOL_H */
@@ -0,0 +1,182 @@
+/**
+ * ratectl.h - 按链路质量自适应调整速率（调制方式 + 纠错方式的档位）
+ *
+ * 波特率与音频频率是编译期常量，能在运行时换的是调制方式与纠错方式：
+ * 档位表（ladder）从最抗噪、最慢的档排到最快的档，收发两端须用同一张表。
+ * 每一端都测量收到的信号：
+ *   - 信噪比：解调器判决域的信号 / 噪声能量（modem_rx_take_quality），按调制方式换算成信道信噪比；
+ *   - 定时抖动：每符号定时修正量的均方根（符号长度为单位）；
+ *   - 丢帧率：对端报告里带着它累计发出的帧数，与本端这段时间收到的 CRC 正确的帧数相比。
+ * 测量值每 RATECTL_REPORT_MS 放进一个控制帧（FRAME_CONTROL，见 common.h）报告给对端（链路空闲时背靠背连发 RATECTL_REPORT_COPIES 份），
+ * 发送端按对端的报告为自己的发送方向选档：丢帧多、抖动大或信噪比低于本档门限减回差就降档，
+ * 连续 RATECTL_UP_REPORTS 个报告的信噪比都够下一档的门限且几乎不丢帧才升一档；
+ * 升档后 RATECTL_PROBE_MS 内又降回来算试探失败，下次升档前的等待时间加倍（最长 RATECTL_HOLD_MAX_MS）。
+ *
+ * 换档要让对端的解调器同时换：
+ *   - 发送端换档前先用旧档背靠背发 RATECTL_REPORT_COPIES 个报告宣告新档（tx_rung 字段）并把纪元 (epoch) 加 1，之后的帧用新档；
+ *     调制线程在两档之间留 RATECTL_GAP_MS 的静音，接收端收到宣告、切换解调器时不会切在新档的帧中间。
+ *   - 接收端的报告回显它最近见到的纪元，发送端只理会回显了当前纪元的报告，换档前测的旧数据不会再触发换档。
+ *   - 本档收不到（信道变差后帧全丢，测不到质量、报告里也就没有降档的依据）或宣告丢了时，逐档往下找：
+ *     接收端 RATECTL_SILENCE_MS 收不到任何帧就把接收档降一档，之后每 2 倍时长再降一档；
+ *     发送端 2 倍时长既收不到有效报告、也收不到对端任何帧才降一档（在新档宣告），之后同样每 2 倍时长一档。
+ *     两个方向都断时两端的收发档交替着往下走，每次发送档降完又对齐。
+ *   - 报告里还带着对端接收所用的档（rx_rung）；与本端发送档不符时本端立即跟随，在新档宣告。
+ *     对端静音超时自己降的接收档另有标记，没回显当前纪元（本端的宣告它没收到）也跟随：
+ *     只要一个方向还通，另一个方向就能在一两个报告之内重新对齐。
+ * 内部加锁：封装线程（报告、发帧计数）与 RX 线程（测量、收报告）可同时调用。
+ */
+
+#ifndef RATECTL_H
+#define RATECTL_H
+
+#include "common.h"
+#include "modem.h"
+#include <stdint.h>
+
+/** 档位表最多档数 */
+#define RATECTL_MAX_RUNGS     8
+
+/** 报告间隔 (ms) */
+#define RATECTL_REPORT_MS     2000
+
+/** 接收端这么久 (ms) 没有收到对端的帧就降一档：对端连续两组报告整组丢了才会到；发送端的静音降档等 2 倍 */
+#define RATECTL_SILENCE_MS    5000
+
+/** 换档时调制线程在两档之间插入的静音 (ms) */
+#define RATECTL_GAP_MS        100
+
+/**
+ * 换档宣告、以及链路空闲时的例行报告背靠背连发的份数：静音之后的孤立帧偶尔同步不上，紧跟其后的一帧就稳得多；
+ * 夹在数据帧中间的例行报告只发一份
+ */
+#define RATECTL_REPORT_COPIES 2
+
+/** 连续这么多个好报告才升档 */
+#define RATECTL_UP_REPORTS    2
+
+/** 升档要求的丢帧率上限；超过 RATECTL_LOSS_DOWN 即降档 */
+#define RATECTL_LOSS_UP       0.02
+#define RATECTL_LOSS_DOWN     0.20
+
+/**
+ * 丢帧率至少要基于对端这么多个帧：只回报告的方向每 RATECTL_REPORT_MS 才一帧，
+ * 静音之后的孤立帧又偶尔同步不上（MFSK / DPSK 的符号定时要从帧头现收敛），帧太少时一帧就是几十个百分点
+ */
+#define RATECTL_LOSS_FRAMES   8
+
+/** 信噪比低于本档门限减这么多 (dB) 才降档，避免在门限附近来回换 */
+#define RATECTL_HYST_DB       3.0
+
+/** 定时抖动（符号长度为单位的均方根）超过它即降档、不升档 */
+#define RATECTL_JITTER_MAX    0.05
+
+/** 升档失败后的等待 (ms)：初值，每次失败加倍，直到上限；试探成功后回到初值 */
+#define RATECTL_HOLD_MS       8000
+#define RATECTL_HOLD_MAX_MS   128000
+
+/** 升档后这么久 (ms) 内降档算试探失败 */
+#define RATECTL_PROBE_MS      10000
+
+/** 报告里的信噪比 / 抖动至少要基于这么多个符号，否则不带（OFDM 一个符号已是全部子载波的平均） */
+#define RATECTL_MIN_SYMBOLS   32
+
+/** 控制消息类型：链路质量报告 */
+#define RATECTL_MSG_REPORT    1
+
+/**
+ * 报告的字节数，各字段大端：
+ *   [类型 1][tx_rung 1][tx_epoch 1][rx_rung 1][rx_epoch 1][累计发帧数 4][有效位 1]
+ *   [信噪比 dB×4，有符号 2][抖动 ×10000，2][丢帧率 ×10000，2]
+ * tx_rung 为本帧之后发送所用的档，rx_rung / rx_epoch 为本端接收所用的档与见到的对端纪元；
+ * 有效位 bit0 为信噪比与抖动有效、bit1 为丢帧率有效，三者都是本端对对端信号的测量；
+ * bit2 为 rx_rung 是本端静音超时自己降的（对端不论纪元都跟随）
+ */
+#define RATECTL_REPORT_BYTES  16
+
+/** 一档：调制方式、纠错方式、升入本档要求的信道信噪比 (dB，按 0..SAMPLE_RATE/2 全带宽、以 FSK 的信号功率为参考计，第 0 档不用) */
+typedef struct {
+    modem_mode_t mode;
+    int          fec;
+    double       snr_db;
+} ratectl_rung_t;
+
+/** 默认档位表（--adapt），门限由 bench/modem_bench --adapt 在信道模拟器上标定 */
+extern const ratectl_rung_t ratectl_default_ladder[];
+extern const int ratectl_default_ladder_len;
+
+typedef struct ratectl ratectl_t;
+
+/** 计数与当前状态 */
+typedef struct {
+    int tx_rung;                  /* 本端发送所用的档 */
+    int rx_rung;                  /* 本端接收所用的档 */
+    unsigned long steps_up;       /* 含跟随对端升档 */
+    unsigned long steps_down;     /* 含跟随对端降档 */
+    unsigned long fallbacks;      /* 静音超时降档（收、发两个方向合计） */
+    unsigned long reports_tx;
+    unsigned long reports_rx;     /* 收到的报告（含回显旧纪元而被忽略的） */
+    int    peer_valid;            /* 以下三项为对端有效报告中最近一次带上的值，已带过的置位：bit0 信噪比与抖动、bit1 丢帧率 */
+    double peer_snr_db;
+    double peer_jitter;
+    double peer_loss;
+} ratectl_stats_t;
+
+/**
+ * 解析档位表描述串：逗号分隔的 调制方式:纠错方式[:信噪比门限 dB]，如
+ * "mfsk16:rs+conv+il,dqpsk:conv+il:6,ofdm-dqpsk:rs:18"（调制 / 纠错方式名见 modem_mode_name / fec_mode_name）
+ * @param rungs 输出，至少 RATECTL_MAX_RUNGS 个
+ * @return      档数；格式错、名字未知、档数超过 RATECTL_MAX_RUNGS 返回 -1
+ */
+int ratectl_parse_ladder(const char *spec, ratectl_rung_t *rungs);
+
+/**
+ * 创建：收发两个方向都从第 0 档开始
+ * @return 参数非法或分配失败返回 NULL
+ */
+ratectl_t *ratectl_create(const ratectl_rung_t *rungs, int count, int64_t now_ns);
+
+void ratectl_destroy(ratectl_t *rc);
+
+/** 取第 i 档（0 ≤ i < 档数） */
+const ratectl_rung_t *ratectl_rung(const ratectl_t *rc, int i);
+
+/** 新数据帧应使用的档 */
+int ratectl_tx_rung(ratectl_t *rc);
+
+/**
+ * 封装线程发帧前调用：静音超时则降一档；报告到期（或有换档要宣告）时写出报告
+ * 报告本身计入发帧数。宣告与空闲时的报告连发 RATECTL_REPORT_COPIES 个（每次调用返回一个）；
+ * 换档宣告用旧档发，最后一个返回后 ratectl_tx_rung 才是新档
+ * @param msg  输出报告，至少 RATECTL_REPORT_BYTES
+ * @param rung 输出：这个报告要用的档
+ * @return     RATECTL_REPORT_BYTES；没有要发的返回 0
+ */
+int ratectl_tx_poll(ratectl_t *rc, int64_t now_ns, uint8_t *msg, int *rung);
+
+/** 封装线程每交给调制线程一个（报告以外的）帧调用一次 */
+void ratectl_tx_frame(ratectl_t *rc);
+
+/** 本端接收应使用的档 */
+int ratectl_rx_rung(ratectl_t *rc);
+
+/** RX 线程每收到 n 个 CRC 正确的帧（任何种类，报告在交给 ratectl_rx_report 之前计入）调用 */
+void ratectl_rx_frames(ratectl_t *rc, unsigned long n, int64_t now_ns);
+
+/** 计入一段确实属于帧的解调质量（见 modem_rx_take_quality），下一个报告里带给对端 */
+void ratectl_rx_quality(ratectl_t *rc, const modem_rx_quality_t *q);
+
+/**
+ * 处理对端的报告：接收方向按宣告换档并重新开始测量，发送方向按对端的测量选档
+ * @return 本端接收档变了返回 1（调用者切换解调器与纠错方式），没变返回 0，消息非法返回 -1
+ */
+int ratectl_rx_report(ratectl_t *rc, const uint8_t *msg, int len, int64_t now_ns);
+
+/**
+ * RX 线程定期调用：RATECTL_SILENCE_MS 没收到帧就把接收档降一档，还收不到就每 2 倍时长再降一档
+ * @return 接收档变了返回 1
+ */
+int ratectl_rx_poll(ratectl_t *rc, int64_t now_ns);
+
+void ratectl_get_stats(ratectl_t *rc, ratectl_stats_t *st);
+
+#endif /* RATECTL_H */
@@ -0,0 +1,47 @@
+/**
+ * sample_ring.h - 单生产者单消费者无锁采样环
+ *
+ * 一个线程只写、另一个线程只读，不加锁、不阻塞，可在 PortAudio 回调等实时上下文中调用。
+ * 写端先写采样再发布写计数 (release)，读端看到写计数 (acquire) 后读采样、再发布读计数。
+ * 读写都是"能做多少做多少"，返回实际个数；需要等待由调用方决定怎么等。
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include "common.h"
+#include <stddef.h>
+
+typedef struct sample_ring sample_ring_t;
+
+/**
+ * 创建环
+ * @param min_samples 最少容量，向上取到 2 的幂
+ * @return            失败返回 NULL
+ */
+sample_ring_t *sample_ring_create(size_t min_samples);
+
+void sample_ring_destroy(sample_ring_t *r);
+
+/** 容量（采样） */
+size_t sample_ring_capacity(const sample_ring_t *r);
+
+/** 可读采样数（读端调用；写端调用时结果只是下限） */
+size_t sample_ring_readable(const sample_ring_t *r);
+
+/** 可写采样数（写端调用；读端调用时结果只是下限） */
+size_t sample_ring_writable(const sample_ring_t *r);
+
+/**
+ * 写入 min(n, 可写) 个采样
+ * @return 实际写入数
+ */
+size_t sample_ring_write(sample_ring_t *r, const sample_t *src, size_t n);
+
+/**
+ * 读出 min(n, 可读) 个采样
+ * @return 实际读出数
+ */
+size_t sample_ring_read(sample_ring_t *r, sample_t *dst, size_t n);
+
+#endif /* SAMPLE_RING_H */
@@ -17,6 +17,14 @@
  */
 int tun_open(const char *name);
 
+/**
+ * 设置 TUN 接口的 MTU，使内核发来的包不超过一帧的载荷上限
+ * @param name 设备名，同 tun_open
+ * @param mtu  字节数
+ * @return     成功返回 0，失败返回 -1
+ */
+int tun_set_mtu(const char *name, int mtu);
+
 /**
  * 从 TUN 读取一个 IP 包（阻塞）
  * @param fd     tun_open 返回的描述符
@@ -10,14 +10,48 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/** crc_hw_features 的位：CPU 支持 PCLMULQDQ（CRC-16 折叠）/ SSE4.2 crc32 指令（CRC-32C） */
+#define CRC_HW_CLMUL   0x1
+#define CRC_HW_CRC32C  0x2
+
 /**
  * 计算 CRC-16 (CCITT)，用于帧尾校验
+ * 按 CPU 自动选最快的实现（PCLMULQDQ 折叠或 slicing-by-8 查表），结果与逐比特实现一致
  * @param data 待校验数据指针
  * @param len  数据长度（字节）
  * @return     16 位 CRC 值
  */
 uint16_t crc16(const uint8_t *data, size_t len);
 
+/**
+ * CRC-16 的各个实现，结果与 crc16 相同，供基准对比：
+ * 逐比特（原实现）、slicing-by-8、PCLMULQDQ 折叠（CPU 不支持或数据太短时退回 slicing-by-8）
+ */
+uint16_t crc16_bitwise(const uint8_t *data, size_t len);
+uint16_t crc16_slice8(const uint8_t *data, size_t len);
+uint16_t crc16_clmul(const uint8_t *data, size_t len);
+
+/**
+ * 计算 CRC-32C (Castagnoli)，用于长帧的帧尾校验
+ * 有 SSE4.2 时用 crc32 指令，否则 slicing-by-8
+ * @param data 待校验数据指针
+ * @param len  数据长度（字节）
+ * @return     32 位 CRC 值（已做结果异或）
+ */
+uint32_t crc32c(const uint8_t *data, size_t len);
+
+/**
+ * CRC-32C 的各个实现：slicing-by-8、crc32 指令（CPU 不支持时退回 slicing-by-8）
+ */
+uint32_t crc32c_slice8(const uint8_t *data, size_t len);
+uint32_t crc32c_hw(const uint8_t *data, size_t len);
+
+/**
+ * 运行时检测到的 CRC 硬件加速
+ * @return CRC_HW_CLMUL / CRC_HW_CRC32C 的组合，非 x86 或都不支持时为 0
+ */
+int crc_hw_features(void);
+
 /**
  * 调试打印：以十六进制打印一段数据（可选，用于排查帧内容）
  * @param tag  前缀字符串，如 "TX" / "RX"
@@ -0,0 +1,413 @@
+/**
+ * arq.c - 选择重传 ARQ 实现
+ *
+ * 序号 8 位、窗口 ARQ_WINDOW 帧，序号 s 的帧放在 tx[s % ARQ_WINDOW] / rx[s % ARQ_WINDOW]；
+ * 序号比较一律按 8 位差值：(uint8_t)(a - b) < 128 即 a 不早于 b。
+ * 发送：[base, next) 为已发未完成的帧。SACK 丢失判定取「本次新确认的帧里最晚放完的时刻」（每个声道各取一个），
+ *       同一声道上比它早放完而仍未确认的帧即判为丢失（不必等超时）；重发的帧放完时刻更新，不会被同一次确认重复判定。
+ * 接收：expect 为下一个要交付的序号，floor 为对端的窗口起点；floor 在 expect 之前时，缺的帧不再等。
+ */
+
+#include "arq.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(ARQ_WINDOW <= ARQ_SACK_BITS + 1 && 2 * ARQ_WINDOW < 128 && 256 % ARQ_WINDOW == 0,
+               "ARQ window must fit the SACK bitmap and half the 8-bit sequence space");
+
+/** ARQ 头第 3 字节的最高位：确认号与 SACK 有效 */
+#define ARQ_ACK_VALID  0x80
+
+struct tx_slot {
+    int     len;          /* 帧字节数（纠错编码前） */
+    int     acked;        /* 已确认或已放弃 */
+    int     lost;         /* 判定丢失，等重发 */
+    int     retries;
+    int64_t sent_ns;      /* 最近一次放完的时刻；0 为还在排队或正在调制 */
+    int     lane;         /* 最近一次放它的声道 */
+    uint8_t frame[MAX_FRAME_LEN];
+};
+
+struct rx_slot {
+    int     present;
+    int     len;          /* 子包序列字节数 */
+    uint8_t body[MAX_FRAME_PAYLOAD];
+};
+
+struct arq {
+    pthread_mutex_t lock;
+
+    /* 发送窗口 */
+    uint8_t base;
+    uint8_t next;
+    struct tx_slot tx[ARQ_WINDOW];
+    int     have_rtt;
+    double  srtt_ms, rttvar_ms, rto_ms;
+    int     announce_base;     /* 放弃过帧：发纯确认帧把新的窗口起点告诉对端 */
+
+    /* 接收窗口 */
+    int     rx_valid;          /* 收到过对端的 ARQ 帧 */
+    uint8_t expect;
+    uint8_t floor;
+    struct rx_slot rx[ARQ_WINDOW];
+    int     ack_pending;
+    int64_t ack_since;
+
+    arq_stats_t st;
+};
+
+/** a 在 b 之后（不含相等） */
+static int seq_after(uint8_t a, uint8_t b)
+{
+    uint8_t d = (uint8_t)(a - b);
+    return d != 0 && d < 128;
+}
+
+arq_t *arq_create(void)
+{
+    struct arq *a = (struct arq *)calloc(1, sizeof(struct arq));
+    struct timespec ts;
+
+    if (!a) return NULL;
+    if (pthread_mutex_init(&a->lock, NULL) != 0) {
+        free(a);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    a->base = a->next = (uint8_t)(ts.tv_nsec ^ (ts.tv_nsec >> 8) ^ getpid());
+    a->rto_ms = ARQ_RTO_INIT_MS;
+    a->st.rto_ms = a->rto_ms;
+    return a;
+}
+
+void arq_destroy(arq_t *a)
+{
+    if (!a) return;
+    pthread_mutex_destroy(&a->lock);
+    free(a);
+}
+
+/* ========== 发送 ========== */
+
+int arq_tx_window_open(arq_t *a)
+{
+    int open;
+
+    if (!a) return 0;
+    pthread_mutex_lock(&a->lock);
+    open = (uint8_t)(a->next - a->base) < ARQ_WINDOW;
+    pthread_mutex_unlock(&a->lock);
+    return open;
+}
+
+/** 确认号与 SACK 写进 ARQ 头的后 3 字节，清掉待发确认（调用者持锁） */
+static void fill_ack(struct arq *a, uint8_t *p)
+{
+    unsigned sack = 0;
+    int i;
+
+    a->ack_pending = 0;
+    if (!a->rx_valid) {
+        p[0] = p[1] = p[2] = 0;
+        return;
+    }
+    for (i = 0; i < ARQ_SACK_BITS; i++)
+        if (a->rx[(uint8_t)(a->expect + 1 + i) % ARQ_WINDOW].present)
+            sack |= 1u << i;
+    p[0] = a->expect;
+    p[1] = (uint8_t)(ARQ_ACK_VALID | sack >> 8);
+    p[2] = (uint8_t)(sack & 0xFF);
+}
+
+void arq_tx_prepare(arq_t *a, uint8_t hdr[ARQ_HDR_BYTES])
+{
+    if (!a || !hdr) return;
+    pthread_mutex_lock(&a->lock);
+    hdr[0] = a->next;
+    hdr[1] = a->base;
+    fill_ack(a, hdr + 2);
+    pthread_mutex_unlock(&a->lock);
+}
+
+int arq_tx_commit(arq_t *a, const uint8_t *frame, int len)
+{
+    struct tx_slot *s;
+    int seq = -1;
+
+    if (!a || !frame || len <= 0 || len > MAX_FRAME_LEN)
+        return -1;
+    pthread_mutex_lock(&a->lock);
+    if ((uint8_t)(a->next - a->base) < ARQ_WINDOW) {
+        s = &a->tx[a->next % ARQ_WINDOW];
+        memcpy(s->frame, frame, (size_t)len);
+        s->len = len;
+        s->acked = s->lost = s->retries = s->lane = 0;
+        s->sent_ns = 0;
+        seq = a->next++;
+        a->st.tx_frames++;
+    }
+    pthread_mutex_unlock(&a->lock);
+    return seq;
+}
+
+/** 序号 seq 在发送窗口内 */
+static int tx_in_window(const struct arq *a, uint8_t seq)
+{
+    return (uint8_t)(seq - a->base) < (uint8_t)(a->next - a->base);
+}
+
+void arq_tx_sent(arq_t *a, int seq, int lane, int64_t now_ns)
+{
+    struct tx_slot *s;
+
+    if (!a || seq < 0 || lane < 0 || lane >= AUDIO_MAX_CHANNELS) return;
+    pthread_mutex_lock(&a->lock);
+    s = &a->tx[(uint8_t)seq % ARQ_WINDOW];
+    if (tx_in_window(a, (uint8_t)seq) && !s->acked) {
+        s->sent_ns = now_ns > 0 ? now_ns : 1;
+        s->lane = lane;
+    }
+    pthread_mutex_unlock(&a->lock);
+}
+
+/** 往返时间取样，更新 RTO（RFC 6298；确认最多延迟 ARQ_ACK_DELAY_MS，RTO 至少留出这么多余量） */
+static void rtt_sample(struct arq *a, double r)
+{
+    double var;
+
+    if (!a->have_rtt) {
+        a->srtt_ms = r;
+        a->rttvar_ms = r / 2;
+        a->have_rtt = 1;
+    } else {
+        a->rttvar_ms = 0.75 * a->rttvar_ms + 0.25 * (a->srtt_ms > r ? a->srtt_ms - r : r - a->srtt_ms);
+        a->srtt_ms = 0.875 * a->srtt_ms + 0.125 * r;
+    }
+    var = 4 * a->rttvar_ms > ARQ_ACK_DELAY_MS ? 4 * a->rttvar_ms : ARQ_ACK_DELAY_MS;
+    a->rto_ms = a->srtt_ms + var;
+    if (a->rto_ms < ARQ_RTO_MIN_MS) a->rto_ms = ARQ_RTO_MIN_MS;
+    if (a->rto_ms > ARQ_RTO_MAX_MS) a->rto_ms = ARQ_RTO_MAX_MS;
+}
+
+/** 窗口起点越过已确认 / 已放弃的帧 */
+static void tx_slide(struct arq *a)
+{
+    while (a->base != a->next && a->tx[a->base % ARQ_WINDOW].acked)
+        a->base++;
+}
+
+/** 标记确认；返回这一帧最近一次放完的时刻（没放完为 0） */
+static int64_t tx_ack_one(struct arq *a, uint8_t seq, int64_t now_ns)
+{
+    struct tx_slot *s = &a->tx[seq % ARQ_WINDOW];
+
+    if (s->acked)
+        return 0;
+    s->acked = 1;
+    s->lost = 0;
+    if (s->retries == 0 && s->sent_ns > 0 && now_ns > s->sent_ns)
+        rtt_sample(a, (now_ns - s->sent_ns) / 1e6);
+    return s->sent_ns;
+}
+
+/** 标记确认，并把这一帧放完的时刻计入它所在声道的最晚时刻 latest[] */
+static void tx_ack_lane(struct arq *a, uint8_t seq, int64_t now_ns, int64_t *latest)
+{
+    int lane = a->tx[seq % ARQ_WINDOW].lane;
+    int64_t t = tx_ack_one(a, seq, now_ns);
+
+    if (t > latest[lane])
+        latest[lane] = t;
+}
+
+/** 处理对端的确认号与 SACK（调用者持锁） */
+static void tx_on_ack(struct arq *a, uint8_t ack, unsigned sack, int64_t now_ns)
+{
+    uint8_t outstanding = (uint8_t)(a->next - a->base), s;
+    int64_t latest[AUDIO_MAX_CHANNELS] = { 0 };
+    int i;
+
+    if ((uint8_t)(ack - a->base) > outstanding)
+        return;                   /* 比窗口还旧（重发帧里过时的确认）或来自对端重启前 */
+    for (s = a->base; s != ack; s++)
+        tx_ack_lane(a, s, now_ns, latest);
+    for (i = 0; i < ARQ_SACK_BITS; i++) {
+        s = (uint8_t)(ack + 1 + i);
+        if ((sack >> i & 1) && tx_in_window(a, s))
+            tx_ack_lane(a, s, now_ns, latest);
+    }
+    /* 比同一声道上新确认的帧早放完、却还没确认的帧：丢了 */
+    for (s = a->base; s != a->next; s++) {
+        struct tx_slot *x = &a->tx[s % ARQ_WINDOW];
+        if (!x->acked && !x->lost && x->sent_ns > 0 && x->sent_ns < latest[x->lane]) {
+            x->lost = 1;
+            a->st.rtx_sack++;
+        }
+    }
+    tx_slide(a);
+}
+
+arq_poll_t arq_tx_poll(arq_t *a, int64_t now_ns, uint8_t *frame_out, int *len, int *seq,
+                       uint8_t hdr_out[ARQ_HDR_BYTES])
+{
+    arq_poll_t r = ARQ_POLL_NONE;
+    int timed_out = 0;
+    uint8_t s;
+
+    if (!a || !frame_out || !len || !seq || !hdr_out)
+        return ARQ_POLL_NONE;
+    pthread_mutex_lock(&a->lock);
+
+    for (s = a->base; s != a->next; s++) {
+        struct tx_slot *x = &a->tx[s % ARQ_WINDOW];
+        if (!x->acked && !x->lost && x->sent_ns > 0 && now_ns - x->sent_ns > (int64_t)(a->rto_ms * 1e6)) {
+            x->lost = 1;
+            a->st.rtx_timeout++;
+            timed_out = 1;
+        }
+    }
+    if (timed_out) {
+        a->rto_ms = a->rto_ms * 2 < ARQ_RTO_MAX_MS ? a->rto_ms * 2 : ARQ_RTO_MAX_MS;
+    }
+
+    for (s = a->base; s != a->next; s++) {
+        struct tx_slot *x = &a->tx[s % ARQ_WINDOW];
+        if (x->acked || !x->lost)
+            continue;
+        if (x->retries >= ARQ_MAX_RETRIES) {
+            x->acked = 1;
+            x->lost = 0;
+            a->st.gave_up++;
+            a->announce_base = 1;
+            continue;
+        }
+        memcpy(frame_out, x->frame, (size_t)x->len);
+        *len = x->len;
+        *seq = s;
+        x->lost = 0;
+        x->retries++;
+        x->sent_ns = 0;
+        r = ARQ_POLL_RETRANSMIT;
+        break;
+    }
+    tx_slide(a);
+
+    if (r == ARQ_POLL_NONE && (a->announce_base
+            || (a->ack_pending && now_ns - a->ack_since >= (int64_t)ARQ_ACK_DELAY_MS * 1000000))) {
+        hdr_out[0] = a->next;
+        hdr_out[1] = a->base;
+        fill_ack(a, hdr_out + 2);
+        a->announce_base = 0;
+        a->st.tx_acks++;
+        r = ARQ_POLL_ACK;
+    }
+    pthread_mutex_unlock(&a->lock);
+    return r;
+}
+
+/* ========== 接收 ========== */
+
+/** 要（再）发确认：对端的数据帧到了，不论新旧 */
+static void rx_want_ack(struct arq *a, int64_t now_ns)
+{
+    if (!a->ack_pending) {
+        a->ack_pending = 1;
+        a->ack_since = now_ns;
+    }
+}
+
+int arq_rx_frame(arq_t *a, const uint8_t *body, int len, int64_t now_ns)
+{
+    uint8_t seq, peer_base, off;
+    struct rx_slot *r;
+    int i;
+
+    if (!a || !body || len < ARQ_HDR_BYTES)
+        return -1;
+    seq = body[0];
+    peer_base = body[1];
+
+    pthread_mutex_lock(&a->lock);
+    if (body[3] & ARQ_ACK_VALID)
+        tx_on_ack(a, body[2], (unsigned)(body[3] & ~ARQ_ACK_VALID) << 8 | body[4], now_ns);
+
+    if (!a->rx_valid) {
+        a->rx_valid = 1;
+        a->expect = a->floor = peer_base;
+    } else if (seq_after(peer_base, a->expect)) {
+        a->floor = peer_base;      /* 对端放弃了 expect 起的若干帧，arq_rx_next 跳过其中没收到的 */
+    } else if ((uint8_t)(a->expect - peer_base) > 2 * ARQ_WINDOW) {
+        /* 对端的窗口起点落在本端已交付的序号之前太远：对端重启过，从它的新起点重新开始。
+         * 重发的是首发时缓存的帧，窗口起点可能比对端当前的落后一整窗，而本端此时可能又已交付到它之后一整窗，
+         * 两者最多相差 2 * ARQ_WINDOW - 1，不能当成重启 */
+        for (i = 0; i < ARQ_WINDOW; i++)
+            a->rx[i].present = 0;
+        a->expect = a->floor = peer_base;
+    }
+
+    if (len > ARQ_HDR_BYTES) {
+        off = (uint8_t)(seq - a->expect);
+        if (off < ARQ_WINDOW) {
+            r = &a->rx[seq % ARQ_WINDOW];
+            if (r->present) {
+                a->st.rx_dup++;
+            } else {
+                memcpy(r->body, body + ARQ_HDR_BYTES, (size_t)(len - ARQ_HDR_BYTES));
+                r->len = len - ARQ_HDR_BYTES;
+                r->present = 1;
+                a->st.rx_frames++;
+                if (off > 0 && !seq_after(a->floor, a->expect))
+                    a->st.rx_reordered++;
+            }
+        } else if (off >= 128) {
+            a->st.rx_dup++;        /* 已交付过：对端没收到确认，再确认一次 */
+        }
+        /* 窗口之外更靠前的帧：丢掉，对端没收到确认会重发 */
+        rx_want_ack(a, now_ns);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return 0;
+}
+
+int arq_rx_next(arq_t *a, uint8_t *out, int max_out)
+{
+    struct rx_slot *r;
+    int n = 0;
+
+    if (!a || !out) return 0;
+    pthread_mutex_lock(&a->lock);
+    while (a->rx_valid) {
+        r = &a->rx[a->expect % ARQ_WINDOW];
+        if (r->present) {
+            r->present = 0;
+            a->expect++;
+            if (r->len <= max_out) {
+                memcpy(out, r->body, (size_t)r->len);
+                n = r->len;
+                break;
+            }
+            continue;
+        }
+        if (!seq_after(a->floor, a->expect))
+            break;
+        a->expect++;               /* 对端已放弃的帧 */
+        a->st.rx_skipped++;
+    }
+    if (!seq_after(a->floor, a->expect))
+        a->floor = a->expect;
+    pthread_mutex_unlock(&a->lock);
+    return n;
+}
+
+void arq_get_stats(arq_t *a, arq_stats_t *st)
+{
+    if (!a || !st) return;
+    pthread_mutex_lock(&a->lock);
+    *st = a->st;
+    st->srtt_ms = a->srtt_ms;
+    st->rto_ms = a->rto_ms;
+    pthread_mutex_unlock(&a->lock);
+}
@@ -1,147 +1,419 @@
 /**
- * audio_dev.c - 声卡设备实现（PortAudio）
+ * audio_dev.c - 声卡设备实现：后端分发 + PortAudio 后端
  *
- * 使用 PortAudio 打开默认输入/输出设备，按 SAMPLE_RATE 和
- * AUDIO_FRAMES_PER_BUFFER 进行读写。编译需链接 -lportaudio。
+ * audio_* 接口按句柄里的后端函数表转发；描述串按冒号前的名字在内置后端里查找。
+ * PortAudio 后端打开默认输入/输出设备，用回调模式：声卡回调只与两个单生产者单消费者无锁环
+ * (sample_ring.h) 交换采样——输出回调从发送环取、输入回调往接收环放，不加锁、不分配内存、不做系统调用；
+ * TX / RX 线程的 audio_write / audio_read 只读写环，环满或不够时短睡眠等待。
+ * 多声道时两路流都按 channels 打开，环里存交错的采样，回调与读写都只搬整帧，声道不会错位。
+ * 发送环取空时输出静音，环满时新录到的采样丢弃，两者都计数（audio_get_stats）。
+ * 仅在定义 HAVE_PORTAUDIO 时编译（需链接 -lportaudio）。
  */
 
 #include "audio_dev.h"
 #include "common.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef HAVE_PORTAUDIO
+#include "sample_ring.h"
 #include <portaudio.h>
+#include <stdatomic.h>
+#include <time.h>
+#endif
 
-/** 在PortAudio的API中，一帧是一个时间点所有通道的采样，和链接层的帧不是一回事。*/
+/* ========== 后端分发 ========== */
 
-/** 内部句柄：保存 PaStream 指针 */
+/** 内部句柄：后端函数表 + 后端私有状态 */
 struct audio_handle {
+    const audio_backend_t *backend;
+    void *ctx;
+    int channels;
+};
+
+static const audio_backend_t *const g_backends[] = {
+#ifdef HAVE_PORTAUDIO
+    &audio_backend_portaudio,
+#endif
+    &audio_backend_loopback,
+    &audio_backend_fifo,
+    &audio_backend_unix,
+};
+
+audio_handle_t audio_open_backend(const audio_backend_t *backend, const char *arg, const phy_config_t *cfg)
+{
+    struct audio_handle *h;
+
+    if (!backend || !backend->open || !backend->read || !backend->write || !backend->close)
+        return NULL;
+    h = (struct audio_handle *)calloc(1, sizeof(struct audio_handle));
+    if (!h) return NULL;
+    h->backend = backend;
+    h->channels = cfg ? cfg->channels : 1;
+    h->ctx = backend->open(arg ? arg : "", cfg ? cfg->sample_rate : SAMPLE_RATE, h->channels);
+    if (!h->ctx) {
+        free(h);
+        return NULL;
+    }
+    return (audio_handle_t)h;
+}
+
+audio_handle_t audio_open(const char *spec, const phy_config_t *cfg)
+{
+    const char *colon;
+    size_t name_len, i;
+
+    if (!spec)
+        spec = AUDIO_DEFAULT_SPEC;
+    colon = strchr(spec, ':');
+    name_len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for (i = 0; i < sizeof(g_backends) / sizeof(g_backends[0]); i++) {
+        if (strlen(g_backends[i]->name) == name_len && strncmp(g_backends[i]->name, spec, name_len) == 0)
+            return audio_open_backend(g_backends[i], colon ? colon + 1 : "", cfg);
+    }
+    fprintf(stderr, "audio_open: unknown audio backend '%.*s'\n", (int)name_len, spec);
+    return NULL;
+}
+
+audio_handle_t audio_init(const phy_config_t *cfg)
+{
+    return audio_open(AUDIO_DEFAULT_SPEC, cfg);
+}
+
+const char *audio_backend_name(audio_handle_t handle)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+    return h ? h->backend->name : "";
+}
+
+int audio_channels(audio_handle_t handle)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+    return h ? h->channels : 0;
+}
+
+int audio_write(audio_handle_t handle, const sample_t *buf, int nframes)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+
+    if (!h || !buf || nframes <= 0)
+        return -1;
+    return h->backend->write(h->ctx, buf, nframes);
+}
+
+int audio_read(audio_handle_t handle, sample_t *buf, int nframes)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+
+    if (!h || !buf || nframes <= 0)
+        return -1;
+    return h->backend->read(h->ctx, buf, nframes);
+}
+
+int audio_get_stats(audio_handle_t handle, audio_stats_t *st)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+
+    if (!st)
+        return -1;
+    memset(st, 0, sizeof(*st));
+    if (!h || !h->backend->stats)
+        return -1;
+    return h->backend->stats(h->ctx, st);
+}
+
+void audio_cleanup(audio_handle_t handle)
+{
+    struct audio_handle *h = (struct audio_handle *)handle;
+
+    if (!h) return;
+    h->backend->close(h->ctx);
+    free(h);
+}
+
+/* ========== PortAudio 后端 ========== */
+
+#ifdef HAVE_PORTAUDIO
+
+/** 在PortAudio的API中，一帧是一个时间点所有通道的采样，和链接层的帧不是一回事。*/
+
+/** 发送环默认为每次回调采样数的这么多倍，决定 TX 最大排队延迟 */
+#define PA_RING_BUFFERS     8
+
+/** 接收环最小容量（帧），只是吸收 RX 线程的调度抖动，不增加延迟，给大一些 */
+#define PA_RX_RING_MIN      (1 << 15)
+
+/** audio_read 等数据最长 (ms)，audio_write 等空间最长 (ms，超过视为声卡停了) */
+#define PA_READ_WAIT_MS     50
+#define PA_WRITE_WAIT_MS    1000
+
+/** 发送环取空后这么多个回调周期内又有采样，算作播放中途断流；更久之后才来的算新的一段 */
+#define PA_UNDERRUN_WINDOW  4
+
+/** 后端状态：两个回调流 + 两个无锁环 + 计数 */
+struct pa_dev {
     PaStream *stream_in;   /* 麦克风输入流 */
     PaStream *stream_out;  /* 扬声器输出流 */
-    int opened;            /* 是否已成功打开 */
+    sample_ring_t *tx_ring;            /* TX 线程写，输出回调读；多声道时为交错的采样 */
+    sample_ring_t *rx_ring;            /* 输入回调写，RX 线程读 */
+    unsigned long frames;              /* 每次回调的帧数，0 由 PortAudio 决定 */
+    int sample_rate;                   /* 两路流的采样率 (Hz) */
+    int channels;                      /* 两路流的声道数 */
+    long nap_ns;                       /* 等待环时每次睡眠的时长，约 1/4 个回调周期 */
+
+    /* 只由输出回调读写 */
+    int out_playing;                   /* 上一次回调放出了采样 */
+    int out_starved;                   /* 播放途中把环取空后已过的回调数，0 为没有断流 */
+
+    /* 回调里累加，其他线程读 */
+    _Atomic unsigned long underruns;
+    _Atomic unsigned long overruns;
+    _Atomic unsigned long dropped;
 };
 
+/**
+ * 输出回调：从发送环取整帧的采样，不够补静音（TX 线程可能正写到一帧中间，那一帧留到下次）
+ * 播放途中环被取空、PA_UNDERRUN_WINDOW 个周期内又有采样续上，说明 TX 线程没跟上、声音中间断了一截，
+ * 记一次断流；一段正常放完后的静音不算（之后很久都取不到采样）
+ */
+static int pa_output_cb(const void *input, void *output, unsigned long frame_count,
+                        const PaStreamCallbackTimeInfo *time_info, PaStreamCallbackFlags status, void *user)
+{
+    struct pa_dev *h = (struct pa_dev *)user;
+    sample_t *out = (sample_t *)output;
+    size_t ch = (size_t)h->channels;
+    size_t got = sample_ring_readable(h->tx_ring) / ch;
+
+    (void)input;
+    (void)time_info;
+    if (got > frame_count)
+        got = frame_count;
+    got = sample_ring_read(h->tx_ring, out, got * ch) / ch;
+    if (got < frame_count)
+        memset(out + got * ch, 0, (frame_count - got) * ch * sizeof(sample_t));
+    if ((status & paOutputUnderflow) || (h->out_starved && got > 0))
+        atomic_fetch_add_explicit(&h->underruns, 1, memory_order_relaxed);
+    if (got == frame_count)
+        h->out_starved = 0;
+    else if (got > 0 || h->out_playing)
+        h->out_starved = 1;
+    else if (h->out_starved && ++h->out_starved > PA_UNDERRUN_WINDOW)
+        h->out_starved = 0;
+    h->out_playing = got > 0;
+    return paContinue;
+}
 
-/** 初始化音频设备，打开默认输入/输出设备，按 SAMPLE_RATE 和 AUDIO_FRAMES_PER_BUFFER 配置 */
-audio_handle_t audio_init(void)
+/** 输入回调：采样放进接收环，放不下的帧整帧丢弃并计数 */
+static int pa_input_cb(const void *input, void *output, unsigned long frame_count,
+                       const PaStreamCallbackTimeInfo *time_info, PaStreamCallbackFlags status, void *user)
 {
-    struct audio_handle *h;
+    struct pa_dev *h = (struct pa_dev *)user;
+    size_t ch = (size_t)h->channels;
+    size_t put = input ? sample_ring_writable(h->rx_ring) / ch : 0;
+
+    if (put > frame_count)
+        put = frame_count;
+    if (put > 0)
+        put = sample_ring_write(h->rx_ring, (const sample_t *)input, put * ch) / ch;
+    (void)output;
+    (void)time_info;
+    if (put < frame_count) {
+        atomic_fetch_add_explicit(&h->dropped, frame_count - put, memory_order_relaxed);
+        atomic_fetch_add_explicit(&h->overruns, 1, memory_order_relaxed);
+    } else if (status & paInputOverflow) {
+        atomic_fetch_add_explicit(&h->overruns, 1, memory_order_relaxed);
+    }
+    return paContinue;
+}
+
+/** 解析 "frames=N,ring=N,latency=MS"，缺省项不改 */
+static int pa_parse_arg(const char *arg, long *frames, long *ring, double *latency_ms)
+{
+    char buf[128], *tok, *save = NULL;
+
+    if (strlen(arg) >= sizeof(buf))
+        return -1;
+    strcpy(buf, arg);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *val = strchr(tok, '='), *end;
+        double v;
+
+        if (!val)
+            return -1;
+        *val++ = '\0';
+        v = strtod(val, &end);
+        if (end == val || *end != '\0' || v < 0)
+            return -1;
+        if (strcmp(tok, "frames") == 0)
+            *frames = (long)v;
+        else if (strcmp(tok, "ring") == 0)
+            *ring = (long)v;
+        else if (strcmp(tok, "latency") == 0)
+            *latency_ms = v;
+        else
+            return -1;
+    }
+    return 0;
+}
+
+/** 打开默认设备上 h->channels 个声道的回调流；latency_ms < 0 用设备的默认低延迟 */
+static PaError pa_open_stream(struct pa_dev *h, PaStream **stream, int input, double latency_ms)
+{
+    PaStreamParameters p;
+    const PaDeviceInfo *info;
+
+    memset(&p, 0, sizeof(p));
+    p.device = input ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice();
+    if (p.device == paNoDevice)
+        return paInvalidDevice;
+    info = Pa_GetDeviceInfo(p.device);
+    p.channelCount = h->channels;
+    p.sampleFormat = paFloat32;
+    p.suggestedLatency = latency_ms >= 0 ? latency_ms / 1000.0
+                       : (input ? info->defaultLowInputLatency : info->defaultLowOutputLatency);
+    return Pa_OpenStream(stream, input ? &p : NULL, input ? NULL : &p, h->sample_rate, h->frames, paNoFlag,
+                         input ? pa_input_cb : pa_output_cb, h);
+}
+
+/** 关闭两路流、释放环（流未打开时跳过） */
+static void pa_close(void *ctx)
+{
+    struct pa_dev *h = (struct pa_dev *)ctx;
+
+    if (!h) return;
+    if (h->stream_in)  { Pa_StopStream(h->stream_in);  Pa_CloseStream(h->stream_in); }
+    if (h->stream_out) { Pa_StopStream(h->stream_out); Pa_CloseStream(h->stream_out); }
+    sample_ring_destroy(h->tx_ring);
+    sample_ring_destroy(h->rx_ring);
+    free(h);
+    Pa_Terminate();
+}
+
+/** 打开默认输入/输出设备，按给定的采样率、声道数和参数中的回调帧数配置（ring 也以帧计） */
+static void *pa_open(const char *arg, int sample_rate, int channels)
+{
+    struct pa_dev *h;
+    long frames = AUDIO_FRAMES_PER_BUFFER, ring = 0;
+    double latency_ms = -1;
     PaError err;
 
+    if (pa_parse_arg(arg, &frames, &ring, &latency_ms) != 0) {
+        fprintf(stderr, "audio_init: bad portaudio options '%s' (frames=N,ring=N,latency=MS)\n", arg);
+        return NULL;
+    }
     err = Pa_Initialize();
     if (err != paNoError) {
         fprintf(stderr, "audio_init: Pa_Initialize failed: %s\n", Pa_GetErrorText(err));
         return NULL;
     }
 
-    h = (struct audio_handle *)calloc(1, sizeof(struct audio_handle));
+    h = (struct pa_dev *)calloc(1, sizeof(struct pa_dev));
     if (!h) {
         Pa_Terminate();
         return NULL;
     }
-
-    /* 打开默认输入设备（麦克风） */
-    err = Pa_OpenDefaultStream(&h->stream_in,
-                               1,   /* 单声道输入 */
-                               0,   /* 无输出 */
-                               paFloat32,
-                               SAMPLE_RATE,
-                               AUDIO_FRAMES_PER_BUFFER,
-                               NULL, NULL);
-    if (err != paNoError) {
-        fprintf(stderr, "audio_init: OpenDefaultStream (input) failed: %s\n", Pa_GetErrorText(err));
-        free(h);
-        Pa_Terminate();
+    h->frames = (unsigned long)frames;
+    h->sample_rate = sample_rate;
+    h->channels = channels;
+    if (frames == 0)
+        frames = AUDIO_FRAMES_PER_BUFFER;   /* 只用于估算环大小与等待粒度 */
+    if (ring < 2 * frames)
+        ring = ring > 0 ? 2 * frames : PA_RING_BUFFERS * frames;
+    h->nap_ns = (long)(frames * 250000000.0 / sample_rate);
+    h->tx_ring = sample_ring_create((size_t)ring * channels);
+    h->rx_ring = sample_ring_create((size_t)(ring > PA_RX_RING_MIN ? ring : PA_RX_RING_MIN) * channels);
+    atomic_init(&h->underruns, 0);
+    atomic_init(&h->overruns, 0);
+    atomic_init(&h->dropped, 0);
+    if (!h->tx_ring || !h->rx_ring) {
+        pa_close(h);
         return NULL;
     }
 
-    /* 打开默认输出设备（扬声器） */
-    err = Pa_OpenDefaultStream(&h->stream_out,
-                               0,   /* 无输入 */
-                               1,   /* 单声道输出 */
-                               paFloat32,
-                               SAMPLE_RATE,
-                               AUDIO_FRAMES_PER_BUFFER,
-                               NULL, NULL);
+    /* 打开并启动输入（麦克风）、输出（扬声器）两路回调流 */
+    err = pa_open_stream(h, &h->stream_in, 1, latency_ms);
     if (err != paNoError) {
-        fprintf(stderr, "audio_init: OpenDefaultStream (output) failed: %s\n", Pa_GetErrorText(err));
-        Pa_CloseStream(h->stream_in);
-        free(h);
-        Pa_Terminate();
+        fprintf(stderr, "audio_init: open input stream failed: %s\n", Pa_GetErrorText(err));
+        pa_close(h);
         return NULL;
     }
-
-    err = Pa_StartStream(h->stream_in);
+    err = pa_open_stream(h, &h->stream_out, 0, latency_ms);
     if (err != paNoError) {
-        fprintf(stderr, "audio_init: StartStream input failed: %s\n", Pa_GetErrorText(err));
-        Pa_CloseStream(h->stream_in);
-        Pa_CloseStream(h->stream_out);
-        free(h);
-        Pa_Terminate();
+        fprintf(stderr, "audio_init: open output stream failed: %s\n", Pa_GetErrorText(err));
+        pa_close(h);
         return NULL;
     }
-
-    err = Pa_StartStream(h->stream_out);
+    err = Pa_StartStream(h->stream_in);
+    if (err == paNoError)
+        err = Pa_StartStream(h->stream_out);
     if (err != paNoError) {
-        fprintf(stderr, "audio_init: StartStream output failed: %s\n", Pa_GetErrorText(err));
-        Pa_StopStream(h->stream_in);
-        Pa_CloseStream(h->stream_in);
-        Pa_CloseStream(h->stream_out);
-        free(h);
-        Pa_Terminate();
+        fprintf(stderr, "audio_init: StartStream failed: %s\n", Pa_GetErrorText(err));
+        pa_close(h);
         return NULL;
     }
+    return h;
+}
 
-    h->opened = 1;
-    return (audio_handle_t)h;
+static void pa_nap(const struct pa_dev *h)
+{
+    struct timespec ts = { 0, h->nap_ns };
+    nanosleep(&ts, NULL);
 }
 
-/** 写入nframes个采样到扬声器 */
-int audio_write(audio_handle_t handle, const sample_t *buf, int nframes)
+/** 把 nframes 帧放进发送环，环满时等输出回调取走；超过 PA_WRITE_WAIT_MS 没有进展返回 -1 */
+static int pa_write(void *ctx, const sample_t *buf, int nframes)
 {
-    struct audio_handle *h = (struct audio_handle *)handle;
-    PaError err;
+    struct pa_dev *h = (struct pa_dev *)ctx;
+    size_t left = (size_t)nframes * h->channels;
+    long waited_ns = 0;
 
-    if (!h || !h->opened || !buf || nframes <= 0)
-        return -1;
+    while (left > 0) {
+        size_t n = sample_ring_write(h->tx_ring, buf, left);
 
-    err = Pa_WriteStream(h->stream_out, buf, nframes);
-    if (err != paNoError && err != paOutputUnderflowed) {
-        fprintf(stderr, "audio_write: %s\n", Pa_GetErrorText(err));
-        return -1;
+        if (n > 0) {
+            buf += n;
+            left -= n;
+            waited_ns = 0;
+            continue;
+        }
+        if (waited_ns > PA_WRITE_WAIT_MS * 1000000L) {
+            fprintf(stderr, "audio_write: output stream stalled\n");
+            return -1;
+        }
+        pa_nap(h);
+        waited_ns += h->nap_ns;
     }
     return 0;
 }
 
-/** 读取nframes个采样从麦克风 */
-int audio_read(audio_handle_t handle, sample_t *buf, int nframes)
+/** 从接收环取 nframes 帧，不够时最多等 PA_READ_WAIT_MS，返回实际读出的帧数 */
+static int pa_read(void *ctx, sample_t *buf, int nframes)
 {
-    struct audio_handle *h = (struct audio_handle *)handle;
-    PaError err;
-    unsigned long n = (unsigned long)nframes;
+    struct pa_dev *h = (struct pa_dev *)ctx;
+    size_t ch = (size_t)h->channels;
+    size_t want = (size_t)nframes * ch;
+    long waited_ns = 0;
 
-    if (!h || !h->opened || !buf || nframes <= 0)
-        return -1;
-
-    err = Pa_ReadStream(h->stream_in, buf, n);
-    if (err != paNoError && err != paInputOverflowed) {
-        fprintf(stderr, "audio_read: %s\n", Pa_GetErrorText(err));
-        return -1;
+    while (sample_ring_readable(h->rx_ring) < want && waited_ns < PA_READ_WAIT_MS * 1000000L) {
+        pa_nap(h);
+        waited_ns += h->nap_ns;
     }
-    return (int)n;
+    return (int)(sample_ring_read(h->rx_ring, buf, want) / ch);
 }
 
-/** 关闭音频设备并释放资源 */
-void audio_cleanup(audio_handle_t handle)
+static int pa_stats(void *ctx, audio_stats_t *st)
 {
-    struct audio_handle *h = (struct audio_handle *)handle;
+    struct pa_dev *h = (struct pa_dev *)ctx;
 
-    if (!h) return;
-
-    if (h->opened) {
-        if (h->stream_in)  { Pa_StopStream(h->stream_in);  Pa_CloseStream(h->stream_in);  h->stream_in = NULL; }
-        if (h->stream_out) { Pa_StopStream(h->stream_out); Pa_CloseStream(h->stream_out); h->stream_out = NULL; }
-        h->opened = 0;
-    }
-    free(h);
-    Pa_Terminate();
+    st->underruns = atomic_load_explicit(&h->underruns, memory_order_relaxed);
+    st->overruns = atomic_load_explicit(&h->overruns, memory_order_relaxed);
+    st->dropped_samples = atomic_load_explicit(&h->dropped, memory_order_relaxed);
+    return 0;
 }
+
+const audio_backend_t audio_backend_portaudio = {
+    "portaudio", pa_open, pa_write, pa_read, pa_close, pa_stats
+};
+
+#endif /* HAVE_PORTAUDIO */
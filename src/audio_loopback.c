@@ -0,0 +1,210 @@
+/**
+ * audio_loopback.c - 进程内回环音频后端
+ *
+ * 写入的采样进一个单生产者单消费者的无锁环 (sample_ring.h，TX 线程写、RX 线程读)，同一句柄原样读回。
+ * 不按实时节拍：环有空间就写、有数据就读，整条 TX→RX 链路以 CPU 速度运行。
+ * 环满时写端等待，数据不够时读端等待；超过 LOOPBACK_WAIT_MS 即返回，调用线程可借机检查退出标志。
+ * 参数非空时按 channel.h 的描述串在写端加一级信道模拟（"loopback:snr=15,echo=3:0.5"），
+ * 写入的采样先过信道再进环，用来在无声卡的机器上看各种损伤下的全链路表现。
+ * 多声道时环里存交错的采样、读写都按整帧；每个声道一个独立的信道模拟（种子依次加 1，噪声互不相关），
+ * 声道之间没有串扰，相当于左右声道各有一条线路。
+ */
+
+#include "audio_dev.h"
+#include "channel.h"
+#include "sample_ring.h"
+#include <stdlib.h>
+#include <time.h>
+
+/** 环容量（帧，2 的幂），约 1.5 秒音频 */
+#define LOOPBACK_RING_SAMPLES  (1 << 16)
+
+/** 读写最长等待 (ms) */
+#define LOOPBACK_WAIT_MS       50
+
+/** 等待时先自旋这么多次再开始短睡眠，数据通常很快就到 */
+#define LOOPBACK_SPINS         64
+#define LOOPBACK_NAP_NS        20000
+
+/** 过信道时每次处理的帧数 */
+#define LOOPBACK_CHAN_CHUNK    1024
+
+struct loopback_dev {
+    sample_ring_t *ring;
+    int channels;
+    channel_t *chan[AUDIO_MAX_CHANNELS];  /* 每个声道的信道模拟，没有时为 NULL；只在写端使用 */
+    sample_t *chan_in;                    /* 拆出的一个声道，LOOPBACK_CHAN_CHUNK 个采样 */
+    sample_t *chan_out[AUDIO_MAX_CHANNELS]; /* 各声道的信道输出，channel_max_output(LOOPBACK_CHAN_CHUNK) 个采样 */
+    sample_t *mix;                        /* 重新交错后的输出 */
+};
+
+static double loop_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+/**
+ * 等一轮：前 LOOPBACK_SPINS 次直接返回（自旋），之后每次睡 LOOPBACK_NAP_NS
+ * @return 已超过 deadline 返回 1
+ */
+static int loop_wait(int *spins, double deadline)
+{
+    struct timespec nap = { 0, LOOPBACK_NAP_NS };
+
+    if ((*spins)++ < LOOPBACK_SPINS)
+        return 0;
+    nanosleep(&nap, NULL);
+    return loop_now_ms() > deadline;
+}
+
+static void loopback_close(void *ctx)
+{
+    struct loopback_dev *d = (struct loopback_dev *)ctx;
+    int c;
+
+    if (!d) return;
+    sample_ring_destroy(d->ring);
+    for (c = 0; c < AUDIO_MAX_CHANNELS; c++) {
+        channel_destroy(d->chan[c]);
+        free(d->chan_out[c]);
+    }
+    free(d->chan_in);
+    free(d->mix);
+    free(d);
+}
+
+static void *loopback_open(const char *arg, int sample_rate, int channels)
+{
+    struct loopback_dev *d = (struct loopback_dev *)calloc(1, sizeof(struct loopback_dev));
+    channel_config_t cfg;
+    size_t max_out = 0;
+    int c;
+
+    if (!d) return NULL;
+    d->channels = channels;
+    d->ring = sample_ring_create((size_t)LOOPBACK_RING_SAMPLES * channels);
+    if (!d->ring) {
+        loopback_close(d);
+        return NULL;
+    }
+    if (arg[0] != '\0') {
+        channel_config_default(&cfg);
+        cfg.sample_rate = sample_rate;
+        if (channel_config_parse(&cfg, arg) != 0) {
+            loopback_close(d);
+            return NULL;
+        }
+        for (c = 0; c < channels; c++) {
+            if (!(d->chan[c] = channel_create(&cfg))) {
+                loopback_close(d);
+                return NULL;
+            }
+            max_out = (size_t)channel_max_output(d->chan[c], LOOPBACK_CHAN_CHUNK);
+            if (!(d->chan_out[c] = (sample_t *)malloc(max_out * sizeof(sample_t)))) {
+                loopback_close(d);
+                return NULL;
+            }
+            cfg.seed++;
+        }
+        d->chan_in = (sample_t *)malloc(LOOPBACK_CHAN_CHUNK * sizeof(sample_t));
+        d->mix = (sample_t *)malloc(max_out * channels * sizeof(sample_t));
+        if (!d->chan_in || !d->mix) {
+            loopback_close(d);
+            return NULL;
+        }
+    }
+    return d;
+}
+
+/** 写入 nframes 帧，全部写入返回 0；读端停滞、等待超时返回 -1（未写入的采样丢弃） */
+static int ring_write(struct loopback_dev *d, const sample_t *buf, int nframes)
+{
+    size_t left = (size_t)nframes * d->channels;
+    double deadline = 0;
+    int spins = 0;
+
+    while (left > 0) {
+        size_t n = sample_ring_write(d->ring, buf, left);
+
+        if (n == 0) {
+            if (deadline == 0)
+                deadline = loop_now_ms() + LOOPBACK_WAIT_MS;
+            if (loop_wait(&spins, deadline))
+                return -1;
+            continue;
+        }
+        buf += n;
+        left -= n;
+    }
+    return 0;
+}
+
+/**
+ * 一块 n 帧过信道：单声道直接处理；多声道先拆成各声道分别处理，再交错回去
+ * 各声道的信道配置相同，ppm 重采样输出的采样数也相同
+ * @return 输出的帧数，结果在 *out
+ */
+static int loop_channel_chunk(struct loopback_dev *d, const sample_t *buf, int n, const sample_t **out)
+{
+    int c, i, m = 0, ch = d->channels;
+
+    if (ch == 1) {
+        *out = d->chan_out[0];
+        return channel_process(d->chan[0], buf, n, d->chan_out[0]);
+    }
+    for (c = 0; c < ch; c++) {
+        for (i = 0; i < n; i++)
+            d->chan_in[i] = buf[i * ch + c];
+        m = channel_process(d->chan[c], d->chan_in, n, d->chan_out[c]);
+        for (i = 0; i < m; i++)
+            d->mix[i * ch + c] = d->chan_out[c][i];
+    }
+    *out = d->mix;
+    return m;
+}
+
+static int loopback_write(void *ctx, const sample_t *buf, int nframes)
+{
+    struct loopback_dev *d = (struct loopback_dev *)ctx;
+    const sample_t *out;
+    int done;
+
+    if (!d->chan[0])
+        return ring_write(d, buf, nframes);
+    for (done = 0; done < nframes; done += LOOPBACK_CHAN_CHUNK) {
+        int n = nframes - done < LOOPBACK_CHAN_CHUNK ? nframes - done : LOOPBACK_CHAN_CHUNK;
+        int m = loop_channel_chunk(d, buf + (size_t)done * d->channels, n, &out);
+        if (ring_write(d, out, m) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * 等到有 nframes 帧或超时，返回实际读出的帧数（超时时为已有的部分，可能为 0）
+ * 写端可能正写到一帧中间，只读整帧
+ */
+static int loopback_read(void *ctx, sample_t *buf, int nframes)
+{
+    struct loopback_dev *d = (struct loopback_dev *)ctx;
+    size_t ch = (size_t)d->channels;
+    size_t want = (size_t)nframes * ch, have;
+    double deadline = 0;
+    int spins = 0;
+
+    while ((have = sample_ring_readable(d->ring)) < want) {
+        if (deadline == 0)
+            deadline = loop_now_ms() + LOOPBACK_WAIT_MS;
+        if (loop_wait(&spins, deadline))
+            break;
+    }
+    if (have > want)
+        have = want;
+    return (int)(sample_ring_read(d->ring, buf, have - have % ch) / ch);
+}
+
+const audio_backend_t audio_backend_loopback = {
+    "loopback", loopback_open, loopback_write, loopback_read, loopback_close, NULL
+};
@@ -0,0 +1,233 @@
+/**
+ * audio_stream.c - 裸 float32 采样流音频后端：命名管道 (FIFO) 与 UNIX 流套接字
+ *
+ * 采样按本机字节序的 float32 原样收发（多声道时按声道交错），没有任何头部，可直接用 sox 等工具读写：
+ *   fifo:收路径,发路径  两条单向 FIFO，路径不存在时用 mkfifo 创建；
+ *                       两个进程交叉使用同一对路径即可互联（A 的发 = B 的收）。
+ *   unix:路径           一条双向流套接字：能连上就作为客户端，否则（无人监听）在该路径监听并等待一个连接。
+ * 读端用 poll 等待，STREAM_READ_WAIT_MS 内没数据返回 0，让 RX 线程检查退出标志；
+ * 写端等待对方读走数据最多 STREAM_WRITE_WAIT_MS，超时按写失败处理。对端关闭时写返回 -1 而不是触发 SIGPIPE。
+ */
+
+#include "audio_dev.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define STREAM_READ_WAIT_MS   50
+#define STREAM_WRITE_WAIT_MS  1000
+
+struct stream_dev {
+    int rd_fd;
+    int wr_fd;                          /* 套接字时与 rd_fd 相同 */
+    int frame_bytes;                    /* 一帧（各声道各一个采样）的字节数 */
+    uint8_t partial[sizeof(sample_t) * AUDIO_MAX_CHANNELS];  /* 上次读到的不满一帧的字节 */
+    int npartial;
+    char unlink_path[sizeof(((struct sockaddr_un *)0)->sun_path)];  /* 监听方关闭时删除的套接字路径 */
+};
+
+static struct stream_dev *stream_alloc(int channels)
+{
+    struct stream_dev *d = (struct stream_dev *)calloc(1, sizeof(struct stream_dev));
+
+    if (!d) return NULL;
+    d->rd_fd = d->wr_fd = -1;
+    d->frame_bytes = (int)sizeof(sample_t) * channels;
+    /* 对端关闭后 write 返回 EPIPE，不要让 SIGPIPE 结束整个进程 */
+    signal(SIGPIPE, SIG_IGN);
+    return d;
+}
+
+static void stream_close(void *ctx)
+{
+    struct stream_dev *d = (struct stream_dev *)ctx;
+
+    if (!d) return;
+    if (d->wr_fd >= 0 && d->wr_fd != d->rd_fd)
+        close(d->wr_fd);
+    if (d->rd_fd >= 0)
+        close(d->rd_fd);
+    if (d->unlink_path[0])
+        unlink(d->unlink_path);
+    free(d);
+}
+
+static int stream_write(void *ctx, const sample_t *buf, int nframes)
+{
+    struct stream_dev *d = (struct stream_dev *)ctx;
+    const uint8_t *p = (const uint8_t *)buf;
+    size_t left = (size_t)nframes * d->frame_bytes;
+
+    while (left > 0) {
+        struct pollfd pfd = { d->wr_fd, POLLOUT, 0 };
+        ssize_t n;
+
+        if (poll(&pfd, 1, STREAM_WRITE_WAIT_MS) <= 0 || (pfd.revents & (POLLERR | POLLHUP))) {
+            fprintf(stderr, "audio_write: peer not reading\n");
+            return -1;
+        }
+        n = write(d->wr_fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            fprintf(stderr, "audio_write: %s\n", strerror(errno));
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
+static int stream_read(void *ctx, sample_t *buf, int nframes)
+{
+    struct stream_dev *d = (struct stream_dev *)ctx;
+    uint8_t *p = (uint8_t *)buf;
+    struct pollfd pfd = { d->rd_fd, POLLIN, 0 };
+    size_t have;
+    ssize_t n;
+
+    if (poll(&pfd, 1, STREAM_READ_WAIT_MS) <= 0)
+        return 0;
+
+    /* 先放回上次剩下的半帧，再读，末尾不满一帧的字节留到下次 */
+    memcpy(p, d->partial, (size_t)d->npartial);
+    n = read(d->rd_fd, p + d->npartial, (size_t)nframes * d->frame_bytes - (size_t)d->npartial);
+    if (n < 0)
+        return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+    if (n == 0) {
+        /* 对端已关闭：等一会儿再返回，免得 RX 线程空转 */
+        poll(NULL, 0, STREAM_READ_WAIT_MS);
+        return 0;
+    }
+    have = (size_t)d->npartial + (size_t)n;
+    d->npartial = (int)(have % (size_t)d->frame_bytes);
+    memcpy(d->partial, p + have - (size_t)d->npartial, (size_t)d->npartial);
+    return (int)(have / (size_t)d->frame_bytes);
+}
+
+/** FIFO 不存在时创建；已存在但不是 FIFO 时报错 */
+static int fifo_ensure(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) == 0)
+        return S_ISFIFO(st.st_mode) ? 0 : -1;
+    return mkfifo(path, 0600);
+}
+
+/**
+ * arg 为 "收路径,发路径"
+ * 收端以读写方式打开（Linux 上不阻塞，且自己持有一个写端，对方重启时不会读到 EOF）；
+ * 发端只写打开，会阻塞到对方打开它的收端为止
+ */
+static void *fifo_open(const char *arg, int sample_rate, int channels)
+{
+    struct stream_dev *d;
+    char rx_path[256];
+    const char *comma = strchr(arg, ',');
+    size_t len = comma ? (size_t)(comma - arg) : 0;
+
+    (void)sample_rate;   /* 裸采样不带采样率与声道数，由两端的 --phy 配置约定 */
+    if (!comma || len == 0 || len >= sizeof(rx_path) || comma[1] == '\0') {
+        fprintf(stderr, "audio fifo: expected fifo:RX_PATH,TX_PATH\n");
+        return NULL;
+    }
+    memcpy(rx_path, arg, len);
+    rx_path[len] = '\0';
+
+    if (fifo_ensure(rx_path) != 0 || fifo_ensure(comma + 1) != 0) {
+        fprintf(stderr, "audio fifo: cannot create FIFO %s / %s\n", rx_path, comma + 1);
+        return NULL;
+    }
+    d = stream_alloc(channels);
+    if (!d) return NULL;
+    d->rd_fd = open(rx_path, O_RDWR);
+    if (d->rd_fd < 0) {
+        fprintf(stderr, "audio fifo: open %s: %s\n", rx_path, strerror(errno));
+        stream_close(d);
+        return NULL;
+    }
+    printf("audio fifo: waiting for reader on %s...\n", comma + 1);
+    d->wr_fd = open(comma + 1, O_WRONLY);
+    if (d->wr_fd < 0) {
+        fprintf(stderr, "audio fifo: open %s: %s\n", comma + 1, strerror(errno));
+        stream_close(d);
+        return NULL;
+    }
+    return d;
+}
+
+/** arg 为套接字路径：先作为客户端连接，连不上则监听并接受一个连接 */
+static void *unix_open(const char *arg, int sample_rate, int channels)
+{
+    struct stream_dev *d;
+    struct sockaddr_un addr;
+    int fd, lfd;
+
+    (void)sample_rate;
+    if (arg[0] == '\0' || strlen(arg) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "audio unix: expected unix:SOCKET_PATH\n");
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, arg);
+
+    d = stream_alloc(channels);
+    if (!d) return NULL;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        stream_close(d);
+        return NULL;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        d->rd_fd = d->wr_fd = fd;
+        return d;
+    }
+    close(fd);
+    if (errno != ENOENT && errno != ECONNREFUSED) {
+        fprintf(stderr, "audio unix: connect %s: %s\n", arg, strerror(errno));
+        stream_close(d);
+        return NULL;
+    }
+
+    /* 没有对端：清掉残留的套接字文件，自己监听 */
+    unlink(arg);
+    lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 1) != 0) {
+        fprintf(stderr, "audio unix: listen %s: %s\n", arg, strerror(errno));
+        if (lfd >= 0) close(lfd);
+        stream_close(d);
+        return NULL;
+    }
+    strcpy(d->unlink_path, arg);
+    printf("audio unix: waiting for peer on %s...\n", arg);
+    fd = accept(lfd, NULL, NULL);
+    close(lfd);
+    if (fd < 0) {
+        fprintf(stderr, "audio unix: accept: %s\n", strerror(errno));
+        stream_close(d);
+        return NULL;
+    }
+    d->rd_fd = d->wr_fd = fd;
+    return d;
+}
+
+const audio_backend_t audio_backend_fifo = {
+    "fifo", fifo_open, stream_write, stream_read, stream_close, NULL
+};
+
+const audio_backend_t audio_backend_unix = {
+    "unix", unix_open, stream_write, stream_read, stream_close, NULL
+};
@@ -0,0 +1,136 @@
+/**
+ * bitstream.c - 比特流读写与拷贝实现
+ *
+ * 比特流高位先发，等价于大端：把 8 个字节按大端装成一个 uint64_t，最高位就是最先发的比特。
+ * 非对齐拷贝时目的端先补齐到字节边界，之后每次从源端装 9 个字节、左移拼出 64 比特，整字写出。
+ */
+
+#include "bitstream.h"
+#include <string.h>
+
+/** 8 字节按大端装载为 64 位字（memcpy 避免非对齐访问，GCC 下编译为一条装载 + bswap） */
+static uint64_t load_be64(const uint8_t *p)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return __builtin_bswap64(w);
+#else
+    uint64_t w = 0;
+    int i;
+    for (i = 0; i < 8; i++)
+        w = (w << 8) | p[i];
+    return w;
+#endif
+}
+
+static void store_be64(uint8_t *p, uint64_t w)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    w = __builtin_bswap64(w);
+    memcpy(p, &w, sizeof(w));
+#else
+    int i;
+    for (i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)w;
+        w >>= 8;
+    }
+#endif
+}
+
+uint64_t bs_read(const uint8_t *buf, size_t pos, int n)
+{
+    const uint8_t *p = buf + (pos >> 3);
+    int r = (int)(pos & 7), nb, i;
+    uint64_t acc = 0;
+
+    if (n <= 0)
+        return 0;
+    if (n > 32)
+        return (bs_read(buf, pos, n - 32) << 32) | bs_read(buf, pos + (size_t)(n - 32), 32);
+    /* n <= 32 时最多跨 5 个字节，累加器装得下 */
+    nb = (r + n + 7) >> 3;
+    for (i = 0; i < nb; i++)
+        acc = (acc << 8) | p[i];
+    acc >>= nb * 8 - r - n;
+    return acc & ((1ULL << n) - 1);
+}
+
+void bs_write(uint8_t *buf, size_t pos, uint64_t val, int n)
+{
+    uint8_t *p = buf + (pos >> 3);
+    int r = (int)(pos & 7), nb, shift, i;
+    uint64_t acc = 0, mask;
+
+    if (n <= 0)
+        return;
+    if (n > 32) {
+        bs_write(buf, pos, val >> 32, n - 32);
+        bs_write(buf, pos + (size_t)(n - 32), val & 0xFFFFFFFFULL, 32);
+        return;
+    }
+    /* 读出涉及的字节，只替换其中 n 个比特，再写回 */
+    nb = (r + n + 7) >> 3;
+    shift = nb * 8 - r - n;
+    for (i = 0; i < nb; i++)
+        acc = (acc << 8) | p[i];
+    mask = ((1ULL << n) - 1) << shift;
+    acc = (acc & ~mask) | ((val << shift) & mask);
+    for (i = nb - 1; i >= 0; i--) {
+        p[i] = (uint8_t)acc;
+        acc >>= 8;
+    }
+}
+
+void bs_copy(uint8_t *dst, size_t dst_pos, const uint8_t *src, size_t src_pos, size_t nbits)
+{
+    size_t head;
+    int r;
+
+    if (nbits == 0)
+        return;
+
+    /* 目的端先补齐到字节边界 */
+    head = (8 - (dst_pos & 7)) & 7;
+    if (head > nbits)
+        head = nbits;
+    if (head) {
+        bs_write(dst, dst_pos, bs_read(src, src_pos, (int)head), (int)head);
+        dst_pos += head;
+        src_pos += head;
+        nbits -= head;
+    }
+
+    r = (int)(src_pos & 7);
+    if (r == 0) {
+        /* 快速路径：两端都字节对齐，中间整字节直接搬 */
+        size_t nbytes = nbits >> 3;
+        memmove(dst + (dst_pos >> 3), src + (src_pos >> 3), nbytes);
+        dst_pos += nbytes << 3;
+        src_pos += nbytes << 3;
+        nbits &= 7;
+    } else {
+        /* 源端差 r 比特：64 比特跨 9 个源字节，高 8 字节左移 r、第 9 字节补低位 */
+        uint8_t *d = dst + (dst_pos >> 3);
+        const uint8_t *s = src + (src_pos >> 3);
+        size_t done = 0;
+
+        while (nbits - done >= 64) {
+            store_be64(d, (load_be64(s) << r) | (uint64_t)(s[8] >> (8 - r)));
+            d += 8;
+            s += 8;
+            done += 64;
+        }
+        while (nbits - done >= 8) {
+            *d++ = (uint8_t)((s[0] << r) | (s[1] >> (8 - r)));
+            s++;
+            done += 8;
+        }
+        dst_pos += done;
+        src_pos += done;
+        nbits -= done;
+    }
+
+    if (nbits)
+        bs_write(dst, dst_pos, bs_read(src, src_pos, (int)nbits), (int)nbits);
+}
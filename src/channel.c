@@ -0,0 +1,558 @@
+/**
+ * channel.c - 声学信道模拟实现
+ *
+ * 按 CHANNEL_BLOCK 个输入采样一块处理，块内各级都是对整块的向量运算：
+ *   回波：y = x + Σ g_k·x[n-d_k]，输入前面保留 max_delay 个历史采样，每条回波一次 axpy；
+ *   增益：块首、块尾按 dB 取值，块内线性插值（斜坡一般以秒计，远长于一块）；
+ *   掉线：泊松到达的突发，期间信号置零（噪声照加，相当于麦克风还在、声音断了）；
+ *   噪声：每个句柄自带 xorshift64* + 128 层 ziggurat 产生正态分布，逐块生成后一次加上；
+ *         噪声与掉线用两条独立的随机数流，开关掉线不改变噪声序列；
+ *   重采样：32 抽头 Kaiser 窗 sinc，128 个相位，相位之间再线性插值系数，
+ *           通带到约 0.37·SAMPLE_RATE（≈ 16 kHz）基本平坦，覆盖全部调制方式的频段。
+ * 向量部分用 GCC 向量扩展，其他编译器走标量循环。
+ */
+
+#include "channel.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** 每块输入采样数 */
+#define CHANNEL_BLOCK     1024
+
+/** 估计信号功率时低于此幅度的采样算作静音 */
+#define CHANNEL_SILENCE   1e-4f
+
+/** |ppm| 上限 */
+#define CHANNEL_MAX_PPM   10000.0
+
+/** 重采样滤波器：抽头数、相位数、Kaiser β、截止频率（相对 SAMPLE_RATE） */
+#define RS_TAPS     32
+#define RS_PHASES   128
+#define RS_BETA     8.0
+#define RS_CUTOFF   0.45
+
+/** 128 层 ziggurat 的表（Marsaglia & Tsang 2000） */
+#define ZIG_LAYERS  128
+#define ZIG_R       3.442619855899
+
+static uint32_t g_zig_k[ZIG_LAYERS];
+static float    g_zig_w[ZIG_LAYERS];
+static float    g_zig_f[ZIG_LAYERS];
+
+/** g_rs_tab[p][j]：小数位置 p/RS_PHASES 处第 j 个抽头的系数，多一行 p = RS_PHASES 便于插值 */
+static float g_rs_tab[RS_PHASES + 1][RS_TAPS];
+
+static pthread_once_t g_tab_once = PTHREAD_ONCE_INIT;
+
+struct channel {
+    channel_config_t cfg;
+    int delay[CHANNEL_MAX_ECHOES];     /* 回波延迟（采样） */
+    int max_delay;
+    sample_t *mp_ext;                  /* max_delay 个历史采样 + 当前块 */
+
+    double gain_db_span;               /* gain_end_db - gain_start_db */
+    double ramp_samples;               /* 增益单程采样数，0 为恒定增益 */
+
+    int64_t drop_len;                  /* 每次掉线采样数 */
+    int64_t gap_left;                  /* 距下次掉线的采样数 */
+    int64_t drop_left;                 /* 本次掉线剩余采样数 */
+
+    double pow_sum;                    /* 非静音输入采样的平方和与个数，用于估计信号功率 */
+    double pow_cnt;
+    double noise_scale;                /* 10^(-snr/10) */
+
+    double step;                       /* 每个输出采样前进的输入采样数 = 1 + ppm·1e-6 */
+    double pos;                        /* 下一输出在 rs_ext 中的位置 */
+
+    uint64_t t;                        /* 已处理的输入采样数 */
+    uint64_t rng_noise, rng_drop;
+
+    sample_t work[CHANNEL_BLOCK];
+    float noise[CHANNEL_BLOCK];
+    sample_t rs_ext[RS_TAPS - 1 + CHANNEL_BLOCK];
+};
+
+/* ========== 表 ========== */
+
+/** 0 阶修正贝塞尔函数 I0（级数，Kaiser 窗用） */
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0, q = x * x / 4.0;
+    int k;
+
+    for (k = 1; k < 50 && term > sum * 1e-17; k++) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static void tab_init(void)
+{
+    const double m1 = 2147483648.0, vn = 9.91256303526217e-3;
+    double dn = ZIG_R, tn = dn, q = vn / exp(-0.5 * dn * dn);
+    int i, p, j;
+
+    g_zig_k[0] = (uint32_t)((dn / q) * m1);
+    g_zig_k[1] = 0;
+    g_zig_w[0] = (float)(q / m1);
+    g_zig_w[ZIG_LAYERS - 1] = (float)(dn / m1);
+    g_zig_f[0] = 1.0f;
+    g_zig_f[ZIG_LAYERS - 1] = (float)exp(-0.5 * dn * dn);
+    for (i = ZIG_LAYERS - 2; i >= 1; i--) {
+        dn = sqrt(-2.0 * log(vn / dn + exp(-0.5 * dn * dn)));
+        g_zig_k[i + 1] = (uint32_t)((dn / tn) * m1);
+        tn = dn;
+        g_zig_f[i] = (float)exp(-0.5 * dn * dn);
+        g_zig_w[i] = (float)(dn / m1);
+    }
+
+    /* 输出位置 ip + f 用输入 ip-(RS_TAPS/2-1) .. ip+RS_TAPS/2，第 j 个抽头与输出相距 RS_TAPS/2-1+f-j */
+    for (p = 0; p <= RS_PHASES; p++) {
+        double sum = 0;
+        for (j = 0; j < RS_TAPS; j++) {
+            double d = RS_TAPS / 2 - 1 + (double)p / RS_PHASES - j;
+            double r = d / (RS_TAPS / 2), x = 2.0 * RS_CUTOFF * d, h;
+            h = (x == 0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            h *= (r * r < 1.0) ? bessel_i0(RS_BETA * sqrt(1.0 - r * r)) / bessel_i0(RS_BETA) : 0.0;
+            g_rs_tab[p][j] = (float)h;
+            sum += h;
+        }
+        /* 每个相位直流增益归一 */
+        for (j = 0; j < RS_TAPS; j++)
+            g_rs_tab[p][j] = (float)(g_rs_tab[p][j] / sum);
+    }
+}
+
+/* ========== 随机数 ========== */
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rng_next(uint64_t *s)
+{
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/** (0, 1) 均匀分布 */
+static double rng_uni(uint64_t *s)
+{
+    return ((double)(rng_next(s) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/** 标准正态：高 32 位作带符号横坐标，低 7 位选层，绝大多数情况一次乘法即返回 */
+static float rng_normal(uint64_t *s)
+{
+    for (;;) {
+        uint64_t r = rng_next(s);
+        int32_t hz = (int32_t)(uint32_t)(r >> 32);
+        int iz = (int)(r & (ZIG_LAYERS - 1));
+        float x = (float)hz * g_zig_w[iz];
+
+        if ((uint32_t)(hz < 0 ? -(int64_t)hz : hz) < g_zig_k[iz])
+            return x;
+        if (iz == 0) {
+            /* 尾部：x > R 的部分 */
+            double tx, ty;
+            do {
+                tx = -log(rng_uni(s)) / ZIG_R;
+                ty = -log(rng_uni(s));
+            } while (ty + ty < tx * tx);
+            return (float)(hz > 0 ? ZIG_R + tx : -ZIG_R - tx);
+        }
+        if (g_zig_f[iz] + (float)rng_uni(s) * (g_zig_f[iz - 1] - g_zig_f[iz]) < expf(-0.5f * x * x))
+            return x;
+    }
+}
+
+/* ========== 向量内核 ========== */
+
+#if defined(__GNUC__)
+/** 4 路 float 向量（GCC 向量扩展），在 x86 上编译为 SSE、在 ARM 上编译为 NEON */
+typedef float v4sf __attribute__((vector_size(16)));
+
+/** y += a·x */
+static void vec_axpy(sample_t *y, const sample_t *x, float a, int n)
+{
+    const v4sf va = { a, a, a, a };
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        v4sf vx, vy;
+        __builtin_memcpy(&vx, x + i, sizeof(vx));
+        __builtin_memcpy(&vy, y + i, sizeof(vy));
+        vy += va * vx;
+        __builtin_memcpy(y + i, &vy, sizeof(vy));
+    }
+    for (; i < n; i++)
+        y[i] += a * x[i];
+}
+
+/** y[i] *= g0 + i·dg */
+static void vec_ramp(sample_t *y, float g0, float dg, int n)
+{
+    v4sf g = { g0, g0 + dg, g0 + 2 * dg, g0 + 3 * dg };
+    const v4sf d4 = { 4 * dg, 4 * dg, 4 * dg, 4 * dg };
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        v4sf vy;
+        __builtin_memcpy(&vy, y + i, sizeof(vy));
+        vy *= g;
+        __builtin_memcpy(y + i, &vy, sizeof(vy));
+        g += d4;
+    }
+    for (; i < n; i++)
+        y[i] *= g0 + (float)i * dg;
+}
+
+/** 32 抽头点积，系数为相邻两相位之间按 fr 插值 */
+static float vec_fir(const sample_t *x, const float *c0, const float *c1, float fr)
+{
+    const v4sf vf = { fr, fr, fr, fr };
+    v4sf acc = { 0.0f, 0.0f, 0.0f, 0.0f };
+    int j;
+
+    for (j = 0; j < RS_TAPS; j += 4) {
+        v4sf vx, a, b;
+        __builtin_memcpy(&vx, x + j, sizeof(vx));
+        __builtin_memcpy(&a, c0 + j, sizeof(a));
+        __builtin_memcpy(&b, c1 + j, sizeof(b));
+        acc += (a + vf * (b - a)) * vx;
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+#else
+static void vec_axpy(sample_t *y, const sample_t *x, float a, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        y[i] += a * x[i];
+}
+
+static void vec_ramp(sample_t *y, float g0, float dg, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        y[i] *= g0 + (float)i * dg;
+}
+
+static float vec_fir(const sample_t *x, const float *c0, const float *c1, float fr)
+{
+    float acc = 0.0f;
+    int j;
+    for (j = 0; j < RS_TAPS; j++)
+        acc += (c0[j] + fr * (c1[j] - c0[j])) * x[j];
+    return acc;
+}
+#endif
+
+/* ========== 配置 ========== */
+
+void channel_config_default(channel_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->seed = 1;
+    cfg->sample_rate = SAMPLE_RATE;
+}
+
+/** 解析冒号分隔的 1..max 个数，全部消费完返回个数，否则 -1 */
+static int parse_list(const char *s, double *v, int max)
+{
+    int n = 0;
+
+    for (;;) {
+        char *end;
+        if (n == max) return -1;
+        v[n++] = strtod(s, &end);
+        if (end == s) return -1;
+        if (*end == '\0') return n;
+        if (*end != ':') return -1;
+        s = end + 1;
+    }
+}
+
+int channel_config_parse(channel_config_t *cfg, const char *spec)
+{
+    char buf[512], *tok, *save = NULL;
+
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "channel: spec too long\n");
+        return -1;
+    }
+    strcpy(buf, spec);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *val = strchr(tok, '=');
+        double v[3];
+        int n;
+
+        if (!val) goto bad;
+        *val++ = '\0';
+        n = parse_list(val, v, 3);
+        if (n < 0) goto bad;
+
+        if (strcmp(tok, "snr") == 0 && n == 1) {
+            cfg->awgn = 1;
+            cfg->snr_db = v[0];
+        } else if (strcmp(tok, "power") == 0 && n == 1) {
+            cfg->signal_power = v[0];
+        } else if (strcmp(tok, "echo") == 0 && n == 2) {
+            if (cfg->num_echoes == CHANNEL_MAX_ECHOES) goto bad;
+            cfg->echo_delay_ms[cfg->num_echoes] = v[0];
+            cfg->echo_gain[cfg->num_echoes] = (float)v[1];
+            cfg->num_echoes++;
+        } else if (strcmp(tok, "ppm") == 0 && n == 1) {
+            cfg->ppm = v[0];
+        } else if (strcmp(tok, "gain") == 0 && (n == 1 || n == 3)) {
+            cfg->gain_start_db = v[0];
+            cfg->gain_end_db   = n == 3 ? v[1] : v[0];
+            cfg->gain_ramp_sec = n == 3 ? v[2] : 0.0;
+        } else if (strcmp(tok, "clip") == 0 && n == 1) {
+            cfg->clip_level = (float)v[0];
+        } else if (strcmp(tok, "drop") == 0 && n == 2) {
+            cfg->dropout_per_sec = v[0];
+            cfg->dropout_ms = v[1];
+        } else if (strcmp(tok, "seed") == 0 && n == 1) {
+            cfg->seed = (uint64_t)strtoull(val, NULL, 0);
+        } else {
+            goto bad;
+        }
+    }
+    return 0;
+
+bad:
+    fprintf(stderr, "channel: bad parameter '%s' in \"%s\"\n", tok, spec);
+    return -1;
+}
+
+/* ========== 信道 ========== */
+
+static int64_t next_gap(channel_t *ch)
+{
+    return (int64_t)(-log(rng_uni(&ch->rng_drop)) * ch->cfg.sample_rate / ch->cfg.dropout_per_sec) + 1;
+}
+
+void channel_reset(channel_t *ch)
+{
+    uint64_t sm = ch->cfg.seed;
+
+    ch->rng_noise = splitmix64(&sm) | 1;
+    ch->rng_drop  = splitmix64(&sm) | 1;
+    memset(ch->mp_ext, 0, (size_t)ch->max_delay * sizeof(sample_t));
+    memset(ch->rs_ext, 0, (RS_TAPS - 1) * sizeof(sample_t));
+    ch->pos = RS_TAPS / 2 - 1;
+    ch->t = 0;
+    ch->pow_sum = ch->pow_cnt = 0;
+    ch->drop_left = 0;
+    ch->gap_left = ch->cfg.dropout_per_sec > 0 ? next_gap(ch) : INT64_MAX;
+}
+
+channel_t *channel_create(const channel_config_t *cfg)
+{
+    channel_t *ch;
+    int k;
+
+    if (cfg->sample_rate <= 0 || cfg->num_echoes < 0 || cfg->num_echoes > CHANNEL_MAX_ECHOES
+        || fabs(cfg->ppm) > CHANNEL_MAX_PPM || cfg->gain_ramp_sec < 0
+        || cfg->dropout_per_sec < 0 || cfg->dropout_ms < 0) {
+        fprintf(stderr, "channel_create: parameter out of range\n");
+        return NULL;
+    }
+    for (k = 0; k < cfg->num_echoes; k++) {
+        if (!(cfg->echo_delay_ms[k] > 0 && cfg->echo_delay_ms[k] <= CHANNEL_MAX_ECHO_MS)) {
+            fprintf(stderr, "channel_create: echo delay must be in (0, %g] ms\n", CHANNEL_MAX_ECHO_MS);
+            return NULL;
+        }
+    }
+
+    pthread_once(&g_tab_once, tab_init);
+    ch = (channel_t *)calloc(1, sizeof(channel_t));
+    if (!ch) return NULL;
+    ch->cfg = *cfg;
+
+    for (k = 0; k < cfg->num_echoes; k++) {
+        int d = (int)lround(cfg->echo_delay_ms[k] * cfg->sample_rate / 1000.0);
+        ch->delay[k] = d > 0 ? d : 1;
+        if (ch->delay[k] > ch->max_delay)
+            ch->max_delay = ch->delay[k];
+    }
+    ch->mp_ext = (sample_t *)calloc((size_t)ch->max_delay + CHANNEL_BLOCK, sizeof(sample_t));
+    if (!ch->mp_ext) {
+        free(ch);
+        return NULL;
+    }
+
+    ch->gain_db_span = cfg->gain_end_db - cfg->gain_start_db;
+    ch->ramp_samples = cfg->gain_ramp_sec * cfg->sample_rate;
+    ch->drop_len = (int64_t)llround(cfg->dropout_ms * cfg->sample_rate / 1000.0);
+    ch->noise_scale = pow(10.0, -cfg->snr_db / 10.0);
+    ch->step = 1.0 + cfg->ppm * 1e-6;
+
+    channel_reset(ch);
+    return ch;
+}
+
+void channel_destroy(channel_t *ch)
+{
+    if (!ch) return;
+    free(ch->mp_ext);
+    free(ch);
+}
+
+int channel_max_output(const channel_t *ch, int n)
+{
+    if (ch->cfg.ppm == 0)
+        return n;
+    return (int)(n / ch->step) + 2;
+}
+
+/** 时刻 t 的增益 (dB)：三角波在 start 与 end 之间往返 */
+static double gain_db_at(const channel_t *ch, uint64_t t)
+{
+    double ph, c, f;
+
+    if (ch->ramp_samples <= 0)
+        return ch->cfg.gain_start_db;
+    ph = (double)t / ch->ramp_samples;
+    c = floor(ph);
+    f = ph - c;
+    if (fmod(c, 2.0) != 0)
+        f = 1.0 - f;
+    return ch->cfg.gain_start_db + ch->gain_db_span * f;
+}
+
+/** 回波、增益、掉线、噪声、限幅：in[0..n) → ch->work */
+static void block_impair(channel_t *ch, const sample_t *in, int n)
+{
+    sample_t *y = ch->work;
+    int i, k;
+
+    /* 估计信号功率（输入端、不含回波） */
+    if (ch->cfg.awgn && ch->cfg.signal_power <= 0) {
+        for (i = 0; i < n; i++) {
+            if (in[i] > CHANNEL_SILENCE || in[i] < -CHANNEL_SILENCE) {
+                ch->pow_sum += (double)in[i] * in[i];
+                ch->pow_cnt += 1;
+            }
+        }
+    }
+
+    /* 多径 */
+    if (ch->max_delay > 0) {
+        sample_t *x = ch->mp_ext + ch->max_delay;
+        memcpy(x, in, (size_t)n * sizeof(sample_t));
+        memcpy(y, x, (size_t)n * sizeof(sample_t));
+        for (k = 0; k < ch->cfg.num_echoes; k++)
+            vec_axpy(y, x - ch->delay[k], ch->cfg.echo_gain[k], n);
+        memmove(ch->mp_ext, ch->mp_ext + n, (size_t)ch->max_delay * sizeof(sample_t));
+    } else {
+        memcpy(y, in, (size_t)n * sizeof(sample_t));
+    }
+
+    /* 增益 */
+    if (ch->ramp_samples > 0 || ch->cfg.gain_start_db != 0) {
+        float g0 = (float)pow(10.0, gain_db_at(ch, ch->t) / 20.0);
+        float g1 = (float)pow(10.0, gain_db_at(ch, ch->t + (uint64_t)n) / 20.0);
+        vec_ramp(y, g0, (g1 - g0) / n, n);
+    }
+
+    /* 掉线 */
+    for (i = 0; i < n && ch->cfg.dropout_per_sec > 0; ) {
+        int64_t m;
+        if (ch->drop_left > 0) {
+            m = ch->drop_left < n - i ? ch->drop_left : n - i;
+            memset(y + i, 0, (size_t)m * sizeof(sample_t));
+            ch->drop_left -= m;
+            if (ch->drop_left == 0)
+                ch->gap_left = next_gap(ch);
+        } else {
+            m = ch->gap_left < n - i ? ch->gap_left : n - i;
+            ch->gap_left -= m;
+            if (ch->gap_left == 0)
+                ch->drop_left = ch->drop_len > 0 ? ch->drop_len : 1;
+        }
+        i += (int)m;
+    }
+
+    /* 噪声 */
+    if (ch->cfg.awgn) {
+        double p = ch->cfg.signal_power > 0 ? ch->cfg.signal_power
+                 : (ch->pow_cnt > 0 ? ch->pow_sum / ch->pow_cnt : 0.0);
+        float sigma = (float)sqrt(p * ch->noise_scale);
+        if (sigma > 0) {
+            for (i = 0; i < n; i++)
+                ch->noise[i] = rng_normal(&ch->rng_noise);
+            vec_axpy(y, ch->noise, sigma, n);
+        }
+    }
+
+    /* 限幅 */
+    if (ch->cfg.clip_level > 0) {
+        const float c = ch->cfg.clip_level;
+        for (i = 0; i < n; i++) {
+            float v = y[i];
+            v = v > c ? c : v;
+            y[i] = v < -c ? -c : v;
+        }
+    }
+
+    ch->t += (uint64_t)n;
+}
+
+/** ch->work[0..n) 按 step 重采样到 out，返回输出个数 */
+static int block_resample(channel_t *ch, int n, sample_t *out)
+{
+    sample_t *ext = ch->rs_ext;
+    const double lim = n + RS_TAPS / 2 - 1;
+    double pos = ch->pos;
+    int nout = 0;
+
+    memcpy(ext + RS_TAPS - 1, ch->work, (size_t)n * sizeof(sample_t));
+    while (pos < lim) {
+        int ip = (int)pos;
+        double fp = (pos - ip) * RS_PHASES;
+        int p = (int)fp;
+
+        out[nout++] = vec_fir(ext + ip - (RS_TAPS / 2 - 1), g_rs_tab[p], g_rs_tab[p + 1], (float)(fp - p));
+        pos += ch->step;
+    }
+    ch->pos = pos - n;
+    memmove(ext, ext + n, (RS_TAPS - 1) * sizeof(sample_t));
+    return nout;
+}
+
+int channel_process(channel_t *ch, const sample_t *in, int n, sample_t *out)
+{
+    int done = 0, nout = 0;
+
+    while (done < n) {
+        int m = n - done < CHANNEL_BLOCK ? n - done : CHANNEL_BLOCK;
+
+        block_impair(ch, in + done, m);
+        if (ch->cfg.ppm == 0) {
+            memcpy(out + nout, ch->work, (size_t)m * sizeof(sample_t));
+            nout += m;
+        } else {
+            nout += block_resample(ch, m, out + nout);
+        }
+        done += m;
+    }
+    return nout;
+}
@@ -0,0 +1,635 @@
+/**
+ * fec.c - RS(255,223) 与 K=7 卷积码 / Viterbi 译码实现
+ *
+ * RS：GF(256) 对数 / 反对数表，生成多项式根为 α^1 ~ α^32。编码为 LFSR 求余；
+ *     译码为伴随式 → Berlekamp-Massey 求错误位置多项式 → Chien 搜索（只搜缩短后实际存在的位置）→ Forney 求错误值。
+ * Viterbi：64 个状态，旧状态 i 与 i+32 经输入比特 b 都转到新状态 2i+b。两个多项式的最高、最低位都是 1，
+ *     所以这一对蝶形的 4 条分支只有两种期望输出，且互为反码：分支度量只需 m 与 2-m（硬判决汉明距离）。
+ *     路径度量为 8 位无符号、饱和加，每 16 步减去最小值；每步每个状态 1 比特判决，64 个状态正好一个 uint64_t，
+ *     译完从零状态回溯。SSE2 实现一条指令做 16 个蝶形的加比选，判决用 movemask 直接打包。
+ * 交织：每 64 行为一块，整块装进 64 个 uint64_t 做比特矩阵转置（6 轮掩码交换），
+ *     转置后每个字是一列在这 64 行上的比特，再用 bs_read / bs_write 按列首尾相接，不逐比特搬。
+ */
+
+#include "fec.h"
+#include "bitstream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define FEC_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* ========== 名字 ========== */
+
+static const struct {
+    const char *name;
+    int mode;
+} fec_names[] = {
+    { "none",    FEC_NONE },
+    { "rs",      FEC_RS },
+    { "conv",    FEC_CONV },
+    { "rs+conv", FEC_RS_CONV },
+    { "conv+il", FEC_CONV | FEC_INTERLEAVE },
+    { "rs+conv+il", FEC_RS_CONV | FEC_INTERLEAVE },
+};
+
+#define FEC_NUM_NAMES ((int)(sizeof(fec_names) / sizeof(fec_names[0])))
+
+int fec_mode_from_name(const char *name, int *mode)
+{
+    int i;
+
+    if (!name || !mode) return -1;
+    for (i = 0; i < FEC_NUM_NAMES; i++) {
+        if (strcmp(name, fec_names[i].name) == 0) {
+            *mode = fec_names[i].mode;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *fec_mode_name(int mode)
+{
+    int i;
+
+    for (i = 0; i < FEC_NUM_NAMES; i++)
+        if (fec_names[i].mode == mode)
+            return fec_names[i].name;
+    return "?";
+}
+
+/* ========== GF(256) 与 RS ========== */
+
+#define GF_POLY  0x11D
+#define GF_LOG0  0xFF     /* log(0) 的占位（0 没有对数） */
+
+static uint8_t gf_exp[512];          /* α^i，下标到 510 都不用取模 */
+static uint8_t gf_log[256];
+static uint8_t rs_gen_log[FEC_RS_PARITY];   /* 生成多项式 x^32 以下各项系数的对数，下标为次数 */
+static uint8_t conv_out[128];        /* 7 位移位寄存器 → 两个输出比特（高位为 A） */
+static pthread_once_t fec_once = PTHREAD_ONCE_INIT;
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    if (!a || !b) return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static uint8_t gf_div(uint8_t a, uint8_t b)
+{
+    if (!a) return 0;
+    return gf_exp[gf_log[a] + 255 - gf_log[b]];
+}
+
+static int parity7(int x)
+{
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+static void fec_init(void)
+{
+    uint8_t gen[FEC_RS_PARITY + 1];
+    int i, j, x = 1;
+
+    for (i = 0; i < 255; i++) {
+        gf_exp[i] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= GF_POLY;
+    }
+    for (i = 255; i < 512; i++)
+        gf_exp[i] = gf_exp[i - 255];
+    gf_log[0] = GF_LOG0;
+
+    /* g(x) = (x - α^1)(x - α^2)...(x - α^32)，gen[k] 为 x^k 的系数 */
+    memset(gen, 0, sizeof(gen));
+    gen[0] = 1;
+    for (i = 1; i <= FEC_RS_PARITY; i++) {
+        for (j = i; j > 0; j--)
+            gen[j] = gen[j - 1] ^ gf_mul(gen[j], gf_exp[i]);
+        gen[0] = gf_mul(gen[0], gf_exp[i]);
+    }
+    for (i = 0; i < FEC_RS_PARITY; i++)
+        rs_gen_log[i] = gf_log[gen[i]];
+
+    for (i = 0; i < 128; i++)
+        conv_out[i] = (uint8_t)(parity7(i & FEC_CONV_POLYA) << 1 | parity7(i & FEC_CONV_POLYB));
+}
+
+void fec_rs_encode(uint8_t *block, int len)
+{
+    uint8_t *par = block + len;
+    int i, j;
+
+    pthread_once(&fec_once, fec_init);
+    memset(par, 0, FEC_RS_PARITY);
+    for (i = 0; i < len; i++) {
+        uint8_t fb = block[i] ^ par[0];
+
+        if (fb) {
+            int lf = gf_log[fb];
+            for (j = 0; j < FEC_RS_PARITY - 1; j++)
+                par[j] = par[j + 1] ^ gf_exp[lf + rs_gen_log[FEC_RS_PARITY - 1 - j]];
+            par[FEC_RS_PARITY - 1] = gf_exp[lf + rs_gen_log[0]];
+        } else {
+            memmove(par, par + 1, FEC_RS_PARITY - 1);
+            par[FEC_RS_PARITY - 1] = 0;
+        }
+    }
+}
+
+/** Σ p[k] x^k，x 以对数给出 */
+static uint8_t gf_poly_eval(const uint8_t *p, int deg, int xlog)
+{
+    uint8_t r = 0;
+    int k;
+
+    for (k = deg; k >= 0; k--) {
+        r = r ? gf_exp[gf_log[r] + xlog] : 0;
+        r ^= p[k];
+    }
+    return r;
+}
+
+int fec_rs_decode(uint8_t *block, int len)
+{
+    uint8_t s[FEC_RS_PARITY], lambda[FEC_RS_PARITY + 1], b[FEC_RS_PARITY + 1], t[FEC_RS_PARITY + 1];
+    uint8_t omega[FEC_RS_PARITY], deriv[FEC_RS_PARITY + 1];
+    int pos[FEC_RS_PARITY / 2];
+    int n = len + FEC_RS_PARITY, i, j, r, L = 0, m = 1, nerr = 0, any = 0;
+    uint8_t bb = 1;
+
+    if (!block || len <= 0 || len > FEC_RS_K)
+        return -1;
+    pthread_once(&fec_once, fec_init);
+
+    /* 伴随式 S_j = c(α^(j+1))，block[0] 为最高次 */
+    for (j = 0; j < FEC_RS_PARITY; j++) {
+        uint8_t v = 0;
+        for (i = 0; i < n; i++)
+            v = (v ? gf_exp[gf_log[v] + j + 1] : 0) ^ block[i];
+        s[j] = v;
+        any |= v;
+    }
+    if (!any)
+        return 0;
+
+    /* Berlekamp-Massey */
+    memset(lambda, 0, sizeof(lambda));
+    memset(b, 0, sizeof(b));
+    lambda[0] = b[0] = 1;
+    for (r = 0; r < FEC_RS_PARITY; r++) {
+        uint8_t delta = s[r], coef;
+
+        for (i = 1; i <= L; i++)
+            delta ^= gf_mul(lambda[i], s[r - i]);
+        if (!delta) {
+            m++;
+            continue;
+        }
+        coef = gf_div(delta, bb);
+        memcpy(t, lambda, sizeof(t));
+        for (i = 0; i + m <= FEC_RS_PARITY; i++)
+            lambda[i + m] ^= gf_mul(coef, b[i]);
+        if (2 * L <= r) {
+            L = r + 1 - L;
+            memcpy(b, t, sizeof(b));
+            bb = delta;
+            m = 1;
+        } else {
+            m++;
+        }
+    }
+    if (L > FEC_RS_PARITY / 2)
+        return -1;
+
+    /* Chien：位置 i 对应 x^(n-1-i)，是错误位置当且仅当 Λ(α^-(n-1-i)) = 0 */
+    for (i = 0; i < n && nerr <= L; i++) {
+        int d = n - 1 - i;
+        if (gf_poly_eval(lambda, L, (255 - d) % 255) == 0) {
+            if (nerr == L) return -1;
+            pos[nerr++] = i;
+        }
+    }
+    if (nerr != L)
+        return -1;
+
+    /* Forney：Ω = S·Λ mod x^32，e = Ω(X^-1) / Λ'(X^-1) */
+    for (i = 0; i < FEC_RS_PARITY; i++) {
+        uint8_t v = 0;
+        for (j = 0; j <= i && j <= L; j++)
+            v ^= gf_mul(s[i - j], lambda[j]);
+        omega[i] = v;
+    }
+    memset(deriv, 0, sizeof(deriv));
+    for (i = 1; i <= L; i += 2)
+        deriv[i - 1] = lambda[i];
+    for (j = 0; j < nerr; j++) {
+        int xinv = (255 - (n - 1 - pos[j])) % 255;
+        uint8_t num = gf_poly_eval(omega, FEC_RS_PARITY - 1, xinv);
+        uint8_t den = gf_poly_eval(deriv, L, xinv);
+
+        if (!den) return -1;
+        block[pos[j]] ^= gf_div(num, den);
+    }
+    return nerr;
+}
+
+/* ========== 卷积码 ========== */
+
+int fec_conv_encode(const uint8_t *in, int nbits, uint8_t *out)
+{
+    int i, sr = 0, nout = 2 * (nbits + FEC_CONV_TAIL);
+
+    pthread_once(&fec_once, fec_init);
+    memset(out, 0, (size_t)(nout + 7) / 8);
+    for (i = 0; i < nbits + FEC_CONV_TAIL; i++) {
+        int bit = i < nbits ? (in[i >> 3] >> (7 - (i & 7))) & 1 : 0;
+        int o;
+
+        sr = ((sr << 1) | bit) & 0x7F;
+        o = conv_out[sr];
+        /* 每个输入比特产生 2 个输出比特，位置 2i 是偶数，两个比特总在同一字节里 */
+        out[(2 * i) >> 3] |= (uint8_t)(o << (6 - ((2 * i) & 7)));
+    }
+    return nout;
+}
+
+/** 路径度量每隔这么多步减去最小值（8 位度量，每步最多加 2） */
+#define VIT_RENORM_STEPS  16
+
+/** 非零起始状态的初始度量：比任何 6 步内能拉开的差距都大 */
+#define VIT_INIT_METRIC   64
+
+struct fec_viterbi {
+    uint64_t dec[FEC_CONV_MAX_BITS + FEC_CONV_TAIL];  /* 每步判决：比特 s 为 1 表示新状态 s 来自旧状态 (s>>1)+32 */
+    uint8_t  bm[4][32];   /* 收到的两比特为 r 时，蝶形 i（旧状态 i、输入 0）的分支度量 */
+};
+
+fec_viterbi_t *fec_viterbi_create(void)
+{
+    fec_viterbi_t *v = (fec_viterbi_t *)calloc(1, sizeof(fec_viterbi_t));
+    int r, i;
+
+    if (!v) return NULL;
+    pthread_once(&fec_once, fec_init);
+    for (r = 0; r < 4; r++)
+        for (i = 0; i < 32; i++) {
+            int e = conv_out[2 * i] ^ r;
+            v->bm[r][i] = (uint8_t)((e >> 1) + (e & 1));
+        }
+    return v;
+}
+
+void fec_viterbi_destroy(fec_viterbi_t *v)
+{
+    free(v);
+}
+
+/** 第 t 个码元（两比特） */
+static int vit_symbol(const uint8_t *in, int t)
+{
+    return (in[(2 * t) >> 3] >> (6 - ((2 * t) & 7))) & 3;
+}
+
+/** 从零状态回溯 nsteps 步，输出前 nbits 个信息比特 */
+static void vit_traceback(const fec_viterbi_t *v, int nsteps, int nbits, uint8_t *out)
+{
+    int t, s = 0;
+
+    memset(out, 0, (size_t)(nbits + 7) / 8);
+    for (t = nsteps - 1; t >= 0; t--) {
+        if (t < nbits && (s & 1))
+            out[t >> 3] |= (uint8_t)(0x80 >> (t & 7));
+        s = (s >> 1) | (int)((v->dec[t] >> s) & 1) << 5;
+    }
+}
+
+static uint8_t sat_add8(int a, int b)
+{
+    return (uint8_t)(a + b > 255 ? 255 : a + b);
+}
+
+static void vit_acs_scalar(fec_viterbi_t *v, const uint8_t *in, int nsteps)
+{
+    uint8_t m[64], nm[64];
+    int t, i;
+
+    memset(m, VIT_INIT_METRIC, sizeof(m));
+    m[0] = 0;
+    for (t = 0; t < nsteps; t++) {
+        const uint8_t *bm = v->bm[vit_symbol(in, t)];
+        uint64_t d = 0;
+
+        for (i = 0; i < 32; i++) {
+            uint8_t a0 = sat_add8(m[i], bm[i]), b0 = sat_add8(m[i + 32], 2 - bm[i]);
+            uint8_t a1 = sat_add8(m[i], 2 - bm[i]), b1 = sat_add8(m[i + 32], bm[i]);
+
+            nm[2 * i]     = b0 < a0 ? b0 : a0;
+            nm[2 * i + 1] = b1 < a1 ? b1 : a1;
+            d |= (uint64_t)(b0 < a0) << (2 * i) | (uint64_t)(b1 < a1) << (2 * i + 1);
+        }
+        v->dec[t] = d;
+        memcpy(m, nm, sizeof(m));
+        if ((t + 1) % VIT_RENORM_STEPS == 0) {
+            uint8_t mn = m[0];
+            for (i = 1; i < 64; i++)
+                if (m[i] < mn) mn = m[i];
+            for (i = 0; i < 64; i++)
+                m[i] -= mn;
+        }
+    }
+}
+
+#ifdef FEC_HAVE_SSE2
+/**
+ * 度量按状态分 4 个向量：m0 = 0~15，m1 = 16~31，m2 = 32~47，m3 = 48~63。
+ * 蝶形 i = 0~15 用 (m0, m2)，i = 16~31 用 (m1, m3)；新状态 2i / 2i+1 的结果交织后正好是 0~31 / 32~63
+ */
+static void vit_acs_sse2(fec_viterbi_t *v, const uint8_t *in, int nsteps)
+{
+    const __m128i two = _mm_set1_epi8(2);
+    __m128i m0 = _mm_set1_epi8(VIT_INIT_METRIC), m1 = m0, m2 = m0, m3 = m0;
+    int t;
+
+    m0 = _mm_insert_epi16(m0, VIT_INIT_METRIC << 8, 0);   /* 状态 0 度量为 0 */
+    for (t = 0; t < nsteps; t++) {
+        const uint8_t *bm = v->bm[vit_symbol(in, t)];
+        __m128i bl = _mm_loadu_si128((const __m128i *)bm);
+        __m128i bh = _mm_loadu_si128((const __m128i *)(bm + 16));
+        __m128i cl = _mm_sub_epi8(two, bl), ch = _mm_sub_epi8(two, bh);
+        __m128i a0, a1, n0, n1, d0, d1, n2, n3, d2, d3;
+        uint64_t d;
+
+        /* 蝶形 0~15 */
+        a0 = _mm_adds_epu8(m0, bl);
+        n0 = _mm_min_epu8(a0, _mm_adds_epu8(m2, cl));
+        d0 = _mm_cmpeq_epi8(n0, a0);                 /* 全 1 表示取自旧状态 i */
+        a1 = _mm_adds_epu8(m0, cl);
+        n1 = _mm_min_epu8(a1, _mm_adds_epu8(m2, bl));
+        d1 = _mm_cmpeq_epi8(n1, a1);
+        /* 蝶形 16~31 */
+        a0 = _mm_adds_epu8(m1, bh);
+        n2 = _mm_min_epu8(a0, _mm_adds_epu8(m3, ch));
+        d2 = _mm_cmpeq_epi8(n2, a0);
+        a1 = _mm_adds_epu8(m1, ch);
+        n3 = _mm_min_epu8(a1, _mm_adds_epu8(m3, bh));
+        d3 = _mm_cmpeq_epi8(n3, a1);
+
+        m0 = _mm_unpacklo_epi8(n0, n1);
+        m1 = _mm_unpackhi_epi8(n0, n1);
+        m2 = _mm_unpacklo_epi8(n2, n3);
+        m3 = _mm_unpackhi_epi8(n2, n3);
+        d = (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_unpacklo_epi8(d0, d1))
+          | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_unpackhi_epi8(d0, d1)) << 16
+          | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_unpacklo_epi8(d2, d3)) << 32
+          | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_unpackhi_epi8(d2, d3)) << 48;
+        v->dec[t] = ~d;
+
+        if ((t + 1) % VIT_RENORM_STEPS == 0) {
+            __m128i mn = _mm_min_epu8(_mm_min_epu8(m0, m1), _mm_min_epu8(m2, m3));
+            mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+            mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+            mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 2));
+            mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 1));
+            mn = _mm_set1_epi8((char)_mm_cvtsi128_si32(mn));
+            m0 = _mm_subs_epu8(m0, mn);
+            m1 = _mm_subs_epu8(m1, mn);
+            m2 = _mm_subs_epu8(m2, mn);
+            m3 = _mm_subs_epu8(m3, mn);
+        }
+    }
+}
+#endif
+
+int fec_viterbi_decode_scalar(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out)
+{
+    if (!v || !in || !out || nbits <= 0 || nbits > FEC_CONV_MAX_BITS)
+        return -1;
+    vit_acs_scalar(v, in, nbits + FEC_CONV_TAIL);
+    vit_traceback(v, nbits + FEC_CONV_TAIL, nbits, out);
+    return 0;
+}
+
+int fec_viterbi_decode_simd(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out)
+{
+#ifdef FEC_HAVE_SSE2
+    if (!v || !in || !out || nbits <= 0 || nbits > FEC_CONV_MAX_BITS)
+        return -1;
+    vit_acs_sse2(v, in, nbits + FEC_CONV_TAIL);
+    vit_traceback(v, nbits + FEC_CONV_TAIL, nbits, out);
+    return 0;
+#else
+    return fec_viterbi_decode_scalar(v, in, nbits, out);
+#endif
+}
+
+int fec_viterbi_decode(fec_viterbi_t *v, const uint8_t *in, int nbits, uint8_t *out)
+{
+    return fec_viterbi_decode_simd(v, in, nbits, out);
+}
+
+/* ========== 比特交织 ========== */
+
+/** 交织矩阵的列数（一行一个 64 位字） */
+#define IL_COLS    64
+#define IL_MAX_ROWS  ((FEC_IL_MAX_BITS + IL_COLS - 1) / IL_COLS)
+#define IL_MAX_TILES ((IL_MAX_ROWS + 63) / 64)
+
+/**
+ * 64x64 比特矩阵原地转置：m[i] 的第 j 列（从高位数起）与 m[j] 的第 i 列互换
+ * 每轮把对角线两侧 j x j 的子块互换，j 从 32 减半到 1
+ */
+static void transpose64(uint64_t m[64])
+{
+    uint64_t mask = 0x00000000FFFFFFFFULL, t;
+    int j, k;
+
+    for (j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (k = 0; k < 64; k = (k + j + 1) & ~j) {
+            t = (m[k] ^ (m[k + j] >> j)) & mask;
+            m[k] ^= t;
+            m[k + j] ^= t << j;
+        }
+    }
+}
+
+/** 第 c 列的比特数：末行只有前 rem 列 */
+static int il_col_len(int rows, int rem, int c)
+{
+    return rows - (c >= rem);
+}
+
+int fec_interleave(const uint8_t *in, int nbits, uint8_t *out)
+{
+    uint64_t m[64], cols[IL_COLS][IL_MAX_TILES];
+    int rows, rem, tiles, t, r, c, n, len;
+    size_t pos = 0;
+
+    if (!in || !out || nbits <= 0 || nbits > FEC_IL_MAX_BITS)
+        return -1;
+    rows = (nbits + IL_COLS - 1) / IL_COLS;
+    rem = nbits - (rows - 1) * IL_COLS;
+    tiles = (rows + 63) / 64;
+
+    for (t = 0; t < tiles; t++) {
+        for (r = 0; r < 64; r++) {
+            int row = t * 64 + r;
+            n = row < rows - 1 ? IL_COLS : row == rows - 1 ? rem : 0;
+            m[r] = n ? bs_read(in, (size_t)row * IL_COLS, n) << (IL_COLS - n) : 0;
+        }
+        transpose64(m);
+        for (c = 0; c < IL_COLS; c++)
+            cols[c][t] = m[c];
+    }
+    for (c = 0; c < IL_COLS; c++) {
+        len = il_col_len(rows, rem, c);
+        for (t = 0; t * 64 < len; t++) {
+            n = len - t * 64 < 64 ? len - t * 64 : 64;
+            bs_write(out, pos, cols[c][t] >> (64 - n), n);
+            pos += (size_t)n;
+        }
+    }
+    return 0;
+}
+
+int fec_deinterleave(const uint8_t *in, int nbits, uint8_t *out)
+{
+    uint64_t m[64], cols[IL_COLS][IL_MAX_TILES];
+    int rows, rem, tiles, t, r, c, n, len;
+    size_t pos = 0;
+
+    if (!in || !out || nbits <= 0 || nbits > FEC_IL_MAX_BITS)
+        return -1;
+    rows = (nbits + IL_COLS - 1) / IL_COLS;
+    rem = nbits - (rows - 1) * IL_COLS;
+    tiles = (rows + 63) / 64;
+
+    for (c = 0; c < IL_COLS; c++) {
+        len = il_col_len(rows, rem, c);
+        for (t = 0; t < tiles; t++) {
+            n = len - t * 64 < 64 ? len - t * 64 : 64;
+            cols[c][t] = n > 0 ? bs_read(in, pos, n) << (64 - n) : 0;
+            pos += (size_t)(n > 0 ? n : 0);
+        }
+    }
+    for (t = 0; t < tiles; t++) {
+        for (c = 0; c < IL_COLS; c++)
+            m[c] = cols[c][t];
+        transpose64(m);
+        for (r = 0; r < 64 && t * 64 + r < rows; r++) {
+            int row = t * 64 + r;
+            n = row < rows - 1 ? IL_COLS : rem;
+            bs_write(out, (size_t)row * IL_COLS, m[r] >> (IL_COLS - n), n);
+        }
+    }
+    return 0;
+}
+
+/* ========== 按纠错方式编码 / 译码 ========== */
+
+/** len 字节平均分成 FEC_RS_BLOCKS(len) 块，第 i 块的数据字节数（前 len % nblk 块多 1 字节） */
+static int rs_block_len(int len, int i)
+{
+    int nblk = FEC_RS_BLOCKS(len);
+    return len / nblk + (i < len % nblk);
+}
+
+/** RS 分块编码：[数据 0][校验 0][数据 1][校验 1]... */
+static int rs_encode_blocks(const uint8_t *in, int len, uint8_t *out)
+{
+    int i, k, nblk = FEC_RS_BLOCKS(len), o = 0;
+
+    for (i = 0; i < nblk; i++) {
+        k = rs_block_len(len, i);
+        memcpy(out + o, in, (size_t)k);
+        fec_rs_encode(out + o, k);
+        in += k;
+        o += k + FEC_RS_PARITY;
+    }
+    return o;
+}
+
+/** RS 分块译码（coded 原地纠正），数据部分拷到 out；返回纠正的字节数，有块无法纠正返回 -1 */
+static int rs_decode_blocks(uint8_t *coded, int len, uint8_t *out)
+{
+    int i, k, n, nblk = FEC_RS_BLOCKS(len), fixed = 0;
+
+    for (i = 0; i < nblk; i++) {
+        k = rs_block_len(len, i);
+        n = fec_rs_decode(coded, k);
+        if (n < 0)
+            return -1;
+        fixed += n;
+        memcpy(out, coded, (size_t)k);
+        coded += k + FEC_RS_PARITY;
+        out += k;
+    }
+    return fixed;
+}
+
+int fec_encode(int mode, const uint8_t *in, int len, uint8_t *out)
+{
+    uint8_t rs[FEC_RS_BYTES(MAX_FRAME_PAYLOAD + CRC32C_BYTES)];
+    uint8_t conv[FEC_IL_MAX_BITS / 8];
+    int n;
+
+    if (!in || !out || len <= 0 || len > MAX_FRAME_PAYLOAD + CRC32C_BYTES || !FEC_MODE_VALID(mode))
+        return 0;
+    if (mode & FEC_INTERLEAVE) {
+        n = fec_encode(mode & ~FEC_INTERLEAVE, in, len, conv);
+        fec_interleave(conv, n * 8, out);
+        return n;
+    }
+    switch (mode) {
+    case FEC_NONE:
+        memcpy(out, in, (size_t)len);
+        return len;
+    case FEC_RS:
+        return rs_encode_blocks(in, len, out);
+    case FEC_CONV:
+        fec_conv_encode(in, len * 8, out);
+        return FEC_CONV_BYTES(len);
+    case FEC_RS_CONV:
+        fec_conv_encode(rs, rs_encode_blocks(in, len, rs) * 8, out);
+        return FEC_CONV_BYTES(FEC_RS_BYTES(len));
+    default:
+        return 0;
+    }
+}
+
+int fec_decode(fec_viterbi_t *v, int mode, const uint8_t *in, int len, uint8_t *out)
+{
+    uint8_t rs[FEC_RS_BYTES(MAX_FRAME_PAYLOAD + CRC32C_BYTES)];
+    uint8_t conv[FEC_IL_MAX_BITS / 8];
+
+    if (!in || !out || len <= 0 || len > MAX_FRAME_PAYLOAD + CRC32C_BYTES || !FEC_MODE_VALID(mode))
+        return -1;
+    if (mode & FEC_INTERLEAVE) {
+        fec_deinterleave(in, FEC_CODED_BYTES(mode, len) * 8, conv);
+        return fec_decode(v, mode & ~FEC_INTERLEAVE, conv, len, out);
+    }
+    switch (mode) {
+    case FEC_NONE:
+        memcpy(out, in, (size_t)len);
+        return 0;
+    case FEC_RS:
+        memcpy(rs, in, (size_t)FEC_RS_BYTES(len));
+        return rs_decode_blocks(rs, len, out);
+    case FEC_CONV:
+        return fec_viterbi_decode(v, in, len * 8, out);
+    case FEC_RS_CONV:
+        if (fec_viterbi_decode(v, in, FEC_RS_BYTES(len) * 8, rs) != 0)
+            return -1;
+        return rs_decode_blocks(rs, len, out);
+    default:
+        return -1;
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * fft.c - 基 2 复数 FFT 实现
+ *
+ * 先按位反转重排，再逐级蝶形 (Cooley-Tukey，时间抽取)。
+ * 旋转因子 w^k = e^{-j2πk/N} (k < N/2) 用双精度算好后存成 float，各级按步长取用。
+ */
+
+#include "fft.h"
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct fft_plan {
+    int n;
+    int *bitrev;   /* 位反转下标 */
+    float *w_re;   /* cos(2πk/N)，k < N/2 */
+    float *w_im;   /* -sin(2πk/N) */
+};
+
+fft_plan_t *fft_create(int n)
+{
+    fft_plan_t *plan;
+    int i, bits = 0;
+
+    if (n < 2 || (n & (n - 1)) != 0)
+        return NULL;
+    while ((1 << bits) < n)
+        bits++;
+
+    plan = (fft_plan_t *)calloc(1, sizeof(fft_plan_t));
+    if (!plan) return NULL;
+    plan->n = n;
+    plan->bitrev = (int *)malloc((size_t)n * sizeof(int));
+    plan->w_re = (float *)malloc((size_t)(n / 2) * sizeof(float));
+    plan->w_im = (float *)malloc((size_t)(n / 2) * sizeof(float));
+    if (!plan->bitrev || !plan->w_re || !plan->w_im) {
+        fft_destroy(plan);
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        int b, r = 0;
+        for (b = 0; b < bits; b++)
+            if (i & (1 << b))
+                r |= 1 << (bits - 1 - b);
+        plan->bitrev[i] = r;
+    }
+    for (i = 0; i < n / 2; i++) {
+        plan->w_re[i] = (float)cos(2.0 * M_PI * i / n);
+        plan->w_im[i] = (float)-sin(2.0 * M_PI * i / n);
+    }
+    return plan;
+}
+
+void fft_destroy(fft_plan_t *plan)
+{
+    if (!plan) return;
+    free(plan->bitrev);
+    free(plan->w_re);
+    free(plan->w_im);
+    free(plan);
+}
+
+/** inverse 为 1 时做逆变换（旋转因子取共轭） */
+static void fft_run(const fft_plan_t *plan, float *re, float *im, int inverse)
+{
+    const int n = plan->n;
+    int i, len;
+
+    for (i = 0; i < n; i++) {
+        int j = plan->bitrev[i];
+        if (j > i) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (len = 2; len <= n; len <<= 1) {
+        const int half = len / 2, stride = n / len;
+        int start, k;
+        for (start = 0; start < n; start += len) {
+            for (k = 0; k < half; k++) {
+                float wr = plan->w_re[k * stride];
+                float wi = inverse ? -plan->w_im[k * stride] : plan->w_im[k * stride];
+                int a = start + k, b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+void fft_forward(const fft_plan_t *plan, float *re, float *im)
+{
+    if (plan && re && im)
+        fft_run(plan, re, im, 0);
+}
+
+void fft_inverse(const fft_plan_t *plan, float *re, float *im)
+{
+    if (plan && re && im)
+        fft_run(plan, re, im, 1);
+}
@@ -0,0 +1,166 @@
+/**
+ * frame_queue.c - 有界无锁描述符队列与描述符池
+ *
+ * 每个槽位带一个序号 seq：槽 i 空闲等待第 k 轮写入时 seq == k*size + i，写入后 seq + 1，
+ * 读出后 seq + size 进入下一轮。生产者 / 消费者各自用 CAS 抢 head / tail 的位置，
+ * 抢到后只碰自己的槽位；序号不对说明队列满 / 空，直接返回，不等待。
+ */
+
+#include "frame_queue.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+struct frame_slot {
+    _Atomic size_t seq;
+    frame_desc_t  *desc;
+};
+
+struct frame_queue {
+    _Atomic size_t head;                  /* 下一个写入位置 */
+    char pad0[64 - sizeof(size_t)];
+    _Atomic size_t tail;                  /* 下一个读出位置 */
+    char pad1[64 - sizeof(size_t)];
+    size_t size;                          /* 槽位数，2 的幂 */
+    size_t mask;
+    struct frame_slot *slots;
+};
+
+struct frame_pool {
+    frame_queue_t *free_q;
+    frame_desc_t  *descs;
+    int            count;
+};
+
+frame_queue_t *frame_queue_create(size_t min_slots)
+{
+    frame_queue_t *q;
+    size_t size = 2, i;
+
+    while (size < min_slots)
+        size <<= 1;
+    q = (frame_queue_t *)calloc(1, sizeof(frame_queue_t));
+    if (!q) return NULL;
+    q->slots = (struct frame_slot *)calloc(size, sizeof(struct frame_slot));
+    if (!q->slots) {
+        free(q);
+        return NULL;
+    }
+    for (i = 0; i < size; i++)
+        atomic_init(&q->slots[i].seq, i);
+    q->size = size;
+    q->mask = size - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return q;
+}
+
+void frame_queue_destroy(frame_queue_t *q)
+{
+    if (!q) return;
+    free(q->slots);
+    free(q);
+}
+
+int frame_queue_push(frame_queue_t *q, frame_desc_t *d)
+{
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    struct frame_slot *s;
+
+    for (;;) {
+        size_t seq;
+
+        s = &q->slots[pos & q->mask];
+        seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+            /* 失败时 pos 已被更新为最新的 head，重试 */
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            return -1;                    /* 槽位还没被读走：满 */
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+    s->desc = d;
+    atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+    return 0;
+}
+
+frame_desc_t *frame_queue_pop(frame_queue_t *q)
+{
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    struct frame_slot *s;
+    frame_desc_t *d;
+
+    for (;;) {
+        size_t seq;
+
+        s = &q->slots[pos & q->mask];
+        seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq == pos + 1) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+            return NULL;                  /* 槽位还没写入：空 */
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+    d = s->desc;
+    atomic_store_explicit(&s->seq, pos + q->size, memory_order_release);
+    return d;
+}
+
+size_t frame_queue_count(const frame_queue_t *q)
+{
+    size_t head = atomic_load_explicit(&((frame_queue_t *)q)->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&((frame_queue_t *)q)->tail, memory_order_relaxed);
+
+    return head - tail <= q->size ? head - tail : 0;
+}
+
+frame_pool_t *frame_pool_create(int count)
+{
+    frame_pool_t *p;
+    int i;
+
+    if (count <= 0) return NULL;
+    p = (frame_pool_t *)calloc(1, sizeof(frame_pool_t));
+    if (!p) return NULL;
+    p->descs  = (frame_desc_t *)calloc((size_t)count, sizeof(frame_desc_t));
+    p->free_q = frame_queue_create((size_t)count);
+    if (!p->descs || !p->free_q) {
+        frame_pool_destroy(p);
+        return NULL;
+    }
+    p->count = count;
+    for (i = 0; i < count; i++)
+        frame_queue_push(p->free_q, &p->descs[i]);
+    return p;
+}
+
+void frame_pool_destroy(frame_pool_t *p)
+{
+    if (!p) return;
+    frame_queue_destroy(p->free_q);
+    free(p->descs);
+    free(p);
+}
+
+frame_desc_t *frame_pool_get(frame_pool_t *p)
+{
+    return frame_queue_pop(p->free_q);
+}
+
+void frame_pool_put(frame_pool_t *p, frame_desc_t *d)
+{
+    /* 池容量不小于描述符总数，不会满 */
+    frame_queue_push(p->free_q, d);
+}
+
+int frame_pool_size(const frame_pool_t *p)
+{
+    return p->count;
+}
@@ -0,0 +1,536 @@
+/**
+ * hdrcomp.c - IPv4 / TCP / UDP 头压缩
+ *
+ * 压缩端把上下文里的头复制一份，填入新包的动态字段（IP-ID、总长度、IP 校验和、TCP 序号 / 确认号 /
+ * 窗口 / 标志 / 时间戳、L4 校验和），与新包的头逐字节比较：一致说明其余字段都没变，发 CO，
+ * 否则发 IR。解压端按同样的方法从上下文与收到的字段还原头，再用 CRC-8 核对。
+ */
+
+#include "hdrcomp.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/** 可压缩的最长头：IPv4（无选项）+ 最长 TCP 头 */
+#define HC_MAX_HDR    (20 + 60)
+
+#define HC_PROTO_TCP  6
+#define HC_PROTO_UDP  17
+
+/* CO 标志字节各位：对应字段出现在 CRC 之后（按此顺序），未置位表示与上下文相同 */
+#define F_IPID8   0x01   /* IP-ID 低 8 位（比上下文大 1~255 时），1 字节 */
+#define F_IPID16  0x02   /* IP-ID 原值，2 字节 */
+#define F_SEQ     0x04   /* TCP 序号低 16 位 */
+#define F_ACK     0x08   /* TCP 确认号低 16 位 */
+#define F_WIN     0x10   /* TCP 窗口，2 字节 */
+#define F_FLAGS   0x20   /* TCP 标志字节 */
+#define F_TS      0x40   /* TCP 时间戳 TSval、TSecr 低 16 位 */
+#define F_TCP_ALL (F_SEQ | F_ACK | F_WIN | F_FLAGS | F_TS)
+
+/**
+ * 字段只在变化时发送，丢了那一个包接收端上下文就停在旧值上；
+ * 变化后的这么多个包都带上它，连续丢包不超过这个数就不必等 IR
+ */
+#define HC_REPEAT  3
+
+/** 需要重复发送的字段（compress 中 rep[] 的下标） */
+enum { HC_IPID, HC_SEQ, HC_ACK, HC_WIN, HC_FLAGS, HC_TS, HC_NFIELDS };
+
+/** 头中每个包都可能变的字段 */
+typedef struct {
+    uint16_t ipid;
+    uint32_t seq, ack;
+    uint16_t win;
+    uint8_t  flags;
+    uint16_t csum;      /* TCP / UDP 校验和，原样传送 */
+    uint32_t tsval, tsecr;
+} hc_fields_t;
+
+struct hc_ctx {
+    int      valid;
+    uint8_t  hdr[HC_MAX_HDR];   /* 上一个包的头 */
+    int      hlen;              /* IP + L4 头长度 */
+    int      ts_off;            /* TSval 在 hdr 中的偏移，无时间戳选项为 -1 */
+    unsigned since_ir;          /* 压缩端：上次 IR 之后的 CO 个数 */
+    int      rep[HC_NFIELDS];   /* 压缩端：各字段变化后还要重复发送的包数 */
+    unsigned long last_use;     /* 压缩端：最近一次使用的序号（替换最久未用的） */
+    unsigned drops;             /* 解压端：上下文失效后丢掉的包数 */
+};
+
+struct hdrcomp_tx {
+    struct hc_ctx ctx[HDRCOMP_MAX_CONTEXTS];
+    _Atomic uint32_t refresh;   /* 位 i：CID i 的下一个包发 IR */
+    unsigned long tick;
+};
+
+struct hdrcomp_rx {
+    struct hc_ctx ctx[HDRCOMP_MAX_CONTEXTS];
+    uint32_t nack;              /* 位 i：要请对端刷新 CID i */
+};
+
+#if HDRCOMP_MAX_CONTEXTS > 32
+#error "refresh / nack bitmaps hold at most 32 contexts"
+#endif
+
+/* ========== CRC-8（多项式 0x07），覆盖还原后的头 ========== */
+
+static uint8_t crc8_table[256];
+static pthread_once_t crc8_once = PTHREAD_ONCE_INIT;
+
+static void crc8_init(void)
+{
+    int i, b;
+
+    for (i = 0; i < 256; i++) {
+        uint8_t c = (uint8_t)i;
+        for (b = 0; b < 8; b++)
+            c = (uint8_t)((c & 0x80) ? (c << 1) ^ 0x07 : c << 1);
+        crc8_table[i] = c;
+    }
+}
+
+static uint8_t crc8(const uint8_t *p, int n)
+{
+    uint8_t c = 0;
+
+    while (n-- > 0)
+        c = crc8_table[c ^ *p++];
+    return c;
+}
+
+/* ========== 头字段读写 ========== */
+
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t rd32(const uint8_t *p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+static void wr16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+static void wr32(uint8_t *p, uint32_t v) { wr16(p, (uint16_t)(v >> 16)); wr16(p + 2, (uint16_t)v); }
+
+/** IPv4 头（20 字节）校验和，校验和字段须先置 0 */
+static uint16_t ip_checksum(const uint8_t *h)
+{
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < 20; i += 2)
+        sum += rd16(h + i);
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+/**
+ * 判断能否压缩：IPv4 无选项、不分片、总长度与实际一致，TCP 或 UDP
+ * @return 协议号，不能压缩返回 0
+ */
+static int hc_parse(const uint8_t *p, int len, int *hlen, int *ts_off)
+{
+    int doff, i, end;
+
+    if (len < 20 || p[0] != 0x45 || rd16(p + 2) != len || (rd16(p + 6) & 0x3FFF) != 0)
+        return 0;
+    *ts_off = -1;
+    if (p[9] == HC_PROTO_UDP) {
+        if (len < 28 || rd16(p + 24) != len - 20)
+            return 0;
+        *hlen = 28;
+        return HC_PROTO_UDP;
+    }
+    if (p[9] != HC_PROTO_TCP || len < 40)
+        return 0;
+    doff = (p[32] >> 4) * 4;
+    end = 20 + doff;
+    if (doff < 20 || end > len)
+        return 0;
+    /* 找时间戳选项 (kind 8, len 10)，其余选项只要不变就随上下文还原 */
+    for (i = 40; i < end; ) {
+        if (p[i] == 0)
+            break;
+        if (p[i] == 1) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= end || p[i + 1] < 2 || i + p[i + 1] > end)
+            break;
+        if (p[i] == 8 && p[i + 1] == 10)
+            *ts_off = i + 2;
+        i += p[i + 1];
+    }
+    *hlen = end;
+    return HC_PROTO_TCP;
+}
+
+static void hc_get(const uint8_t *h, int ts_off, hc_fields_t *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->ipid = rd16(h + 4);
+    if (h[9] == HC_PROTO_TCP) {
+        f->seq   = rd32(h + 24);
+        f->ack   = rd32(h + 28);
+        f->flags = h[33];
+        f->win   = rd16(h + 34);
+        f->csum  = rd16(h + 36);
+        if (ts_off >= 0) {
+            f->tsval = rd32(h + ts_off);
+            f->tsecr = rd32(h + ts_off + 4);
+        }
+    } else {
+        f->csum = rd16(h + 26);
+    }
+}
+
+/** 把动态字段写进头，总长度为 total，重算 IP 校验和（UDP 长度也由总长度得出） */
+static void hc_put(uint8_t *h, int ts_off, int total, const hc_fields_t *f)
+{
+    wr16(h + 2, (uint16_t)total);
+    wr16(h + 4, f->ipid);
+    if (h[9] == HC_PROTO_TCP) {
+        wr32(h + 24, f->seq);
+        wr32(h + 28, f->ack);
+        h[33] = f->flags;
+        wr16(h + 34, f->win);
+        wr16(h + 36, f->csum);
+        if (ts_off >= 0) {
+            wr32(h + ts_off, f->tsval);
+            wr32(h + ts_off + 4, f->tsecr);
+        }
+    } else {
+        wr16(h + 24, (uint16_t)(total - 20));
+        wr16(h + 26, f->csum);
+    }
+    wr16(h + 10, 0);
+    wr16(h + 10, ip_checksum(h));
+}
+
+/** 32 位字段只发低 16 位时，接收端以上下文为参考能否还原（差值在 ±32K 内） */
+static int lsb16_ok(uint32_t v, uint32_t ref)
+{
+    int32_t d = (int32_t)(v - ref);
+    return d >= -32768 && d <= 32767;
+}
+
+/** 取离参考值最近、低 16 位为 lsb 的值 */
+static uint32_t lsb16_decode(uint32_t ref, uint16_t lsb)
+{
+    return ref + (uint32_t)(int32_t)(int16_t)(uint16_t)(lsb - (uint16_t)ref);
+}
+
+/* ========== 压缩端 ========== */
+
+hdrcomp_tx_t *hdrcomp_tx_create(void)
+{
+    hdrcomp_tx_t *c;
+
+    pthread_once(&crc8_once, crc8_init);
+    c = (hdrcomp_tx_t *)calloc(1, sizeof(hdrcomp_tx_t));
+    if (!c) return NULL;
+    atomic_init(&c->refresh, 0);
+    return c;
+}
+
+void hdrcomp_tx_destroy(hdrcomp_tx_t *c)
+{
+    free(c);
+}
+
+void hdrcomp_tx_refresh(hdrcomp_tx_t *c, int cid)
+{
+    if (!c || cid < 0 || cid >= HDRCOMP_MAX_CONTEXTS)
+        return;
+    atomic_fetch_or(&c->refresh, 1u << cid);
+}
+
+/** 按流（地址、协议、端口）找上下文，没有时返回 -1 并在 *victim 给出可替换的 CID（空闲的或最久未用的） */
+static int tx_lookup(const hdrcomp_tx_t *c, const uint8_t *pkt, int *victim)
+{
+    int i, v = -1;
+
+    for (i = 0; i < HDRCOMP_MAX_CONTEXTS; i++) {
+        const struct hc_ctx *x = &c->ctx[i];
+
+        if (x->valid && x->hdr[9] == pkt[9] && memcmp(x->hdr + 12, pkt + 12, 8) == 0
+            && memcmp(x->hdr + 20, pkt + 20, 4) == 0)
+            return i;
+    }
+    for (i = 0; i < HDRCOMP_MAX_CONTEXTS; i++) {
+        if (!c->ctx[i].valid) {
+            v = i;
+            break;
+        }
+        if (v < 0 || c->ctx[i].last_use < c->ctx[v].last_use)
+            v = i;
+    }
+    *victim = v;
+    return -1;
+}
+
+int hdrcomp_compress(hdrcomp_tx_t *c, const uint8_t *pkt, int len, uint8_t *out, int max_out)
+{
+    uint8_t tmp[HC_MAX_HDR];
+    hc_fields_t f, ref;
+    struct hc_ctx *x;
+    uint8_t *o, flags = 0;
+    int proto, hlen, ts_off, cid, victim;
+
+    if (!c || !pkt || !out || len <= 0 || max_out < len)
+        return -1;
+    proto = hc_parse(pkt, len, &hlen, &ts_off);
+    if (!proto || len + HDRCOMP_IR_OVERHEAD > max_out) {
+        memcpy(out, pkt, len);
+        return len;
+    }
+
+    cid = tx_lookup(c, pkt, &victim);
+    if (cid < 0) {
+        cid = victim;
+        goto ir;
+    }
+    x = &c->ctx[cid];
+    if (atomic_load(&c->refresh) & (1u << cid)) {
+        atomic_fetch_and(&c->refresh, ~(1u << cid));
+        goto ir;
+    }
+    if (x->since_ir >= HDRCOMP_REFRESH_PACKETS || x->hlen != hlen || x->ts_off != ts_off)
+        goto ir;
+
+    /* 上下文的头填入新包的动态字段后应与新包完全相同 */
+    hc_get(pkt, ts_off, &f);
+    hc_get(x->hdr, ts_off, &ref);
+    memcpy(tmp, x->hdr, hlen);
+    hc_put(tmp, ts_off, len, &f);
+    if (memcmp(tmp, pkt, hlen) != 0)
+        goto ir;
+
+    /* 字段变化后连续 HC_REPEAT 个包都带上它：中间丢的包不超过这个数，接收端仍能跟上 */
+    if (f.ipid != ref.ipid) x->rep[HC_IPID] = HC_REPEAT;
+    if (f.seq != ref.seq) x->rep[HC_SEQ] = HC_REPEAT;
+    if (f.ack != ref.ack) x->rep[HC_ACK] = HC_REPEAT;
+    if (f.win != ref.win) x->rep[HC_WIN] = HC_REPEAT;
+    if (f.flags != ref.flags) x->rep[HC_FLAGS] = HC_REPEAT;
+    if (f.tsval != ref.tsval || f.tsecr != ref.tsecr) x->rep[HC_TS] = HC_REPEAT;
+
+    o = out + 4;
+    if (x->rep[HC_IPID] > 0) {
+        x->rep[HC_IPID]--;
+        if ((uint16_t)(f.ipid - ref.ipid) < 128) {   /* 留一半窗口给接收端落后的部分 */
+            flags |= F_IPID8;
+            *o++ = (uint8_t)f.ipid;
+        } else {
+            flags |= F_IPID16;
+            wr16(o, f.ipid);
+            o += 2;
+        }
+    }
+    if (proto == HC_PROTO_TCP) {
+        if (x->rep[HC_SEQ] > 0) {
+            if (!lsb16_ok(f.seq, ref.seq)) goto ir;
+            x->rep[HC_SEQ]--;
+            flags |= F_SEQ;
+            wr16(o, (uint16_t)f.seq);
+            o += 2;
+        }
+        if (x->rep[HC_ACK] > 0) {
+            if (!lsb16_ok(f.ack, ref.ack)) goto ir;
+            x->rep[HC_ACK]--;
+            flags |= F_ACK;
+            wr16(o, (uint16_t)f.ack);
+            o += 2;
+        }
+        if (x->rep[HC_WIN] > 0) {
+            x->rep[HC_WIN]--;
+            flags |= F_WIN;
+            wr16(o, f.win);
+            o += 2;
+        }
+        if (x->rep[HC_FLAGS] > 0) {
+            x->rep[HC_FLAGS]--;
+            flags |= F_FLAGS;
+            *o++ = f.flags;
+        }
+        if (x->rep[HC_TS] > 0) {
+            if (!lsb16_ok(f.tsval, ref.tsval) || !lsb16_ok(f.tsecr, ref.tsecr)) goto ir;
+            x->rep[HC_TS]--;
+            flags |= F_TS;
+            wr16(o, (uint16_t)f.tsval);
+            wr16(o + 2, (uint16_t)f.tsecr);
+            o += 4;
+        }
+    }
+    wr16(o, f.csum);
+    o += 2;
+
+    out[0] = HDRCOMP_CO;
+    out[1] = (uint8_t)cid;
+    out[2] = flags;
+    out[3] = crc8(pkt, hlen);
+    memcpy(o, pkt + hlen, len - hlen);
+    memcpy(x->hdr, pkt, hlen);
+    x->since_ir++;
+    x->last_use = ++c->tick;
+    return (int)(o - out) + len - hlen;
+
+ir:
+    x = &c->ctx[cid];
+    x->valid = 1;
+    memcpy(x->hdr, pkt, hlen);
+    x->hlen = hlen;
+    x->ts_off = ts_off;
+    x->since_ir = 0;
+    memset(x->rep, 0, sizeof(x->rep));
+    x->last_use = ++c->tick;
+    out[0] = HDRCOMP_IR;
+    out[1] = (uint8_t)cid;
+    memcpy(out + HDRCOMP_IR_OVERHEAD, pkt, len);
+    return len + HDRCOMP_IR_OVERHEAD;
+}
+
+/* ========== 解压端 ========== */
+
+hdrcomp_rx_t *hdrcomp_rx_create(void)
+{
+    pthread_once(&crc8_once, crc8_init);
+    return (hdrcomp_rx_t *)calloc(1, sizeof(hdrcomp_rx_t));
+}
+
+void hdrcomp_rx_destroy(hdrcomp_rx_t *d)
+{
+    free(d);
+}
+
+/** 上下文缺失或损坏：丢包，每 HDRCOMP_NACK_EVERY 个请一次刷新 */
+static void rx_miss(hdrcomp_rx_t *d, int cid)
+{
+    if (d->ctx[cid].drops++ % HDRCOMP_NACK_EVERY == 0)
+        d->nack |= 1u << cid;
+}
+
+int hdrcomp_decompress(hdrcomp_rx_t *d, const uint8_t *in, int len, uint8_t *out, int max_out)
+{
+    struct hc_ctx *x;
+    hc_fields_t f;
+    const uint8_t *p, *end;
+    int cid, hlen, ts_off, plen, total;
+    uint8_t flags;
+
+    if (!d || !in || !out || len <= 0)
+        return 0;
+
+    switch (in[0]) {
+    case HDRCOMP_IR:
+        if (len <= HDRCOMP_IR_OVERHEAD || in[1] >= HDRCOMP_MAX_CONTEXTS || len - HDRCOMP_IR_OVERHEAD > max_out)
+            return 0;
+        cid = in[1];
+        in += HDRCOMP_IR_OVERHEAD;
+        len -= HDRCOMP_IR_OVERHEAD;
+        if (!hc_parse(in, len, &hlen, &ts_off))
+            return 0;
+        x = &d->ctx[cid];
+        x->valid = 1;
+        memcpy(x->hdr, in, hlen);
+        x->hlen = hlen;
+        x->ts_off = ts_off;
+        x->drops = 0;
+        d->nack &= ~(1u << cid);
+        memcpy(out, in, len);
+        return len;
+
+    case HDRCOMP_CO:
+        if (len < 4 || in[1] >= HDRCOMP_MAX_CONTEXTS)
+            return 0;
+        cid = in[1];
+        x = &d->ctx[cid];
+        if (!x->valid) {
+            rx_miss(d, cid);
+            return 0;
+        }
+        flags = in[2];
+        p = in + 4;
+        end = in + len;
+        if ((flags & F_TCP_ALL) && x->hdr[9] != HC_PROTO_TCP)
+            return 0;
+        hc_get(x->hdr, x->ts_off, &f);
+        if (end - p < (flags & F_IPID8 ? 1 : 0) + (flags & F_IPID16 ? 2 : 0) + (flags & F_SEQ ? 2 : 0)
+                      + (flags & F_ACK ? 2 : 0) + (flags & F_WIN ? 2 : 0) + (flags & F_FLAGS ? 1 : 0)
+                      + (flags & F_TS ? 4 : 0) + 2)
+            return 0;
+        if (flags & F_IPID8) {
+            /* 取不小于上下文、低 8 位相符的最近值：中间丢了几个包也能还原 */
+            f.ipid = (uint16_t)(f.ipid + (uint8_t)(*p++ - (uint8_t)f.ipid));
+        } else if (flags & F_IPID16) {
+            f.ipid = rd16(p);
+            p += 2;
+        }
+        if (flags & F_SEQ) {
+            f.seq = lsb16_decode(f.seq, rd16(p));
+            p += 2;
+        }
+        if (flags & F_ACK) {
+            f.ack = lsb16_decode(f.ack, rd16(p));
+            p += 2;
+        }
+        if (flags & F_WIN) {
+            f.win = rd16(p);
+            p += 2;
+        }
+        if (flags & F_FLAGS)
+            f.flags = *p++;
+        if (flags & F_TS) {
+            f.tsval = lsb16_decode(f.tsval, rd16(p));
+            f.tsecr = lsb16_decode(f.tsecr, rd16(p + 2));
+            p += 4;
+        }
+        f.csum = rd16(p);
+        p += 2;
+
+        plen = (int)(end - p);
+        total = x->hlen + plen;
+        if (total > max_out)
+            return 0;
+        memcpy(out, x->hdr, x->hlen);
+        hc_put(out, x->ts_off, total, &f);
+        if (crc8(out, x->hlen) != in[3]) {
+            /* 上下文与对端不一致（多半是丢了包）：作废，等 IR */
+            x->valid = 0;
+            rx_miss(d, cid);
+            return 0;
+        }
+        memcpy(out + x->hlen, p, plen);
+        memcpy(x->hdr, out, x->hlen);
+        return total;
+
+    case HDRCOMP_FEEDBACK:
+        return 0;
+
+    default:
+        /* 原样发送的包 */
+        if (len > max_out)
+            return 0;
+        memcpy(out, in, len);
+        return len;
+    }
+}
+
+int hdrcomp_rx_take_nack(hdrcomp_rx_t *d)
+{
+    int cid;
+
+    if (!d || !d->nack)
+        return -1;
+    cid = __builtin_ctz(d->nack);
+    d->nack &= ~(1u << cid);
+    return cid;
+}
+
+int hdrcomp_build_feedback(int cid, uint8_t *out)
+{
+    out[0] = HDRCOMP_FEEDBACK;
+    out[1] = (uint8_t)cid;
+    return HDRCOMP_FEEDBACK_LEN;
+}
+
+int hdrcomp_feedback_cid(const uint8_t *pkt, int len)
+{
+    if (!pkt || len != HDRCOMP_FEEDBACK_LEN || pkt[0] != HDRCOMP_FEEDBACK || pkt[1] >= HDRCOMP_MAX_CONTEXTS)
+        return -1;
+    return pkt[1];
+}
@@ -0,0 +1,244 @@
+/**
+ * lzcomp.c - LZ4 块格式压缩 / 解压，带内置静态字典
+ *
+ * 压缩：字典与输入拼在一个窗口里，每个位置取 4 字节哈希，哈希链上最多比较 LZ_CHAIN_DEPTH 个候选，
+ * 取最长匹配（贪心）。字典部分的哈希头与链只建一次，每次压缩拷一份再接着插入输入的位置。
+ * 解压：偏移超过已输出字节数的部分从字典尾部取。
+ */
+
+#include "lzcomp.h"
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * 静态字典：链路上常见的文本片段。越常用的放得越靠后（与输入的距离近，两端一致即可，不影响格式）。
+ * 改动字典即改变线路格式，收发两端必须同时更新。
+ */
+static const char lz_dict[] =
+    /* 日志 / syslog */
+    " kernel: [ systemd[1]: Started Session  of user root. sshd[ Accepted publickey for "
+    "from  port  ssh2 CRON[ (root) CMD ( DEBUG INFO WARN WARNING ERROR error: failed "
+    "Connection closed by Invalid user Jan Feb Mar Apr May Jun Jul Aug Sep Oct Nov Dec "
+    /* JSON */
+    "{\"id\":\"name\":\"type\":\"value\":\"status\":\"data\":\"time\":\"timestamp\":\"message\":"
+    "\"result\":\"error\":null,\"true,\"false,\"},{\"],\"\":[{\""
+    /* DNS：查询类型 A / AAAA、类 IN，压缩指针指回问题名 */
+    "\x03www\x06google\x03" "com\x00\x00\x01\x00\x01\xc0\x0c\x00\x01\x00\x01"
+    "\x00\x1c\x00\x01\xc0\x0c\x00\x1c\x00\x01\x07" "example\x03" "com\x00\x03org\x00\x03net\x00"
+    /* HTTP */
+    "Mon, Tue, Wed, Thu, Fri, Sat, Sun,  GMT\r\n"
+    "HTTP/1.1 200 OK\r\nHTTP/1.1 404 Not Found\r\nHTTP/1.1 301 Moved Permanently\r\n"
+    "Server: nginx\r\nServer: Apache\r\nDate: Last-Modified: ETag: \"Location: https://"
+    "Cache-Control: no-cache, max-age=0\r\nExpires: Pragma: no-cache\r\nVary: Accept-Encoding\r\n"
+    "Content-Type: text/html; charset=utf-8\r\nContent-Type: application/json\r\n"
+    "Content-Length: Transfer-Encoding: chunked\r\nConnection: keep-alive\r\nConnection: close\r\n"
+    "Set-Cookie: Cookie: ; path=/; HttpOnly\r\nReferer: http://"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) curl/Wget/"
+    "Accept: */*\r\nAccept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\nAccept-Encoding: gzip, deflate\r\n"
+    "GET / HTTP/1.1\r\nPOST /api/ HTTP/1.1\r\nHost: www.\r\n\r\n"
+    "<!DOCTYPE html><html><head><title></title></head><body><div class=\"</div></body></html>";
+
+/** 字典字节数（不含字符串结尾的 0） */
+#define LZ_DICT_LEN  ((int)sizeof(lz_dict) - 1)
+
+#define LZ_HASH_BITS    12
+#define LZ_HASH_SIZE    (1 << LZ_HASH_BITS)
+#define LZ_CHAIN_DEPTH  16
+#define LZ_NONE         0xFFFF
+
+/** 匹配偏移上限（2 字节） */
+#define LZ_MAX_OFFSET   0xFFFF
+
+_Static_assert(sizeof(lz_dict) - 1 + LZ_MAX_INPUT < LZ_NONE,
+               "dictionary plus LZ_MAX_INPUT must fit 16-bit positions");
+
+/** 标记中字面量 / 匹配长度的满值，之后跟续长字节 */
+#define LZ_RUN_MASK  15
+
+static uint16_t g_dict_head[LZ_HASH_SIZE];
+static uint16_t g_dict_prev[LZ_DICT_LEN];
+static pthread_once_t g_dict_once = PTHREAD_ONCE_INIT;
+
+static uint32_t lz_hash(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/** 字典位置的哈希链（只含 4 字节全落在字典内的位置） */
+static void lz_dict_init(void)
+{
+    const uint8_t *d = (const uint8_t *)lz_dict;
+    int i;
+
+    for (i = 0; i < LZ_HASH_SIZE; i++)
+        g_dict_head[i] = LZ_NONE;
+    for (i = 0; i < LZ_DICT_LEN; i++)
+        g_dict_prev[i] = LZ_NONE;
+    for (i = 0; i + LZ_MIN_MATCH <= LZ_DICT_LEN; i++) {
+        uint32_t h = lz_hash(d + i);
+        g_dict_prev[i] = g_dict_head[h];
+        g_dict_head[h] = (uint16_t)i;
+    }
+}
+
+/** 写长度续字节（n 为减去 LZ_RUN_MASK 后的余量）；放不下返回 -1 */
+static int lz_put_run(uint8_t *dst, int *op, int max_out, int n)
+{
+    while (n >= 255) {
+        if (*op >= max_out) return -1;
+        dst[(*op)++] = 255;
+        n -= 255;
+    }
+    if (*op >= max_out) return -1;
+    dst[(*op)++] = (uint8_t)n;
+    return 0;
+}
+
+/**
+ * 写一个序列：lit 个字面量，match_len 为 0 时是最后一个序列（不带偏移）
+ * @return 放不下返回 -1
+ */
+static int lz_put_seq(uint8_t *dst, int *op, int max_out, const uint8_t *lit, int nlit,
+                      int offset, int match_len)
+{
+    int ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+    int tok = (nlit < LZ_RUN_MASK ? nlit : LZ_RUN_MASK) << 4 | (ml < LZ_RUN_MASK ? ml : LZ_RUN_MASK);
+
+    if (*op >= max_out) return -1;
+    dst[(*op)++] = (uint8_t)tok;
+    if (nlit >= LZ_RUN_MASK && lz_put_run(dst, op, max_out, nlit - LZ_RUN_MASK) != 0)
+        return -1;
+    if (nlit > max_out - *op) return -1;
+    memcpy(dst + *op, lit, (size_t)nlit);
+    *op += nlit;
+    if (!match_len)
+        return 0;
+    if (max_out - *op < 2) return -1;
+    dst[(*op)++] = (uint8_t)(offset & 0xFF);
+    dst[(*op)++] = (uint8_t)(offset >> 8);
+    if (ml >= LZ_RUN_MASK && lz_put_run(dst, op, max_out, ml - LZ_RUN_MASK) != 0)
+        return -1;
+    return 0;
+}
+
+int lz_compress(const uint8_t *src, int len, uint8_t *dst, int max_out)
+{
+    uint8_t  win[LZ_DICT_LEN + LZ_MAX_INPUT];
+    uint16_t head[LZ_HASH_SIZE];
+    uint16_t prev[LZ_DICT_LEN + LZ_MAX_INPUT];
+    int i, anchor, end, op = 0;
+
+    if (!src || !dst || len <= 0 || len > LZ_MAX_INPUT || max_out <= 0)
+        return 0;
+    pthread_once(&g_dict_once, lz_dict_init);
+
+    memcpy(win, lz_dict, LZ_DICT_LEN);
+    memcpy(win + LZ_DICT_LEN, src, (size_t)len);
+    memcpy(head, g_dict_head, sizeof(head));
+    memcpy(prev, g_dict_prev, sizeof(g_dict_prev));
+
+    i = anchor = LZ_DICT_LEN;
+    end = LZ_DICT_LEN + len;
+    while (i + LZ_MIN_MATCH <= end) {
+        uint32_t h = lz_hash(win + i);
+        int cand = head[h], depth = LZ_CHAIN_DEPTH, best_len = 0, best_off = 0;
+
+        while (cand != LZ_NONE && depth-- > 0) {
+            if (i - cand > LZ_MAX_OFFSET)
+                break;
+            if (win[cand + best_len] == win[i + best_len] && memcmp(win + cand, win + i, LZ_MIN_MATCH) == 0) {
+                int l = LZ_MIN_MATCH;
+                while (i + l < end && win[cand + l] == win[i + l])
+                    l++;
+                if (l > best_len) {
+                    best_len = l;
+                    best_off = i - cand;
+                    if (i + l == end)
+                        break;
+                }
+            }
+            cand = prev[cand];
+        }
+        prev[i] = head[h];
+        head[h] = (uint16_t)i;
+
+        if (best_len < LZ_MIN_MATCH) {
+            i++;
+            continue;
+        }
+        if (lz_put_seq(dst, &op, max_out, win + anchor, i - anchor, best_off, best_len) != 0)
+            return 0;
+        /* 匹配覆盖的位置也进哈希链，后面的数据可以引用它们 */
+        for (anchor = i + best_len, i++; i < anchor; i++) {
+            if (i + LZ_MIN_MATCH <= end) {
+                h = lz_hash(win + i);
+                prev[i] = head[h];
+                head[h] = (uint16_t)i;
+            }
+        }
+    }
+    if (lz_put_seq(dst, &op, max_out, win + anchor, end - anchor, 0, 0) != 0)
+        return 0;
+    return op;
+}
+
+/** 读长度续字节，累加到 *n；输入不够返回 -1 */
+static int lz_get_run(const uint8_t *src, int len, int *ip, int *n)
+{
+    int b;
+
+    do {
+        if (*ip >= len) return -1;
+        b = src[(*ip)++];
+        *n += b;
+    } while (b == 255);
+    return 0;
+}
+
+int lz_decompress(const uint8_t *src, int len, uint8_t *dst, int max_out)
+{
+    const uint8_t *dict = (const uint8_t *)lz_dict;
+    int ip = 0, op = 0;
+
+    if (!src || !dst || len <= 0 || max_out <= 0)
+        return -1;
+
+    while (ip < len) {
+        int tok = src[ip++];
+        int nlit = tok >> 4, ml = tok & LZ_RUN_MASK, off, ref;
+
+        if (nlit == LZ_RUN_MASK && lz_get_run(src, len, &ip, &nlit) != 0)
+            return -1;
+        if (nlit > len - ip || nlit > max_out - op)
+            return -1;
+        memcpy(dst + op, src + ip, (size_t)nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == len)
+            break;                       /* 最后一个序列只有字面量 */
+
+        if (len - ip < 2)
+            return -1;
+        off = src[ip] | src[ip + 1] << 8;
+        ip += 2;
+        if (ml == LZ_RUN_MASK && lz_get_run(src, len, &ip, &ml) != 0)
+            return -1;
+        ml += LZ_MIN_MATCH;
+        if (off == 0 || off > op + LZ_DICT_LEN || ml > max_out - op)
+            return -1;
+
+        ref = op - off;
+        if (ref >= 0 && off >= ml) {
+            memcpy(dst + op, dst + ref, (size_t)ml);
+            op += ml;
+        } else {
+            /* 引用字典，或与输出重叠（重复串），逐字节拷 */
+            for (; ml > 0; ml--, ref++)
+                dst[op++] = ref < 0 ? dict[LZ_DICT_LEN + ref] : dst[ref];
+        }
+    }
+    return op;
+}
@@ -3,8 +3,11 @@
  *
  * 流程：
  * 1. 打开 TUN、初始化音频、创建调制/解调器
- * 2. 启动 TX 线程：TUN 读 -> 封装 -> 调制 -> 音频写
- * 3. 启动 RX 线程：音频读 -> 解调 -> 找帧/解封装 -> TUN 写
+ * 2. 启动 TX 流水线：TUN 读线程 -> 封装（多个小包聚合成一帧，能压短则压缩，再做纠错编码）线程 -> 调制 / 音频写线程，
+ *    之间用无锁队列传帧描述符；开启 ARQ 时封装线程还负责重发与纯确认帧，开启速率自适应时还发链路质量报告
+ * 3. 启动 RX 线程：音频读 -> 解调 -> 找帧/纠错译码/解封装（含载荷解压） -> ARQ 重排 -> 头解压 -> TUN 写；
+ *    开启速率自适应时测量解调质量、处理对端报告、按宣告切换解调方式与纠错方式
+ *    多声道（--phy channels=2）时每个声道一个调制器、一个解调线程，帧轮流分到空闲的声道上，接收端靠 ARQ 序号重排
  * 4. 主线程等待 Ctrl+C 或信号后清理退出
  */
 
@@ -13,6 +16,12 @@
 #include "audio_dev.h"
 #include "modem.h"
 #include "protocol.h"
+#include "frame_queue.h"
+#include "hdrcomp.h"
+#include "arq.h"
+#include "ratectl.h"
+#include "phy_config.h"
+#include "sample_ring.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,241 +30,881 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <time.h>
+#include <poll.h>
 
 /* 全局运行标志：收到 SIGINT 时置 0，各线程退出 */
 static volatile int g_running = 1;
 
+/* 调制方式：命令行 --mode 选择，收发两端须一致；线程启动前设定，之后只读 */
+static modem_mode_t g_modem_mode = MODEM_MODE_CPFSK;
+
+/* 物理层配置（采样率、波特率、两音、载荷上限，见 phy_config.h）：命令行 --phy / --config 修改，收发两端须一致；
+ * 线程启动前设定，之后只读 */
+static phy_config_t g_phy;
+
+/* 音频后端描述串：命令行 --audio 选择（见 audio_dev.h），NULL 为默认后端 */
+static const char *g_audio_spec = NULL;
+
+/* 发送端载荷压缩（见 protocol_set_compression）：默认打开，命令行 --no-compress 关闭 */
+static int g_compress = 1;
+
+/* 前向纠错方式（见 fec.h）：命令行 --fec 选择，收发两端须一致 */
+static int g_fec = FEC_NONE;
+
+/* 选择重传 ARQ（见 arq.h）：命令行 --arq 打开，收发两端须一致 */
+static int g_arq = 0;
+
+/* 速率自适应的档位表（见 ratectl.h）：命令行 --adapt 用默认表、--ladder 自定义，收发两端须一致；
+ * 档数为 0 即不开启，调制 / 纠错方式固定为 g_modem_mode / g_fec */
+static ratectl_rung_t g_ladder[RATECTL_MAX_RUNGS];
+static int g_ladder_len = 0;
+
+/** 每隔这么多秒打印一次载荷压缩 / 纠错 / ARQ 计数（有新帧时） */
+#define STATS_REPORT_SEC  10
+
 static void signal_handler(int sig)
 {
     (void)sig;
     g_running = 0;
 }
 
+/** TX 流水线描述符个数：TUN 读线程最多领先扬声器这么多个包，池空时暂停读 TUN（包留在内核队列里）；
+ *  也是一个聚合帧最多装的包数 */
+#define TX_POOL_FRAMES    16
+
+/** 上游没有活时各级线程的睡眠时长 (ns) */
+#define TX_STAGE_NAP_NS   500000L
+
+/** TUN 读线程每次等包的超时 (ms)，超时后检查 g_running */
+#define TX_TUN_POLL_MS    100
+
+/** 开启 ARQ 或速率自适应时 TUN 读线程给重发 / 纯确认帧 / 报告留出的描述符数：窗口满时包堆在封装队列里，不能把池占光 */
+#define TX_ARQ_RESERVE    4
+
 /**
- * 将一帧字节转为比特流（每字节 8 比特，高位在前）
- * 用于调制前把 frame 转为 modem_tx_modulate 需要的 bits 数组
+ * TX 流水线：TUN 读 → 封装 → 调制 / 写声卡，各占一个线程，之间用无锁队列传描述符（见 frame_queue.h）
+ * 声卡写阻塞时上游照样读包、封装，调制线程放完一帧立刻接着放下一帧，扬声器在有包排队时不空闲
  */
-static void frame_to_bits(const uint8_t *frame, int frame_len, uint8_t *bits_out, int *nbits_out)
-{
-    int i, b;
-    *nbits_out = frame_len * 8;
-    for (i = 0; i < frame_len; i++) {
-        for (b = 7; b >= 0; b--) {
-            int bit_idx = i * 8 + (7 - b);
-            int byte_idx = bit_idx / 8;
-            int bit_in_byte = 7 - (bit_idx % 8);
-            if (frame[i] & (1 << b))
-                bits_out[byte_idx] |= (1 << bit_in_byte);
-            else
-                bits_out[byte_idx] &= ~(1 << bit_in_byte);
+typedef struct {
+    int            tun_fd;
+    frame_pool_t  *pool;
+    frame_queue_t *framer_q;   /* TUN 读 → 封装 */
+    frame_queue_t *mod_q;      /* 封装 → 调制 */
+    hdrcomp_tx_t  *hc;         /* 头压缩（封装线程用；RX 线程收到对端反馈时请它刷新上下文） */
+    arq_t         *arq;        /* 选择重传，未开启为 NULL（封装、调制、RX 线程共用，内部加锁） */
+    ratectl_t     *rc;         /* 速率自适应，未开启为 NULL（封装、RX 线程共用，内部加锁） */
+} tx_pipeline_t;
+
+static void tx_nap(void)
+{
+    struct timespec ts = { 0, TX_STAGE_NAP_NS };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * TX 第一级：从池里取空描述符，从 TUN 读一个 IP 包进去，交给封装线程
+ * 用 poll 限时等包，Ctrl+C 后不会卡在 read 上
+ */
+static void *tx_reader_func(void *arg)
+{
+    tx_pipeline_t *tp = (tx_pipeline_t *)arg;
+    struct pollfd pfd;
+    frame_desc_t *d = NULL;
+    int n;
+
+    pfd.fd = tp->tun_fd;
+    pfd.events = POLLIN;
+    while (g_running) {
+        if (!d && (((tp->arq || tp->rc) && frame_queue_count(tp->framer_q) >= TX_POOL_FRAMES - TX_ARQ_RESERVE)
+                   || !(d = frame_pool_get(tp->pool)))) {
+            tx_nap();
+            continue;
         }
+        pfd.revents = 0;
+        if (poll(&pfd, 1, TX_TUN_POLL_MS) <= 0) continue;
+        n = tun_read(tp->tun_fd, d->payload, MAX_FRAME_PAYLOAD);
+        if (n <= 0 || n > g_phy.max_payload) continue;   /* 超过载荷上限的包（MTU 没设上时）丢掉 */
+        d->payload_len = n;
+        frame_queue_push(tp->framer_q, d);
+        d = NULL;
     }
+    if (d) frame_pool_put(tp->pool, d);
+    return NULL;
+}
+
+/** 单调时钟 (ns) */
+static int64_t tx_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
 /**
- * TX 线程：从 TUN 读取 IP 包 -> 封装成帧 -> 调制 -> 写入扬声器
+ * 从封装队列取一个包并做头压缩（见 hdrcomp.h）：每个包按到达顺序恰好压缩一次
+ * @return 队列空返回 NULL
  */
-static void *tx_thread_func(void *arg)
-{
-    int tun_fd = *(int *)arg;
-    uint8_t *ip_buf;
-    uint8_t *frame_buf;
-    uint8_t *bits_buf;
-    sample_t *samples_buf;
-    int frame_len, nbits, nsamples, i, written;
-    modem_tx_handle_t mod_tx;
-    audio_handle_t audio = NULL;  /* 由 main 传入更佳，此处简化用全局或参数 */
-    const size_t max_samples = (size_t)(MAX_FRAME_LEN * 8) * SAMPLES_PER_BIT;
-
-    ip_buf    = (uint8_t *)malloc(MAX_FRAME_PAYLOAD);
-    frame_buf = (uint8_t *)malloc(MAX_FRAME_LEN);
-    bits_buf  = (uint8_t *)malloc(MAX_FRAME_LEN + 1);  /* 按字节存比特 */
-    samples_buf = (sample_t *)malloc(max_samples * sizeof(sample_t));
-    mod_tx    = modem_tx_create();
-
-    if (!ip_buf || !frame_buf || !bits_buf || !samples_buf || !mod_tx) {
-        fprintf(stderr, "tx_thread: alloc or modem_tx_create failed\n");
-        if (ip_buf) free(ip_buf);
-        if (frame_buf) free(frame_buf);
-        if (bits_buf) free(bits_buf);
-        if (samples_buf) free(samples_buf);
-        if (mod_tx) modem_tx_destroy(mod_tx);
-        return NULL;
+static frame_desc_t *tx_pop_compressed(tx_pipeline_t *tp)
+{
+    uint8_t buf[MAX_FRAME_PAYLOAD];
+    frame_desc_t *d = frame_queue_pop(tp->framer_q);
+    int n;
+
+    if (d && (n = hdrcomp_compress(tp->hc, d->payload, d->payload_len, buf, MAX_FRAME_PAYLOAD)) > 0) {
+        memcpy(d->payload, buf, n);
+        d->payload_len = n;
     }
+    return d;
+}
 
-    /* 从 main 传过来的参数里拿到 audio 和 tun_fd；这里用全局/静态简化，见下方 */
-    extern audio_handle_t g_audio_handle;
-    audio = g_audio_handle;
+/**
+ * 把封装好的帧按当前的纠错方式编码进描述符：开启速率自适应时用发送档的纠错方式，并计入发帧数
+ * @return 线路帧字节数，失败返回 0
+ */
+static int tx_encode(tx_pipeline_t *tp, const uint8_t *plain, int n, frame_desc_t *d)
+{
+    int fec = g_fec;
 
-    while (g_running && audio) {
-        int n = tun_read(tun_fd, ip_buf, MAX_FRAME_PAYLOAD);
-        if (n <= 0) continue;
+    d->rung = 0;
+    if (tp->rc) {
+        d->rung = ratectl_tx_rung(tp->rc);
+        fec = ratectl_rung(tp->rc, d->rung)->fec;
+    }
+    d->frame_len = n > 0 ? protocol_fec_encode(fec, plain, n, d->frame) : 0;
+    if (d->frame_len > 0 && tp->rc)
+        ratectl_tx_frame(tp->rc);
+    return d->frame_len;
+}
+
+/**
+ * 速率自适应：报告到期或有换档要宣告时发一个报告（宣告用旧档，之后的帧用新档）
+ * @param plain 编码前的帧缓冲区，至少 MAX_FRAME_LEN
+ * @return      交给调制线程一帧返回 1
+ */
+static int tx_ratectl_service(tx_pipeline_t *tp, uint8_t *plain)
+{
+    uint8_t msg[RATECTL_REPORT_BYTES];
+    frame_desc_t *d = frame_pool_get(tp->pool);
+    int n, rung;
+
+    if (!d) return 0;
+    n = ratectl_tx_poll(tp->rc, tx_now_ns(), msg, &rung);
+    if (n > 0 && (n = protocol_encapsulate_control(msg, n, plain)) > 0)
+        d->frame_len = protocol_fec_encode(ratectl_rung(tp->rc, rung)->fec, plain, n, d->frame);
+    if (n <= 0 || d->frame_len <= 0) {
+        frame_pool_put(tp->pool, d);
+        return 0;
+    }
+    d->arq_seq = -1;
+    d->rung = rung;
+    frame_queue_push(tp->mod_q, d);
+    return 1;
+}
+
+/**
+ * ARQ：先发判定丢失的帧（缓存的帧按当前纠错方式重新编码），其次是到期的纯确认帧
+ * @param plain 编码前的帧缓冲区，至少 MAX_FRAME_LEN
+ * @return      交给调制线程一帧返回 1
+ */
+static int tx_arq_service(tx_pipeline_t *tp, uint8_t *plain)
+{
+    uint8_t hdr[ARQ_HDR_BYTES];
+    frame_desc_t *d = frame_pool_get(tp->pool);
+    int n = 0, seq = -1;
 
-        frame_len = protocol_encapsulate(ip_buf, n, frame_buf);
-        if (frame_len <= 0) continue;
+    if (!d) return 0;
+    switch (arq_tx_poll(tp->arq, tx_now_ns(), plain, &n, &seq, hdr)) {
+    case ARQ_POLL_RETRANSMIT:
+        break;
+    case ARQ_POLL_ACK:
+        n = protocol_encapsulate_arq(hdr, NULL, NULL, 0, plain);
+        break;
+    default:
+        n = 0;
+        break;
+    }
+    if (tx_encode(tp, plain, n, d) <= 0) {
+        frame_pool_put(tp->pool, d);
+        return 0;
+    }
+    d->arq_seq = seq;
+    frame_queue_push(tp->mod_q, d);
+    return 1;
+}
 
-        nbits = frame_len * 8;
-        frame_to_bits(frame_buf, frame_len, bits_buf, &nbits);
-        nsamples = modem_tx_modulate(mod_tx, bits_buf, nbits, samples_buf);
-        if (nsamples <= 0) continue;
+/**
+ * TX 第二级：把排队的 IP 包头压缩后封装成帧（同步 + 长度 + 包 + CRC），交给调制线程
+ * 多个小包聚合进一帧（见 common.h 的 FRAME_AGGREGATE），只付一次帧头与 CRC：
+ * 从第一个包起最多等 TX_AGGREGATE_WINDOW_MS，载荷凑满 TX_AGGREGATE_MAX_BYTES（不超过载荷上限）立即发；
+ * 放不下的包留作下一帧的第一个包。聚合帧写在第一个包的描述符里，其余描述符直接还回池；
+ * 整帧载荷压缩后变短就发压缩版（protocol_encapsulate_multi 内完成）；开启纠错时封装后再编码成线路帧。
+ * 开启 ARQ 时先处理重发与纯确认帧，窗口满了不取新包；新帧带 ARQ 头，编码前的帧交给 arq_tx_commit 缓存，
+ * 超过 ARQ_MAX_PACKET 的包按普通帧发。开启速率自适应时报告最先发，每帧按当时的发送档编码
+ */
+static void *tx_framer_func(void *arg)
+{
+    tx_pipeline_t *tp = (tx_pipeline_t *)arg;
+    frame_desc_t *batch[TX_POOL_FRAMES];
+    const uint8_t *pkts[TX_POOL_FRAMES];
+    int lens[TX_POOL_FRAMES];
+    frame_desc_t *next = NULL;    /* 已出队、还没放进任何一帧的包 */
+    uint8_t plain[MAX_FRAME_LEN]; /* 编码前的帧 */
+    uint8_t hdr[ARQ_HDR_BYTES];
+    int count, bytes, i, n, use_arq;
+    const int agg_max = TX_AGGREGATE_MAX_BYTES < g_phy.max_payload ? TX_AGGREGATE_MAX_BYTES : g_phy.max_payload;
+    int64_t deadline;
 
-        /* 按块写入声卡，避免一次写太多 */
-        for (i = 0; i < nsamples && g_running; i += AUDIO_FRAMES_PER_BUFFER) {
-            written = (nsamples - i) < AUDIO_FRAMES_PER_BUFFER ? (nsamples - i) : AUDIO_FRAMES_PER_BUFFER;
-            if (audio_write(audio, samples_buf + i, written) != 0)
+    while (g_running) {
+        if (tp->rc && tx_ratectl_service(tp, plain))
+            continue;
+        if (tp->arq && tx_arq_service(tp, plain))
+            continue;
+        if (tp->arq && !arq_tx_window_open(tp->arq)) {
+            tx_nap();
+            continue;
+        }
+        if (!next && !(next = tx_pop_compressed(tp))) {
+            tx_nap();
+            continue;
+        }
+        batch[0] = next;
+        next = NULL;
+        count = 1;
+        bytes = AGG_ENTRY_BYTES(batch[0]->payload_len);
+        deadline = tx_now_ns() + (int64_t)TX_AGGREGATE_WINDOW_MS * 1000000;
+
+        while (bytes < agg_max && count < TX_POOL_FRAMES) {
+            if (!(next = tx_pop_compressed(tp))) {
+                if (!g_running || tx_now_ns() >= deadline)
+                    break;
+                tx_nap();
+                continue;
+            }
+            if (bytes + AGG_ENTRY_BYTES(next->payload_len) > agg_max)
                 break;
+            bytes += AGG_ENTRY_BYTES(next->payload_len);
+            batch[count++] = next;
+            next = NULL;
         }
-    }
 
-    free(ip_buf);
-    free(frame_buf);
-    free(bits_buf);
-    free(samples_buf);
-    modem_tx_destroy(mod_tx);
+        for (i = 0; i < count; i++) {
+            pkts[i] = batch[i]->payload;
+            lens[i] = batch[i]->payload_len;
+        }
+        use_arq = tp->arq && ARQ_HDR_BYTES + (count > 1 ? bytes : AGG_ENTRY_BYTES(lens[0])) <= g_phy.max_payload;
+        if (use_arq) {
+            arq_tx_prepare(tp->arq, hdr);
+            n = protocol_encapsulate_arq(hdr, pkts, lens, count, plain);
+        } else {
+            n = protocol_encapsulate_multi(pkts, lens, count, plain);
+        }
+        batch[0]->arq_seq = -1;
+        if (tx_encode(tp, plain, n, batch[0]) > 0 && use_arq)
+            batch[0]->arq_seq = arq_tx_commit(tp->arq, plain, n);
+        for (i = 1; i < count; i++)
+            frame_pool_put(tp->pool, batch[i]);
+        if (batch[0]->frame_len <= 0) {
+            frame_pool_put(tp->pool, batch[0]);
+            continue;
+        }
+        frame_queue_push(tp->mod_q, batch[0]);
+    }
+    if (next) frame_pool_put(tp->pool, next);
     return NULL;
 }
 
-/** 接收端比特缓冲：需累积多块解调结果才能凑齐一帧 */
-#define RX_BIT_BUF_BYTES  (MAX_FRAME_LEN * 4)
-#define RX_BIT_BUF_BITS   (RX_BIT_BUF_BYTES * 8)
+/**
+ * 换档：已合成的 fill 帧后补静音写出，再接着写静音，合计不少于 RATECTL_GAP_MS
+ * 对端收到宣告、切换解调器时，新档的第一帧还没开始
+ * @param buf 按声道交错，AUDIO_FRAMES_PER_BUFFER 帧
+ */
+static void tx_write_gap(audio_handle_t audio, sample_t *buf, int fill, int nch)
+{
+    int left = g_phy.sample_rate / 1000 * RATECTL_GAP_MS;
+
+    do {
+        memset(buf + (size_t)fill * nch, 0, (size_t)(AUDIO_FRAMES_PER_BUFFER - fill) * nch * sizeof(sample_t));
+        audio_write(audio, buf, AUDIO_FRAMES_PER_BUFFER);
+        left -= AUDIO_FRAMES_PER_BUFFER - fill;
+        fill = 0;
+    } while (left > 0 && g_running);
+}
+
+/** 调制线程里的一个声道：各有一个调制器，空闲时从同一个调制队列取下一帧（帧轮流分到各声道上） */
+typedef struct {
+    int index;                    /* 声道号 */
+    modem_tx_handle_t mod;
+    frame_desc_t *cur;            /* 正在调制的帧 */
+    sample_t *buf;                /* 本块已合成的采样（只有这个声道） */
+    int fill;                     /* buf 里已合成的采样数 */
+} tx_lane_t;
+
+/**
+ * 帧排进声道的调制器：帧字节按高位先发排列本身就是调制器要的比特流（见 bitstream.h），直接排队，不再转换
+ * 排队失败时丢掉这一帧
+ */
+static void tx_lane_start(tx_pipeline_t *tp, tx_lane_t *ln, frame_desc_t *d)
+{
+    if (modem_tx_queue_bits(ln->mod, d->frame, d->frame_len * 8) != 0) {
+        frame_pool_put(tp->pool, d);
+        return;
+    }
+    ln->cur = d;
+}
 
-/** 从比特流中取出一段转为字节（用于将找到的帧从 bits 转为 frame_buf） */
-static void bits_to_bytes(const uint8_t *bits, int bit_start, int nbytes, uint8_t *bytes_out)
+/**
+ * 把一个声道的本块合成满：一帧放完（ARQ 帧从此计超时、归还描述符）立刻取下一帧，帧与帧之间不留空隙
+ * 取到的帧的档与调制器当前的档（rung）不同时先不开始它，放进 *pending，等各声道都放完再换档；
+ * 有 *pending 时各声道都不再取新帧
+ */
+static void tx_lane_fill(tx_pipeline_t *tp, tx_lane_t *ln, int rung, frame_desc_t **pending)
 {
-    int by, b, bi;
-    for (by = 0; by < nbytes; by++) {
-        bytes_out[by] = 0;
-        for (b = 0; b < 8; b++) {
-            bi = bit_start + by * 8 + b;
-            if (bits[bi / 8] & (1 << (7 - bi % 8)))
-                bytes_out[by] |= (1 << (7 - b));
+    frame_desc_t *d;
+
+    while (ln->fill < AUDIO_FRAMES_PER_BUFFER) {
+        if (!ln->cur) {
+            if (*pending || !(d = frame_queue_pop(tp->mod_q)))
+                return;
+            if (tp->rc && d->rung != rung) {
+                *pending = d;
+                return;
+            }
+            tx_lane_start(tp, ln, d);
+            continue;
+        }
+        ln->fill += modem_tx_next_samples(ln->mod, ln->buf + ln->fill, AUDIO_FRAMES_PER_BUFFER - ln->fill);
+        if (ln->fill < AUDIO_FRAMES_PER_BUFFER) {
+            if (tp->arq && ln->cur->arq_seq >= 0)
+                arq_tx_sent(tp->arq, ln->cur->arq_seq, ln->index, tx_now_ns());
+            frame_pool_put(tp->pool, ln->cur);
+            ln->cur = NULL;
         }
     }
 }
 
-/** 将 src 的 nbits 比特追加到 dest，从 dest_bit_count 位置开始；返回新的 dest 总比特数 */
-static int bits_append(uint8_t *dest, int dest_bit_count, const uint8_t *src, int nbits)
+/**
+ * 各声道本块的采样交错进 out，没合成满的声道补静音，各声道的 fill 清零
+ * @return 帧数，即各声道 fill 的最大值
+ */
+static int tx_mix(tx_lane_t *lanes, int nch, sample_t *out)
 {
-    int i;
-    for (i = 0; i < nbits; i++) {
-        int di = dest_bit_count + i;
-        int si_byte = i / 8, si_bit = 7 - (i % 8);
-        if (src[si_byte] & (1 << si_bit))
-            dest[di / 8] |= (1 << (7 - di % 8));
-        else
-            dest[di / 8] &= ~(1 << (7 - di % 8));
+    int c, i, n = 0;
+
+    for (c = 0; c < nch; c++)
+        if (lanes[c].fill > n)
+            n = lanes[c].fill;
+    for (c = 0; c < nch; c++) {
+        for (i = 0; i < lanes[c].fill; i++)
+            out[i * nch + c] = lanes[c].buf[i];
+        for (; i < n; i++)
+            out[i * nch + c] = 0;
+        lanes[c].fill = 0;
     }
-    return dest_bit_count + nbits;
+    return n;
+}
+
+/** 各声道都没有正在调制的帧时返回 1 */
+static int tx_lanes_idle(const tx_lane_t *lanes, int nch)
+{
+    int c;
+
+    for (c = 0; c < nch; c++)
+        if (lanes[c].cur)
+            return 0;
+    return 1;
 }
 
-/** 从 buf 中移除 [from_bit, from_bit+n_bits) 的比特，将后面的数据前移 */
-static void bits_remove(uint8_t *buf, int *bit_count_inout, int from_bit, int n_bits)
+/**
+ * TX 第三级：帧排进调制器 -> 每次合成一块采样写入扬声器，帧放完归还描述符
+ * 一帧的最后一块不满时先取下一帧把这块填满再写，帧与帧之间不留空隙。
+ * 多声道时每个声道一个调制器，谁空闲谁取调制队列里的下一帧，各声道的采样交错后一起写；
+ * 帧的先后由 ARQ 序号在接收端恢复（见 main 中 channels 与 ARQ 的约定）。
+ * 开启速率自适应时帧的档与上一帧不同，就等各声道放完旧档的帧、留一段静音（tx_write_gap），再一起换调制方式
+ */
+static void *tx_modulator_func(void *arg)
 {
-    int new_count = *bit_count_inout - n_bits;
-    int i;
-    if (new_count <= 0) {
-        *bit_count_inout = 0;
+    tx_pipeline_t *tp = (tx_pipeline_t *)arg;
+    tx_lane_t lanes[AUDIO_MAX_CHANNELS];
+    sample_t *out;                /* 交错后的一块 */
+    frame_desc_t *pending = NULL; /* 等着换档的帧 */
+    int rung = 0;                 /* 调制器当前所处的档（速率自适应） */
+    int nch = g_phy.channels;
+    int c, n, ok;
+    audio_handle_t audio;
+
+    extern audio_handle_t g_audio_handle;
+    audio = g_audio_handle;
+
+    memset(lanes, 0, sizeof(lanes));
+    out = (sample_t *)malloc((size_t)AUDIO_FRAMES_PER_BUFFER * nch * sizeof(sample_t));
+    ok = out != NULL;
+    for (c = 0; c < nch && ok; c++) {
+        lanes[c].index = c;
+        lanes[c].buf = (sample_t *)malloc(AUDIO_FRAMES_PER_BUFFER * sizeof(sample_t));
+        lanes[c].mod = modem_tx_create(&g_phy);
+        ok = lanes[c].buf && lanes[c].mod && modem_tx_set_mode(lanes[c].mod, g_modem_mode) == 0;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "tx_thread: alloc or modem_tx_create failed\n");
+        for (c = 0; c < nch; c++) {
+            free(lanes[c].buf);
+            if (lanes[c].mod) modem_tx_destroy(lanes[c].mod);
+        }
+        free(out);
+        return NULL;
+    }
+
+    while (g_running && audio) {
+        for (c = 0; c < nch; c++)
+            tx_lane_fill(tp, &lanes[c], rung, &pending);
+        if (pending && tx_lanes_idle(lanes, nch)) {
+            /* 各声道都放完了旧档的帧：写出已合成的部分并补静音，再换调制方式、开始新档的帧 */
+            tx_write_gap(audio, out, tx_mix(lanes, nch, out), nch);
+            rung = pending->rung;
+            for (c = 0; c < nch; c++)
+                modem_tx_set_mode(lanes[c].mod, ratectl_rung(tp->rc, rung)->mode);
+            tx_lane_start(tp, &lanes[0], pending);
+            pending = NULL;
+            continue;
+        }
+        if ((n = tx_mix(lanes, nch, out)) == 0) {
+            tx_nap();
+            continue;
+        }
+        if (audio_write(audio, out, n) != 0) {
+            /* 声卡写失败：丢掉各声道正在放的帧剩下的部分 */
+            for (c = 0; c < nch; c++) {
+                if (!lanes[c].cur)
+                    continue;
+                while (modem_tx_next_samples(lanes[c].mod, lanes[c].buf, AUDIO_FRAMES_PER_BUFFER) == AUDIO_FRAMES_PER_BUFFER)
+                    ;
+                frame_pool_put(tp->pool, lanes[c].cur);
+                lanes[c].cur = NULL;
+            }
+        }
+    }
+
+    if (pending) frame_pool_put(tp->pool, pending);
+    for (c = 0; c < nch; c++) {
+        if (lanes[c].cur) frame_pool_put(tp->pool, lanes[c].cur);
+        free(lanes[c].buf);
+        modem_tx_destroy(lanes[c].mod);
+    }
+    free(out);
+    return NULL;
+}
+
+/** 一块音频解调结果的缓冲（字节）：任何调制方式下 AUDIO_FRAMES_PER_BUFFER 个采样都解不出这么多比特 */
+#define RX_DEMOD_BUF_BYTES  MAX_FRAME_LEN
+#define RX_DEMOD_BUF_BITS   (RX_DEMOD_BUF_BYTES * 8)
+
+/**
+ * 把头压缩反馈包送进 TX 流水线（与 TUN 来的包一样走封装、调制）
+ * 池空时放弃：对端的定期刷新或下一次反馈会补上
+ */
+static void tx_send_feedback(tx_pipeline_t *tp, int cid)
+{
+    frame_desc_t *d = frame_pool_get(tp->pool);
+
+    if (!d) return;
+    d->payload_len = hdrcomp_build_feedback(cid, d->payload);
+    frame_queue_push(tp->framer_q, d);
+}
+
+/**
+ * 处理一个收到的载荷：对端的反馈交给本端压缩器，其余解压后写 TUN；
+ * 上下文缺失或 CRC 错时给对端发反馈，请它改发完整头
+ */
+static void rx_deliver(tx_pipeline_t *tp, hdrcomp_rx_t *hc, const uint8_t *payload, int len, uint8_t *ip_buf)
+{
+    int cid, n;
+
+    if ((cid = hdrcomp_feedback_cid(payload, len)) >= 0) {
+        hdrcomp_tx_refresh(tp->hc, cid);
         return;
     }
-    for (i = 0; i < new_count; i++) {
-        int src_i = from_bit + n_bits + i;
-        int dst_i = i;
-        int bit_val = (buf[src_i / 8] & (1 << (7 - src_i % 8))) ? 1 : 0;
-        if (bit_val)
-            buf[dst_i / 8] |= (1 << (7 - dst_i % 8));
-        else
-            buf[dst_i / 8] &= ~(1 << (7 - dst_i % 8));
+    n = hdrcomp_decompress(hc, payload, len, ip_buf, MAX_FRAME_PAYLOAD);
+    if (n > 0)
+        tun_write(tp->tun_fd, ip_buf, n);
+    while ((cid = hdrcomp_rx_take_nack(hc)) >= 0)
+        tx_send_feedback(tp, cid);
+}
+
+/**
+ * ARQ 帧交给 arq_rx_frame（确认推进本端发送窗口，数据进重排缓冲），再把按序可交付的帧逐个拆包交给 rx_deliver
+ * @param buf 收到的帧载荷；arq_rx_frame 已拷走，之后用来放按序取出的子包序列，至少 MAX_FRAME_PAYLOAD
+ */
+static void rx_deliver_arq(tx_pipeline_t *tp, hdrcomp_rx_t *hc, uint8_t *buf, int len, uint8_t *ip_buf)
+{
+    const uint8_t *pkt;
+    int n, k, pos;
+
+    arq_rx_frame(tp->arq, buf, len, tx_now_ns());
+    while ((n = arq_rx_next(tp->arq, buf, MAX_FRAME_PAYLOAD)) > 0)
+        for (pos = 0; (k = protocol_aggregate_next(buf, n, &pos, &pkt)) > 0; )
+            rx_deliver(tp, hc, pkt, k, ip_buf);
+}
+
+/**
+ * 没有开启 ARQ 时收到的 ARQ 帧：跳过 ARQ 头，子包逐个交给 rx_deliver（不重排、不去重，同 protocol_rx_next）
+ */
+static void rx_deliver_arq_plain(tx_pipeline_t *tp, hdrcomp_rx_t *hc, const uint8_t *buf, int len, uint8_t *ip_buf)
+{
+    const uint8_t *pkt;
+    int k, pos = ARQ_HDR_BYTES;
+
+    while ((k = protocol_aggregate_next(buf, len, &pos, &pkt)) > 0)
+        rx_deliver(tp, hc, pkt, k, ip_buf);
+}
+
+/** 多声道时 RX 线程与各声道解调线程之间的采样环容量（采样），约 1.5 秒音频 */
+#define RX_LANE_RING_SAMPLES  (1 << 16)
+
+/** 接收端各声道共用：头解压上下文与交付锁（多声道时各解调线程交出的载荷要一个一个交付） */
+typedef struct {
+    tx_pipeline_t  *tp;
+    hdrcomp_rx_t   *hc;
+    pthread_mutex_t lock;         /* 头解压、ARQ 按序取出、写 TUN 都在锁内 */
+    uint8_t        *ip_buf;       /* 解压后的 IP 包，持锁使用 */
+    volatile int    stop;         /* 置位后各声道解调线程退出（RX 线程收尾或启动失败时，g_running 可能仍为 1） */
+} rx_shared_t;
+
+/** 接收端的一个声道：解调器与组帧器各一个；多声道时在自己的线程里跑，从 ring 取本声道的采样 */
+typedef struct {
+    rx_shared_t       *rs;
+    int                index;     /* 声道号 */
+    modem_rx_handle_t  mod_rx;
+    protocol_rx_t     *deframer;
+    uint8_t           *demod_buf; /* 本次解调得到的一小块比特 */
+    uint8_t           *payload_buf;
+    sample_t          *audio_buf; /* 本声道的一块采样，AUDIO_FRAMES_PER_BUFFER 个 */
+    sample_ring_t     *ring;      /* 多声道时 RX 线程写、本声道的解调线程读；单声道为 NULL */
+    pthread_t          tid;
+    int                rung;      /* 解调器与组帧器当前所用的接收档（速率自适应） */
+    int                fec;
+    unsigned long      frames;    /* 已计入速率自适应的帧数（组帧器的计数） */
+    protocol_fec_stats_t fec_stats;
+    time_t             last_report;
+} rx_lane_t;
+
+/**
+ * 按速率自适应的接收档切换本声道的解调方式与纠错方式（组帧器中的比特一并丢弃）；档没变时什么也不做
+ * 接收档可能由别的声道收到的报告改变，各声道每块采样前都对一次
+ */
+static void rx_apply_rung(rx_lane_t *ln)
+{
+    ratectl_t *rc = ln->rs->tp->rc;
+    int rung = ratectl_rx_rung(rc);
+    const ratectl_rung_t *r = ratectl_rung(rc, rung);
+
+    if (rung == ln->rung)
+        return;
+    modem_rx_set_mode(ln->mod_rx, r->mode);
+    protocol_rx_set_fec(ln->deframer, r->fec);
+    ln->rung = rung;
+    ln->fec = r->fec;
+}
+
+/** 纠错计数有变化时打印帧数、纠正前的误比特率与 RS 纠正 / 失败数（last 为上次打印时的值；多声道时带声道号） */
+static void report_fec_stats(const protocol_rx_t *deframer, int fec, int lane, protocol_fec_stats_t *last)
+{
+    protocol_fec_stats_t st;
+    char name[16] = "";
+
+    if (g_phy.channels > 1)
+        snprintf(name, sizeof(name), " ch%d", lane);
+    protocol_rx_get_fec_stats(deframer, &st);
+    if (st.frames != last->frames || st.failed != last->failed)
+        fprintf(stderr, "fec %s%s: %lu frames (+%lu), channel BER %.2e, RS fixed %lu bytes, %lu uncorrectable\n",
+                fec_mode_name(fec), name, st.frames, st.frames - last->frames,
+                st.coded_bits ? (double)st.bit_errors / st.coded_bits : 0.0, st.rs_fixed, st.failed);
+    *last = st;
+}
+
+/** 组帧器新收完的帧（任何种类，CRC 对了就算）计入速率自适应 */
+static void rx_count_frames(rx_lane_t *ln)
+{
+    unsigned long n = protocol_rx_frame_count(ln->deframer) - ln->frames;
+
+    if (n > 0) {
+        ratectl_rx_frames(ln->rs->tp->rc, n, tx_now_ns());
+        ln->frames += n;
+    }
+}
+
+/** 交付一个数据帧的载荷（持交付锁） */
+static void rx_lane_deliver(rx_lane_t *ln, protocol_rx_kind_t kind, uint8_t *payload, int len)
+{
+    rx_shared_t *rs = ln->rs;
+
+    pthread_mutex_lock(&rs->lock);
+    if (kind == PROTOCOL_RX_ARQ && rs->tp->arq)
+        rx_deliver_arq(rs->tp, rs->hc, payload, len, rs->ip_buf);
+    else if (kind == PROTOCOL_RX_ARQ)
+        rx_deliver_arq_plain(rs->tp, rs->hc, payload, len, rs->ip_buf);
+    else
+        rx_deliver(rs->tp, rs->hc, payload, len, rs->ip_buf);
+    pthread_mutex_unlock(&rs->lock);
+}
+
+/**
+ * 一个声道的一块采样：解调成比特 -> 组帧器（比特环 + 状态机，纠错译码，见 protocol.h）-> 交付
+ * 每块新比特只被状态机看一次，跨块的半帧留在组帧器里。
+ * 开启速率自适应时，一块开始时组帧器已在拼帧、且这块里有帧收完或到块尾仍在拼帧，这块的解调质量才计入
+ * （帧间的静音与噪声不算）；对端的报告交给 ratectl_rx_report，宣告换档或久无帧降档时切换解调与纠错方式
+ */
+static void rx_lane_process(rx_lane_t *ln, const sample_t *samples, int nsamples)
+{
+    tx_pipeline_t *tp = ln->rs->tp;
+    int nbits, payload_len, in_frame, switched = 0;
+    unsigned long block_frames;
+    protocol_rx_kind_t kind;
+    modem_rx_quality_t quality;
+
+    if (tp->rc) {
+        ratectl_rx_poll(tp->rc, tx_now_ns());
+        rx_apply_rung(ln);
+    }
+
+    nbits = modem_rx_demodulate(ln->mod_rx, samples, nsamples, ln->demod_buf, RX_DEMOD_BUF_BITS);
+    if (nbits <= 0) return;
+
+    /* 新比特进环，取出这批比特里完成的所有帧 */
+    in_frame = protocol_rx_in_frame(ln->deframer);
+    block_frames = ln->frames;
+    protocol_rx_push(ln->deframer, ln->demod_buf, nbits);
+    if (tp->arq || tp->rc) {
+        while ((payload_len = protocol_rx_next_link(ln->deframer, ln->payload_buf, MAX_FRAME_PAYLOAD, &kind)) > 0) {
+            if (tp->rc)
+                rx_count_frames(ln);
+            if (kind == PROTOCOL_RX_CONTROL) {
+                if (tp->rc && ratectl_rx_report(tp->rc, ln->payload_buf, payload_len, tx_now_ns()) == 1) {
+                    rx_apply_rung(ln);
+                    switched = 1;
+                }
+            } else {
+                rx_lane_deliver(ln, kind, ln->payload_buf, payload_len);
+            }
+        }
+    } else {
+        while ((payload_len = protocol_rx_next(ln->deframer, ln->payload_buf, MAX_FRAME_PAYLOAD)) > 0)
+            rx_lane_deliver(ln, PROTOCOL_RX_PACKET, ln->payload_buf, payload_len);
+    }
+
+    if (tp->rc) {
+        /* CRC 对了但没交出载荷的帧（如子长度越界的聚合帧）也算收到 */
+        rx_count_frames(ln);
+        modem_rx_take_quality(ln->mod_rx, &quality);
+        if (!switched && in_frame && (ln->frames != block_frames || protocol_rx_in_frame(ln->deframer)))
+            ratectl_rx_quality(tp->rc, &quality);
+    }
+
+    if (ln->fec != FEC_NONE && time(NULL) - ln->last_report >= STATS_REPORT_SEC) {
+        report_fec_stats(ln->deframer, ln->fec, ln->index, &ln->fec_stats);
+        ln->last_report = time(NULL);
+    }
+}
+
+static void rx_lane_free(rx_lane_t *ln)
+{
+    free(ln->demod_buf);
+    free(ln->payload_buf);
+    free(ln->audio_buf);
+    sample_ring_destroy(ln->ring);
+    if (ln->deframer) protocol_rx_destroy(ln->deframer);
+    if (ln->mod_rx) modem_rx_destroy(ln->mod_rx);
+}
+
+/**
+ * 创建一个声道的解调器、组帧器与缓冲区；with_ring 时再建采样环（多声道）
+ * @return 成功 0，失败 -1（已分配的由 rx_lane_free 释放）
+ */
+static int rx_lane_init(rx_lane_t *ln, rx_shared_t *rs, int index, int with_ring)
+{
+    memset(ln, 0, sizeof(*ln));
+    ln->rs          = rs;
+    ln->index       = index;
+    ln->fec         = g_fec;
+    ln->last_report = time(NULL);
+    ln->demod_buf   = (uint8_t *)malloc(RX_DEMOD_BUF_BYTES);
+    ln->payload_buf = (uint8_t *)malloc(MAX_FRAME_PAYLOAD);
+    ln->audio_buf   = (sample_t *)malloc(AUDIO_FRAMES_PER_BUFFER * sizeof(sample_t));
+    ln->ring        = with_ring ? sample_ring_create(RX_LANE_RING_SAMPLES) : NULL;
+    ln->deframer    = protocol_rx_create();
+    ln->mod_rx      = modem_rx_create(&g_phy);
+    if (!ln->demod_buf || !ln->payload_buf || !ln->audio_buf || (with_ring && !ln->ring)
+        || !ln->deframer || !ln->mod_rx)
+        return -1;
+    if (modem_rx_set_mode(ln->mod_rx, g_modem_mode) != 0 || protocol_rx_set_fec(ln->deframer, g_fec) != 0)
+        return -1;
+    ln->frames = protocol_rx_frame_count(ln->deframer);
+    return 0;
+}
+
+/** 多声道时一个声道的解调线程：从本声道的采样环取一块就处理一块，各声道的解调在不同的核上并行 */
+static void *rx_lane_func(void *arg)
+{
+    rx_lane_t *ln = (rx_lane_t *)arg;
+    size_t n;
+
+    while (g_running && !ln->rs->stop) {
+        n = sample_ring_read(ln->ring, ln->audio_buf, AUDIO_FRAMES_PER_BUFFER);
+        if (n == 0) {
+            tx_nap();
+            continue;
+        }
+        rx_lane_process(ln, ln->audio_buf, (int)n);
     }
-    *bit_count_inout = new_count;
+    return NULL;
 }
 
 /**
- * RX 线程：从麦克风读采样 -> 解调成比特 -> 累积 -> 找同步 -> 解封装 -> 写 TUN
+ * 多声道：一块交错的采样拆成各声道，放进各声道解调线程的采样环
+ * 环满（解调线程跟不上）时等它取走，回环后端不按实时节拍，不能丢采样
+ */
+static void rx_split(rx_lane_t *lanes, int nch, const sample_t *buf, int nframes, sample_t *tmp)
+{
+    int c, i;
+    size_t done;
+
+    for (c = 0; c < nch; c++) {
+        for (i = 0; i < nframes; i++)
+            tmp[i] = buf[i * nch + c];
+        for (done = 0; g_running; tx_nap()) {
+            done += sample_ring_write(lanes[c].ring, tmp + done, (size_t)nframes - done);
+            if (done == (size_t)nframes)
+                break;
+        }
+    }
+}
+
+/**
+ * RX 线程：从麦克风读采样 -> 各声道解调、组帧、交付（rx_lane_process）-> ARQ 重排 -> 头解压 -> 写 TUN
+ * 单声道时就在本线程里处理；多声道时每个声道另起一个解调线程，本线程只读声卡、拆声道。
+ * 帧分在各声道上、到达先后不定，ARQ 按序号重排后才交给头解压
  */
 static void *rx_thread_func(void *arg)
 {
-    int tun_fd = *(int *)arg;
-    sample_t *audio_buf;
-    uint8_t *demod_buf;   /* 本次解调得到的一小块比特 */
-    uint8_t *rx_bits_buf; /* 累积的比特流 */
-    uint8_t *frame_buf;
-    uint8_t *payload_buf;
-    int rx_bit_count = 0; /* 当前累积的有效比特数 */
-    int nread, nbits, sync_pos, payload_len;
-    int frame_byte_len, frame_len_bits;
-    modem_rx_handle_t mod_rx;
+    rx_shared_t rs;
+    rx_lane_t lanes[AUDIO_MAX_CHANNELS];
+    sample_t *audio_buf, *split_buf = NULL;
+    int nch = g_phy.channels;
+    int nread, c, ok, started = 0;
     audio_handle_t audio = NULL;
 
     extern audio_handle_t g_audio_handle;
     audio = g_audio_handle;
 
-    audio_buf   = (sample_t *)malloc(AUDIO_FRAMES_PER_BUFFER * sizeof(sample_t));
-    demod_buf   = (uint8_t *)malloc(RX_BIT_BUF_BYTES);
-    rx_bits_buf = (uint8_t *)malloc(RX_BIT_BUF_BYTES);
-    frame_buf   = (uint8_t *)malloc(MAX_FRAME_LEN);
-    payload_buf = (uint8_t *)malloc(MAX_FRAME_PAYLOAD);
-    mod_rx      = modem_rx_create();
+    memset(lanes, 0, sizeof(lanes));
+    rs.tp     = (tx_pipeline_t *)arg;
+    rs.hc     = hdrcomp_rx_create();
+    rs.ip_buf = (uint8_t *)malloc(MAX_FRAME_PAYLOAD);
+    rs.stop   = 0;
+    pthread_mutex_init(&rs.lock, NULL);
+    audio_buf = (sample_t *)malloc((size_t)AUDIO_FRAMES_PER_BUFFER * nch * sizeof(sample_t));
+    if (nch > 1)
+        split_buf = (sample_t *)malloc(AUDIO_FRAMES_PER_BUFFER * sizeof(sample_t));
+    ok = rs.hc && rs.ip_buf && audio_buf && (nch == 1 || split_buf);
+    for (c = 0; c < nch && ok; c++)
+        ok = rx_lane_init(&lanes[c], &rs, c, nch > 1) == 0;
+    for (c = 0; c < nch && ok && nch > 1; c++) {
+        if (pthread_create(&lanes[c].tid, NULL, rx_lane_func, &lanes[c]) != 0) {
+            ok = 0;
+            break;
+        }
+        started++;
+    }
 
-    if (!audio_buf || !demod_buf || !rx_bits_buf || !frame_buf || !payload_buf || !mod_rx) {
+    if (!ok) {
         fprintf(stderr, "rx_thread: alloc or modem_rx_create failed\n");
-        if (audio_buf) free(audio_buf);
-        if (demod_buf) free(demod_buf);
-        if (rx_bits_buf) free(rx_bits_buf);
-        if (frame_buf) free(frame_buf);
-        if (payload_buf) free(payload_buf);
-        if (mod_rx) modem_rx_destroy(mod_rx);
-        return NULL;
+        audio = NULL;
     }
 
     while (g_running && audio) {
         nread = audio_read(audio, audio_buf, AUDIO_FRAMES_PER_BUFFER);
         if (nread <= 0) continue;
+        if (nch == 1)
+            rx_lane_process(&lanes[0], audio_buf, nread);
+        else
+            rx_split(lanes, nch, audio_buf, nread, split_buf);
+    }
 
-        memset(demod_buf, 0, RX_BIT_BUF_BYTES);
-        nbits = modem_rx_demodulate(mod_rx, audio_buf, nread, demod_buf, RX_BIT_BUF_BITS);
-        if (nbits <= 0) continue;
+    rs.stop = 1;
+    for (c = 0; c < started; c++)
+        pthread_join(lanes[c].tid, NULL);
+    for (c = 0; c < nch; c++)
+        rx_lane_free(&lanes[c]);
+    free(audio_buf);
+    free(split_buf);
+    free(rs.ip_buf);
+    if (rs.hc) hdrcomp_rx_destroy(rs.hc);
+    pthread_mutex_destroy(&rs.lock);
+    return NULL;
+}
 
-        /* 追加到累积缓冲区 */
-        if (rx_bit_count + nbits > RX_BIT_BUF_BITS) {
-            /* 缓冲区满，丢弃前半部分以腾出空间 */
-            bits_remove(rx_bits_buf, &rx_bit_count, 0, rx_bit_count / 2);
-        }
-        rx_bit_count = bits_append(rx_bits_buf, rx_bit_count, demod_buf, nbits);
+/** 断流 / 丢采样计数有增加时打印一行（last 为上次打印时的值） */
+static void report_audio_stats(audio_handle_t audio, audio_stats_t *last)
+{
+    audio_stats_t st;
 
-        /* 在累积的比特流中找同步 */
-        sync_pos = protocol_find_sync(rx_bits_buf, rx_bit_count);
-        if (sync_pos < 0) continue;
+    if (audio_get_stats(audio, &st) != 0)
+        return;
+    if (st.underruns != last->underruns || st.overruns != last->overruns)
+        fprintf(stderr, "audio: %lu underruns (+%lu), %lu overruns (+%lu, %lu samples dropped)\n",
+                st.underruns, st.underruns - last->underruns,
+                st.overruns, st.overruns - last->overruns, st.dropped_samples);
+    *last = st;
+}
 
-        /* 需要至少 FRAME_HEADER_LEN 才能读长度字段 */
-        if (sync_pos + FRAME_HEADER_LEN * 8 > rx_bit_count) continue;
+/** 载荷压缩计数有变化时打印压缩率与每 KB 耗时（last 为上次打印时的值） */
+static void report_comp_stats(protocol_comp_stats_t *last)
+{
+    protocol_comp_stats_t st;
 
-        bits_to_bytes(rx_bits_buf, sync_pos, FRAME_HEADER_LEN, frame_buf);
-        frame_byte_len = (frame_buf[SYNC_LEN] << 8) | frame_buf[SYNC_LEN + 1];
-        if (frame_byte_len <= 0 || frame_byte_len > MAX_FRAME_PAYLOAD) {
-            /* 非法长度，丢弃同步字前的比特避免死锁 */
-            bits_remove(rx_bits_buf, &rx_bit_count, 0, sync_pos + SYNC_LEN * 8);
-            continue;
-        }
-        frame_len_bits = (FRAME_HEADER_LEN + frame_byte_len + CRC_BYTES) * 8;
-        if (sync_pos + frame_len_bits > rx_bit_count) continue;
+    protocol_get_comp_stats(&st);
+    if (st.tx_frames != last->tx_frames && st.tx_bytes_out > 0)
+        fprintf(stderr, "compress tx: %lu/%lu frames compressed, ratio %.2f, %.1f us/KB\n",
+                st.tx_compressed, st.tx_frames, (double)st.tx_bytes_in / st.tx_bytes_out,
+                st.tx_ns / 1000.0 * 1024 / st.tx_bytes_in);
+    if (st.rx_frames != last->rx_frames && st.rx_bytes_in > 0)
+        fprintf(stderr, "compress rx: %lu frames decompressed, ratio %.2f, %.1f us/KB\n",
+                st.rx_frames, (double)st.rx_bytes_out / st.rx_bytes_in,
+                st.rx_ns / 1000.0 * 1024 / st.rx_bytes_out);
+    *last = st;
+}
 
-        bits_to_bytes(rx_bits_buf, sync_pos, FRAME_HEADER_LEN + frame_byte_len + CRC_BYTES, frame_buf);
-        payload_len = protocol_decapsulate(frame_buf, FRAME_HEADER_LEN + frame_byte_len + CRC_BYTES,
-                                           payload_buf, MAX_FRAME_PAYLOAD);
-        if (payload_len > 0)
-            tun_write(tun_fd, payload_buf, payload_len);
+/** ARQ 计数有变化时打印收发帧数、重发 / 放弃数与当前 RTO（last 为上次打印时的值） */
+static void report_arq_stats(arq_t *arq, arq_stats_t *last)
+{
+    arq_stats_t st;
 
-        /* 消费掉这一帧对应的比特 */
-        bits_remove(rx_bits_buf, &rx_bit_count, sync_pos, frame_len_bits);
-    }
+    arq_get_stats(arq, &st);
+    if (st.tx_frames != last->tx_frames || st.rx_frames != last->rx_frames || st.tx_acks != last->tx_acks)
+        fprintf(stderr, "arq tx: %lu frames (+%lu), %lu retransmitted (%lu sack, %lu timeout), %lu given up, %lu acks; "
+                "rx: %lu frames, %lu dup, %lu reordered, %lu skipped; srtt %.0f ms, rto %.0f ms\n",
+                st.tx_frames, st.tx_frames - last->tx_frames, st.rtx_sack + st.rtx_timeout, st.rtx_sack,
+                st.rtx_timeout, st.gave_up, st.tx_acks, st.rx_frames, st.rx_dup, st.rx_reordered,
+                st.rx_skipped, st.srtt_ms, st.rto_ms);
+    *last = st;
+}
 
-    free(audio_buf);
-    free(demod_buf);
-    free(rx_bits_buf);
-    free(frame_buf);
-    free(payload_buf);
-    modem_rx_destroy(mod_rx);
-    return NULL;
+/** 打印速率自适应的收发档、对端最近报告的本端信号质量与换档计数 */
+static void report_ratectl_stats(ratectl_t *rc)
+{
+    ratectl_stats_t st;
+    const ratectl_rung_t *tx, *rx;
+
+    ratectl_get_stats(rc, &st);
+    tx = ratectl_rung(rc, st.tx_rung);
+    rx = ratectl_rung(rc, st.rx_rung);
+    fprintf(stderr, "adapt: tx rung %d (%s/%s), rx rung %d (%s/%s); peer sees snr %.1f dB, jitter %.4f, loss %.1f%%; "
+            "%lu up, %lu down, %lu fallbacks, %lu/%lu reports\n",
+            st.tx_rung, modem_mode_name(tx->mode), fec_mode_name(tx->fec),
+            st.rx_rung, modem_mode_name(rx->mode), fec_mode_name(rx->fec),
+            st.peer_snr_db, st.peer_jitter, st.peer_loss * 100.0,
+            st.steps_up, st.steps_down, st.fallbacks, st.reports_tx, st.reports_rx);
 }
 
 /* 全局音频句柄，供 TX/RX 线程使用（也可用参数传递） */
@@ -264,38 +913,145 @@ audio_handle_t g_audio_handle = NULL;
 int main(int argc, char *argv[])
 {
     int tun_fd;
-    pthread_t tx_tid, rx_tid;
+    pthread_t tx_tid[3], rx_tid;
+    tx_pipeline_t txp;
     const char *tun_name = TUN_DEV_NAME;
+    audio_stats_t audio_stats = { 0, 0, 0 };
+    protocol_comp_stats_t comp_stats;
+    arq_stats_t arq_stats;
+    int i, secs = 0;
 
-    if (argc >= 2)
-        tun_name = argv[1];
+    /* 用法：ipo_sound [--mode 调制方式] [--audio 音频后端] [--fec 纠错方式] [--arq] [--adapt | --ladder 档位表]
+     *                 [--config 配置文件] [--phy 物理层参数] [--no-compress] [TUN 名]
+     * --config 与 --phy 按出现顺序叠加在默认配置上 */
+    phy_config_default(&g_phy);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            if (phy_config_load(&g_phy, argv[++i]) != 0)
+                return 1;
+        } else if (strcmp(argv[i], "--phy") == 0 && i + 1 < argc) {
+            if (phy_config_parse(&g_phy, argv[++i]) != 0)
+                return 1;
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            if (modem_mode_from_name(argv[++i], &g_modem_mode) != 0) {
+                fprintf(stderr, "Unknown modem mode: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc) {
+            g_audio_spec = argv[++i];
+        } else if (strcmp(argv[i], "--fec") == 0 && i + 1 < argc) {
+            if (fec_mode_from_name(argv[++i], &g_fec) != 0) {
+                fprintf(stderr, "Unknown FEC mode: %s (none, rs, conv, rs+conv, conv+il, rs+conv+il)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--arq") == 0) {
+            g_arq = 1;
+        } else if (strcmp(argv[i], "--adapt") == 0) {
+            memcpy(g_ladder, ratectl_default_ladder, (size_t)ratectl_default_ladder_len * sizeof(g_ladder[0]));
+            g_ladder_len = ratectl_default_ladder_len;
+        } else if (strcmp(argv[i], "--ladder") == 0 && i + 1 < argc) {
+            if ((g_ladder_len = ratectl_parse_ladder(argv[++i], g_ladder)) < 0) {
+                fprintf(stderr, "Bad ladder: %s (mode:fec[:snr_db],... up to %d rungs)\n", argv[i], RATECTL_MAX_RUNGS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-compress") == 0) {
+            g_compress = 0;
+        } else {
+            tun_name = argv[i];
+        }
+    }
+
+    if (phy_config_check(&g_phy) != 0)
+        return 1;
+    if (g_phy.channels > 1 && !g_arq) {
+        /* 帧分在各声道上，到达先后不定；头解压要求包按序，靠 ARQ 的序号与重排缓冲恢复顺序 */
+        g_arq = 1;
+        fprintf(stderr, "%d channels: ARQ turned on to keep frames from different channels in order\n",
+                g_phy.channels);
+    }
+    if (g_ladder_len > 0) {
+        /* 速率自适应从第 0 档开始，--mode / --fec 不再起作用 */
+        g_modem_mode = g_ladder[0].mode;
+        g_fec = g_ladder[0].fec;
+    }
 
     signal(SIGINT, signal_handler);
+    protocol_set_compression(g_compress);
+    protocol_get_comp_stats(&comp_stats);
 
-    printf("IP over Sound: opening TUN %s, initializing audio...\n", tun_name);
+    printf("IP over Sound: opening TUN %s (modem %s, FEC %s, ARQ %s, adaptive rate %s), initializing audio (%s)...\n",
+           tun_name, modem_mode_name(g_modem_mode), fec_mode_name(g_fec), g_arq ? "on" : "off",
+           g_ladder_len > 0 ? "on" : "off",
+           g_audio_spec ? g_audio_spec : AUDIO_DEFAULT_SPEC);
+    printf("PHY: %d Hz, %d baud, tones %d/%d Hz, MTU %d, %d channel%s\n",
+           g_phy.sample_rate, g_phy.baud_rate, g_phy.freq0, g_phy.freq1, g_phy.max_payload,
+           g_phy.channels, g_phy.channels > 1 ? "s" : "");
     tun_fd = tun_open(tun_name);
     if (tun_fd < 0) {
         fprintf(stderr, "Failed to open TUN. Try: sudo ./ipo_sound\n");
         return 1;
     }
+    if (tun_set_mtu(tun_name, g_phy.max_payload) != 0)
+        fprintf(stderr, "Warning: could not set MTU %d on %s; longer packets will be dropped\n",
+                g_phy.max_payload, tun_name);
 
-    g_audio_handle = audio_init();
+    g_audio_handle = audio_open(g_audio_spec, &g_phy);
     if (!g_audio_handle) {
-        fprintf(stderr, "Failed to init audio (PortAudio).\n");
+        fprintf(stderr, "Failed to init audio (%s).\n", g_audio_spec ? g_audio_spec : AUDIO_DEFAULT_SPEC);
         tun_close(tun_fd);
         return 1;
     }
 
-    pthread_create(&tx_tid, NULL, tx_thread_func, &tun_fd);
-    pthread_create(&rx_tid, NULL, rx_thread_func, &tun_fd);
+    txp.tun_fd   = tun_fd;
+    txp.pool     = frame_pool_create(TX_POOL_FRAMES);
+    txp.framer_q = frame_queue_create(TX_POOL_FRAMES);
+    txp.mod_q    = frame_queue_create(TX_POOL_FRAMES);
+    txp.hc       = hdrcomp_tx_create();
+    txp.arq      = g_arq ? arq_create() : NULL;
+    txp.rc       = g_ladder_len > 0 ? ratectl_create(g_ladder, g_ladder_len, tx_now_ns()) : NULL;
+    if (!txp.pool || !txp.framer_q || !txp.mod_q || !txp.hc || (g_arq && !txp.arq) || (g_ladder_len > 0 && !txp.rc)) {
+        fprintf(stderr, "Failed to allocate TX pipeline.\n");
+        frame_pool_destroy(txp.pool);
+        frame_queue_destroy(txp.framer_q);
+        frame_queue_destroy(txp.mod_q);
+        hdrcomp_tx_destroy(txp.hc);
+        arq_destroy(txp.arq);
+        ratectl_destroy(txp.rc);
+        audio_cleanup(g_audio_handle);
+        tun_close(tun_fd);
+        return 1;
+    }
+
+    if (txp.arq)
+        arq_get_stats(txp.arq, &arq_stats);
+    pthread_create(&tx_tid[0], NULL, tx_reader_func, &txp);
+    pthread_create(&tx_tid[1], NULL, tx_framer_func, &txp);
+    pthread_create(&tx_tid[2], NULL, tx_modulator_func, &txp);
+    pthread_create(&rx_tid, NULL, rx_thread_func, &txp);
 
     printf("Running. Press Ctrl+C to stop.\n");
-    while (g_running)
+    while (g_running) {
         sleep(1);
+        report_audio_stats(g_audio_handle, &audio_stats);
+        if (++secs % STATS_REPORT_SEC == 0) {
+            report_comp_stats(&comp_stats);
+            if (txp.arq)
+                report_arq_stats(txp.arq, &arq_stats);
+            if (txp.rc)
+                report_ratectl_stats(txp.rc);
+        }
+    }
 
     g_running = 0;
-    pthread_join(tx_tid, NULL);
+    for (i = 0; i < 3; i++)
+        pthread_join(tx_tid[i], NULL);
     pthread_join(rx_tid, NULL);
+    frame_pool_destroy(txp.pool);
+    frame_queue_destroy(txp.framer_q);
+    frame_queue_destroy(txp.mod_q);
+    hdrcomp_tx_destroy(txp.hc);
+    arq_destroy(txp.arq);
+    ratectl_destroy(txp.rc);
 
     audio_cleanup(g_audio_handle);
     g_audio_handle = NULL;
@@ -1,14 +1,25 @@
 /**
  * modem.c - FSK 调制解调实现
  *
- * 调制：每个比特对应 SAMPLES_PER_BIT 个采样，0 用 FSK_FREQ_0 Hz 正弦，1 用 FSK_FREQ_1 Hz 正弦
- * 解调：对每比特时长内的采样做简单鉴频（能量或过零），判 0/1
+ * 调制：每个比特约 采样率/波特率 个采样（分数定时），0 用 f0 正弦，1 用 f1 正弦
+ *       默认单相位累加器连续相位 (CPFSK)；另有 MSK / GMSK（以两音中点为中心、±baud/4 频偏），
+ *       以及载波为两音中点的单载波 DBPSK / DQPSK（每符号 1 / 2 比特）
+ * 解调：FSK/CPFSK 对每比特时长内的采样做鉴频判 0/1，可选过零计数或正交相关能量检测（默认）；
+ *       MSK/GMSK 用比特边界处的基带相位做 1 比特差分检测；DBPSK/DQPSK 比较相邻符号的基带相位（差分检测，无需载波恢复）
+ * 采样率、波特率、两音频率来自创建时的 phy_config_t（默认为 common.h 中的宏），由此推出的窗口长度等存在句柄里；
+ * 解调的逐比特循环对默认的 44100 / 48000 Hz、1200 baud 各编译一份常量特化的内核（窗口长度是常量，
+ * 相关累加可以完全展开），创建时按配置选用，其他配置走读句柄参数的通用内核。
  */
 
 #include "modem.h"
+#include "mtone.h"
 #include "common.h"
+#include "phy_config.h"
+#include "nco.h"
+#include "bitstream.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
 
 #ifndef M_PI
@@ -16,34 +27,400 @@
 #endif
 
 /* ========== 调制器：内部保存相位，保证波形连续 ========== */
+
+/** 振幅 0.3 避免削顶 */
+#define TX_AMPLITUDE  0.3f
+
+/** GMSK 频率脉冲表分辨率（每比特点数），脉冲截断到 ±1.5 比特 */
+#define GMSK_PULSE_RES   64
+#define GMSK_PULSE_SPAN  3
+#define GMSK_PULSE_LEN   (GMSK_PULSE_SPAN * GMSK_PULSE_RES + 1)
+
+/** 早/迟门偏移（采样）：在判决窗口前后各错开每比特采样数的这么多分之一比较能量 */
+#define TIMING_GATE_DIV  8
+
+/**
+ * 由采样率、波特率与两音频率推出的物理层参数，收发两端各存一份（见 phy_make）
+ */
+struct modem_phy {
+    int    rate;         /* 采样率 (Hz) */
+    int    baud;         /* 符号率 (baud) */
+    int    f0, f1;       /* FSK / CPFSK 两音 (Hz) */
+    int    center;       /* MSK / GMSK 中心频率、DBPSK / DQPSK 载波 (Hz)：两音中点 */
+    double spb_f;        /* 每比特精确采样数 */
+    int    spb;          /* 每比特整数采样数（向下取整），即判决窗口长度 */
+    int    spb_max;      /* 每比特最多采样数（向上取整） */
+    int    gate;         /* 早/迟门偏移（采样） */
+    /**
+     * MSK 基带相位积分窗口长度（采样）：取下变频后 2 倍中心频率镜像的一个周期，
+     * 矩形窗的第一个零点正好落在镜像上；否则镜像残留随载波相位逐比特变化，把定时环路拖着漂
+     */
+    int    msk_win;
+    /**
+     * DBPSK/DQPSK 每符号末尾相位恒定段的长度（采样），接收端只在这一段积分；
+     * 符号开头其余约 1/3 符号是从上一符号相位到本符号相位的升余弦过渡，避免相位突跳展宽频谱。
+     * 取下变频后 2 倍载波镜像周期的 2 倍，积分窗正好抵消镜像（同 msk_win）
+     */
+    int    dpsk_win;
+    double dpsk_offset;  /* DPSK 积分窗相对符号起点的偏移：符号末尾 dpsk_win 个采样 */
+    int    lookback;     /* 比特起点之前需保留的采样数：早门偏移 + MSK 边界窗口的前半 */
+};
+
+/**
+ * 推出物理层参数；参数为常量时内联展开后每个字段都是常量，特化内核靠它把窗口长度折叠进代码
+ */
+static inline __attribute__((always_inline)) struct modem_phy phy_make(int rate, int baud, int f0, int f1)
+{
+    struct modem_phy p;
+
+    p.rate = rate;
+    p.baud = baud;
+    p.f0 = f0;
+    p.f1 = f1;
+    p.center = (f0 + f1) / 2;
+    p.spb_f = (double)rate / baud;
+    p.spb = rate / baud;
+    p.spb_max = (rate + baud - 1) / baud;
+    p.gate = p.spb / TIMING_GATE_DIV;
+    p.msk_win = (rate + p.center) / (2 * p.center);
+    p.dpsk_win = 2 * p.msk_win;
+    p.dpsk_offset = p.spb_f - p.dpsk_win;
+    p.lookback = p.gate + p.msk_win / 2 + 1;
+    return p;
+}
+
+/** 取配置（NULL 为默认配置）并检查，合法时推出物理层参数 */
+static int phy_from_config(const phy_config_t *cfg, struct modem_phy *p, int *force_generic)
+{
+    phy_config_t def;
+
+    if (!cfg) {
+        phy_config_default(&def);
+        cfg = &def;
+    }
+    if (phy_config_check(cfg) != 0)
+        return -1;
+    *p = phy_make(cfg->sample_rate, cfg->baud_rate, cfg->freq0, cfg->freq1);
+    *force_generic = cfg->force_generic;
+    return 0;
+}
+
 struct modem_tx {
-    double phase0;  /* 当前 0 载波相位 (弧度) */
-    double phase1;  /* 当前 1 载波相位 (弧度) */
+    modem_mode_t mode;  /* 调制方式 */
+    struct modem_phy phy;  /* 采样率、波特率、频率及推出的参数 */
+    nco_t osc0;  /* 0 载波振荡器（相位与增量，见 nco.h） */
+    nco_t osc1;  /* 1 载波振荡器 */
+    /** 连续相位模式 (CPFSK/MSK/GMSK) 下两个载波共用的唯一相位 */
+    uint32_t phase;
+    /**
+     * 分数定时累加器：每比特加采样率，够一个波特率就出一个采样。
+     * 用整数余数而非浮点累加，跨多次调用也严格无漂移（44100/1200 时 36、37 交替，均值 36.75）
+     */
+    int timing_acc;
+
+    uint32_t center_step;       /* 中心频率每采样相位增量（GMSK 中心频率、DPSK 载波） */
+
+    /* ---- GMSK ---- */
+    double gmsk_dev_step;       /* 最大频偏 (baud/4) 每采样相位增量 */
+    int gmsk_prev;              /* 上一比特 (+1/-1)，0 表示尚无历史 */
+    /** 高斯滤波后的矩形频率脉冲 p(t)，t 以比特为单位、范围 [-1.5, 1.5]，积分为 1（即每比特 ±π/2 相位） */
+    float gmsk_pulse[GMSK_PULSE_LEN];
+
+    /* ---- DBPSK / DQPSK ---- */
+    int dpsk_q;                 /* 当前符号的绝对相位（1/4 周为单位，0~3） */
+    float dpsk_re, dpsk_im;     /* 上一符号的基带相量，从静音开始时为 0 */
+
+    /** 多音模式 (MFSK / OFDM) 的发送引擎，二进制模式下为 NULL */
+    mtone_tx_t *mt;
+
+    /* ---- 流式发送（modem_tx_queue_bits / modem_tx_next_samples）---- */
+    uint8_t q_bits[MODEM_TX_QUEUE_BITS / 8];  /* 排队的一段比特 */
+    int q_nbits;                /* 该段比特数 */
+    int q_pos;                  /* 下一符号首比特的下标，-1 为段首的参考符号；>= q_nbits 表示已调制完 */
+    sample_t *sym;              /* 最近合成的一个符号，sym_max 个采样 */
+    int sym_max;                /* 任一模式下一个符号最多的采样数 */
+    int sym_len;                /* 其采样数 */
+    int sym_pos;                /* 其中已输出的采样数 */
+};
+
+/** 调制方式名字，下标为 modem_mode_t */
+static const char *const mode_names[MODEM_MODE_COUNT] = {
+    "fsk", "cpfsk", "msk", "gmsk", "mfsk16", "mfsk32", "ofdm-dbpsk", "ofdm-dqpsk", "dbpsk", "dqpsk"
 };
 
-modem_tx_handle_t modem_tx_create(void)
+int modem_mode_from_name(const char *name, modem_mode_t *mode)
+{
+    int m;
+
+    if (!name || !mode)
+        return -1;
+    for (m = 0; m < MODEM_MODE_COUNT; m++) {
+        if (strcasecmp(name, mode_names[m]) == 0) {
+            *mode = (modem_mode_t)m;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *modem_mode_name(modem_mode_t mode)
+{
+    if (mode < MODEM_MODE_FSK || mode >= MODEM_MODE_COUNT)
+        return "?";
+    return mode_names[mode];
+}
+
+/** 单载波差分 PSK：DBPSK 或 DQPSK */
+static int mode_is_dpsk(modem_mode_t mode)
+{
+    return mode == MODEM_MODE_DBPSK || mode == MODEM_MODE_DQPSK;
+}
+
+/** DBPSK/DQPSK 每符号比特数，其他模式为每比特一个符号 */
+static int dpsk_bits_per_symbol(modem_mode_t mode)
+{
+    return mode == MODEM_MODE_DQPSK ? 2 : 1;
+}
+
+/** 取某调制方式下比特 0 / 1 的载波频率（DPSK 两者都是载波频率） */
+static void mode_tone_freqs(const struct modem_phy *p, modem_mode_t mode, double *f0, double *f1)
+{
+    if (mode_is_dpsk(mode)) {
+        *f0 = *f1 = p->center;
+    } else if (mode == MODEM_MODE_MSK || mode == MODEM_MODE_GMSK) {
+        /* MSK：调制指数 h = 0.5，两音相距 baud/2，是连续相位正交的最小间隔 */
+        *f0 = p->center - p->baud / 4.0;
+        *f1 = p->center + p->baud / 4.0;
+    } else {
+        *f0 = p->f0;
+        *f1 = p->f1;
+    }
+}
+
+/** 高斯滤波器 (BT = GMSK_BT) 与一个比特宽矩形卷积得到的频率脉冲 */
+static void gmsk_pulse_init(float *pulse)
+{
+    const double sigma = sqrt(log(2.0)) / (2.0 * M_PI * GMSK_BT);
+    int i;
+
+    for (i = 0; i < GMSK_PULSE_LEN; i++) {
+        double t = (double)i / GMSK_PULSE_RES - GMSK_PULSE_SPAN / 2.0;
+        pulse[i] = (float)(0.5 * (erf((t + 0.5) / (M_SQRT2 * sigma))
+                                - erf((t - 0.5) / (M_SQRT2 * sigma))));
+    }
+}
+
+modem_tx_handle_t modem_tx_create(const phy_config_t *cfg)
 {
     struct modem_tx *tx = (struct modem_tx *)calloc(1, sizeof(struct modem_tx));
+    int force_generic;
+
+    if (!tx) return NULL;
+    if (phy_from_config(cfg, &tx->phy, &force_generic) != 0) {
+        free(tx);
+        return NULL;
+    }
+    tx->sym_max = MTONE_MAX_SYMBOL_SAMPLES > tx->phy.spb_max ? MTONE_MAX_SYMBOL_SAMPLES : tx->phy.spb_max;
+    tx->sym = (sample_t *)malloc((size_t)tx->sym_max * sizeof(sample_t));
+    if (!tx->sym) {
+        free(tx);
+        return NULL;
+    }
+    gmsk_pulse_init(tx->gmsk_pulse);
+    tx->center_step = nco_step(tx->phy.center, tx->phy.rate);
+    tx->gmsk_dev_step = tx->phy.baud / 4.0 / tx->phy.rate * 4294967296.0;
+    modem_tx_set_mode(tx, MODEM_MODE_CPFSK);
     return (modem_tx_handle_t)tx;
 }
 
-/* 生成一段正弦波，振幅 0.3 避免削顶，并更新相位 */
-/** 这边sample_t *out是输出采样缓冲区，out[i]是第i个采样，out[i]的类型是sample_t，即浮点数。定义时不区分是一个采样还是多个采样的第一个，在调用前要预先分配足够空间。*/
-static void gen_sine(double freq, int nsamples, sample_t *out,
-                     double *phase_inout)
+int modem_tx_set_mode(modem_tx_handle_t h, modem_mode_t mode)
+{
+    struct modem_tx *tx = (struct modem_tx *)h;
+    mtone_tx_t *mt = NULL;
+    double f0, f1;
+
+    if (!tx || mode < MODEM_MODE_FSK || mode >= MODEM_MODE_COUNT)
+        return -1;
+    if (mtone_is_mode(mode)) {
+        mt = mtone_tx_create(mode);
+        if (!mt)
+            return -1;
+    }
+    mtone_tx_destroy(tx->mt);
+    tx->mt = mt;
+    tx->mode = mode;
+    tx->q_nbits = tx->q_pos = 0;
+    tx->sym_len = tx->sym_pos = 0;
+    if (mt)
+        return 0;
+    mode_tone_freqs(&tx->phy, mode, &f0, &f1);
+    nco_init(&tx->osc0, f0, tx->phy.rate);
+    nco_init(&tx->osc1, f1, tx->phy.rate);
+    tx->gmsk_prev = 0;
+    tx->dpsk_q = 0;
+    tx->dpsk_re = tx->dpsk_im = 0.0f;
+    return 0;
+}
+
+/** 查 GMSK 脉冲表，t 超出 [-1.5, 1.5] 视为 0 */
+static float gmsk_pulse_at(const struct modem_tx *tx, double t)
+{
+    int idx = (int)((t + GMSK_PULSE_SPAN / 2.0) * GMSK_PULSE_RES + 0.5);
+    if (idx < 0 || idx >= GMSK_PULSE_LEN)
+        return 0.0f;
+    return tx->gmsk_pulse[idx];
+}
+
+/**
+ * GMSK 一个比特：瞬时频偏 = Σ a_k p(t - k)，只有前一、当前、后一比特的脉冲落在本比特内。
+ * 相位逐采样累加（频率每个采样都在变，无法用固定步长的 SIMD 振荡器）。
+ */
+static void gmsk_gen_bit(struct modem_tx *tx, int a_prev, int a_cur, int a_next,
+                         int n, sample_t *out)
 {
-    double phase = *phase_inout;
-    double step = 2.0 * M_PI * freq / SAMPLE_RATE;
     int i;
+    for (i = 0; i < n; i++) {
+        double t = ((double)i + 0.5) / n - 0.5;  /* 相对本比特中心的位置（比特） */
+        float f = a_prev * gmsk_pulse_at(tx, t + 1.0)
+                + a_cur  * gmsk_pulse_at(tx, t)
+                + a_next * gmsk_pulse_at(tx, t - 1.0);
+        out[i] = TX_AMPLITUDE * nco_sin(tx->phase);
+        tx->phase += tx->center_step + (uint32_t)(int32_t)lrint(tx->gmsk_dev_step * f);
+    }
+}
 
-    for (i = 0; i < nsamples; i++) {
-        out[i] = (sample_t)(0.3 * sin(phase));
-        phase += step;
+int modem_tx_max_samples(modem_tx_handle_t h, int nbits)
+{
+    struct modem_tx *tx = (struct modem_tx *)h;
+
+    if (!tx || nbits <= 0)
+        return 0;
+    if (tx->mt)
+        return mtone_tx_max_samples(tx->mode, nbits);
+    if (mode_is_dpsk(tx->mode)) {
+        int bps = dpsk_bits_per_symbol(tx->mode);
+        return ((nbits + bps - 1) / bps + 1) * tx->phy.spb_max;
+    }
+    return nbits * tx->phy.spb_max;
+}
+
+/** DQPSK 格雷映射：比特对 (b0 b1) → 相位增量（1/4 周），00→0，01→+90°，11→180°，10→-90° */
+static const int dqpsk_turns[4] = { 0, 1, 3, 2 };
+
+/**
+ * DBPSK/DQPSK 的一个符号：每段先发一个不带数据的参考符号 (idx = -1) 作为差分起点，之后每符号相位在上一符号基础上
+ * 转 0/180°（DBPSK，1 翻转）或按 dqpsk_turns 转（DQPSK，末尾不足 2 比特补 0）。
+ * 符号开头 n - dpsk_win 个采样按升余弦从上一相量过渡到本相量（逐采样查表），
+ * 其余相位恒定，直接用 NCO 的 SIMD 路径生成：Re(e^{jqπ/2} e^{jθ}) = sin(θ + (q+1)π/2)
+ */
+static int dpsk_symbol(struct modem_tx *tx, const uint8_t *bits, int nbits, int idx, sample_t *out)
+{
+    static const float quarter_re[4] = { 1.0f, 0.0f, -1.0f, 0.0f };
+    static const float quarter_im[4] = { 0.0f, 1.0f, 0.0f, -1.0f };
+    const int win = tx->phy.dpsk_win;
+    int q = tx->dpsk_q, n, ramp, i, out_idx = 0;
+    float cr, ci;
+    uint32_t offset;
+
+    if (idx >= 0) {
+        if (dpsk_bits_per_symbol(tx->mode) == 1)
+            q += bs_get_bit(bits, (size_t)idx) ? 2 : 0;
+        else if (idx + 1 < nbits)
+            q += dqpsk_turns[bs_read(bits, (size_t)idx, 2)];
+        else
+            q += dqpsk_turns[bs_get_bit(bits, (size_t)idx) << 1];
+        q &= 3;
+    }
+    cr = quarter_re[q];
+    ci = quarter_im[q];
+
+    tx->timing_acc += tx->phy.rate;
+    n = tx->timing_acc / tx->phy.baud;
+    tx->timing_acc -= n * tx->phy.baud;
+
+    /* 过渡段：z = prev + (cur - prev)·w，w = (1 - cos(π(i+0.5)/ramp)) / 2，输出 Re(z·e^{jθ}) */
+    ramp = n - win;
+    for (i = 0; i < ramp; i++) {
+        float w = 0.5f - 0.5f * nco_cos((uint32_t)(((uint64_t)(2 * i + 1) << 30) / (uint64_t)ramp));
+        float zr = tx->dpsk_re + (cr - tx->dpsk_re) * w;
+        float zi = tx->dpsk_im + (ci - tx->dpsk_im) * w;
+        out[out_idx++] = TX_AMPLITUDE * (zr * nco_cos(tx->phase) - zi * nco_sin(tx->phase));
+        tx->phase += tx->center_step;
     }
-    /* 归一化到 [0, 2π) 避免累积误差 */
-    while (phase >= 2.0 * M_PI) phase -= 2.0 * M_PI;
-    while (phase < 0) phase += 2.0 * M_PI;
-    *phase_inout = phase;
+
+    offset = (uint32_t)(q + 1) << 30;
+    tx->osc0.phase = tx->phase + offset;
+    nco_generate(&tx->osc0, TX_AMPLITUDE, win, out + out_idx);
+    tx->phase = tx->osc0.phase - offset;
+    out_idx += win;
+
+    tx->dpsk_q = q;
+    tx->dpsk_re = cr;
+    tx->dpsk_im = ci;
+    return out_idx;
+}
+
+/**
+ * 二进制模式（FSK / CPFSK / MSK / GMSK）的一个符号即一个比特，没有参考符号
+ * 每比特采样数由分数定时累加器决定
+ */
+static int binary_symbol(struct modem_tx *tx, const uint8_t *bits, int nbits, int idx, sample_t *out)
+{
+    int bit, n;
+    nco_t *osc;
+
+    if (idx < 0)
+        return 0;
+    tx->timing_acc += tx->phy.rate;
+    n = tx->timing_acc / tx->phy.baud;
+    tx->timing_acc -= n * tx->phy.baud;
+
+    bit = bs_get_bit(bits, (size_t)idx);
+    osc = bit ? &tx->osc1 : &tx->osc0;
+    switch (tx->mode) {
+    case MODEM_MODE_FSK:
+        /* 两个载波各自保持相位，比特跳变处相位不连续 */
+        nco_generate(osc, TX_AMPLITUDE, n, out);
+        break;
+    case MODEM_MODE_CPFSK:
+    case MODEM_MODE_MSK:
+        /* 只换频率不换相位：从共用相位继续 */
+        osc->phase = tx->phase;
+        nco_generate(osc, TX_AMPLITUDE, n, out);
+        tx->phase = osc->phase;
+        break;
+    case MODEM_MODE_GMSK: {
+        int a_cur = bit ? 1 : -1;
+        /* 本段最后一比特之后的数据未知，按“与当前相同”处理（帧尾之后本就是静音） */
+        int a_next = (idx + 1 < nbits) ? (bs_get_bit(bits, (size_t)idx + 1) ? 1 : -1) : a_cur;
+        int a_prev = tx->gmsk_prev ? tx->gmsk_prev : a_cur;
+        gmsk_gen_bit(tx, a_prev, a_cur, a_next, n, out);
+        tx->gmsk_prev = a_cur;
+        break;
+    }
+    default:
+        return 0;
+    }
+    return n;
+}
+
+/**
+ * 调制一段比特中的一个符号：idx 为符号首比特下标，-1 为段首参考符号（没有参考符号的模式返回 0）
+ * out 至少 sym_max 个采样
+ */
+static int tx_symbol(struct modem_tx *tx, const uint8_t *bits, int nbits, int idx, sample_t *out)
+{
+    if (tx->mt)
+        return mtone_tx_symbol(tx->mt, bits, nbits, idx, out);
+    if (mode_is_dpsk(tx->mode))
+        return dpsk_symbol(tx, bits, nbits, idx, out);
+    return binary_symbol(tx, bits, nbits, idx, out);
+}
+
+/** 每符号比特数 */
+static int tx_bits_per_symbol(const struct modem_tx *tx)
+{
+    return tx->mt ? mtone_bits_per_symbol(tx->mode) : dpsk_bits_per_symbol(tx->mode);
 }
 
 /**
@@ -53,93 +430,630 @@ static void gen_sine(double freq, int nsamples, sample_t *out,
 int modem_tx_modulate(modem_tx_handle_t h, const uint8_t *bits, int nbits, sample_t *out_buf)
 {
     struct modem_tx *tx = (struct modem_tx *)h;
-    int i, bit_idx, byte_idx, bit_in_byte;
-    int out_idx = 0;
+    int idx, bps, out_idx;
 
     if (!tx || !bits || !out_buf || nbits <= 0)
         return 0;
+    bps = tx_bits_per_symbol(tx);
+    out_idx = tx_symbol(tx, bits, nbits, -1, out_buf);
+    for (idx = 0; idx < nbits; idx += bps)
+        out_idx += tx_symbol(tx, bits, nbits, idx, out_buf + out_idx);
+    return out_idx;
+}
 
-    for (bit_idx = 0; bit_idx < nbits; bit_idx++) {
-        byte_idx   = bit_idx / 8;
-        bit_in_byte = 7 - (bit_idx % 8);
-        if (bits[byte_idx] & (1 << bit_in_byte))
-            gen_sine(FSK_FREQ_1, SAMPLES_PER_BIT, out_buf + out_idx, &tx->phase1);
-        else
-            gen_sine(FSK_FREQ_0, SAMPLES_PER_BIT, out_buf + out_idx, &tx->phase0);
-        out_idx += SAMPLES_PER_BIT;
+int modem_tx_queue_bits(modem_tx_handle_t h, const uint8_t *bits, int nbits)
+{
+    struct modem_tx *tx = (struct modem_tx *)h;
+
+    if (!tx || !bits || nbits <= 0 || nbits > MODEM_TX_QUEUE_BITS)
+        return -1;
+    if (tx->q_pos < tx->q_nbits)
+        return -1;   /* 上一段还没调制完 */
+    memcpy(tx->q_bits, bits, (size_t)(nbits + 7) / 8);
+    tx->q_nbits = nbits;
+    tx->q_pos = -1;
+    return 0;
+}
+
+/** 合成排队比特的下一个符号到 out（至少 sym_max 个采样），返回采样数；已调制完返回 -1 */
+static int tx_next_symbol(struct modem_tx *tx, sample_t *out)
+{
+    while (tx->q_pos < tx->q_nbits) {
+        int n = tx_symbol(tx, tx->q_bits, tx->q_nbits, tx->q_pos, out);
+        tx->q_pos = tx->q_pos < 0 ? 0 : tx->q_pos + tx_bits_per_symbol(tx);
+        if (n > 0)
+            return n;
     }
-    return out_idx;
+    return -1;
+}
+
+int modem_tx_next_samples(modem_tx_handle_t h, sample_t *out, int n)
+{
+    struct modem_tx *tx = (struct modem_tx *)h;
+    int done = 0;
+
+    if (!tx || !out || n <= 0)
+        return 0;
+    while (done < n) {
+        int k;
+
+        if (tx->sym_pos == tx->sym_len) {
+            /* 剩余空间放得下一整个符号时直接合成到 out，省一次拷贝 */
+            if (n - done >= tx->sym_max) {
+                k = tx_next_symbol(tx, out + done);
+                if (k < 0)
+                    break;
+                done += k;
+                continue;
+            }
+            k = tx_next_symbol(tx, tx->sym);
+            if (k < 0)
+                break;
+            tx->sym_len = k;
+            tx->sym_pos = 0;
+        }
+        k = tx->sym_len - tx->sym_pos < n - done ? tx->sym_len - tx->sym_pos : n - done;
+        memcpy(out + done, tx->sym + tx->sym_pos, (size_t)k * sizeof(sample_t));
+        tx->sym_pos += k;
+        done += k;
+    }
+    return done;
 }
 
 void modem_tx_destroy(modem_tx_handle_t h)
 {
-    free(h);
+    struct modem_tx *tx = (struct modem_tx *)h;
+    if (tx) {
+        mtone_tx_destroy(tx->mt);
+        free(tx->sym);
+        free(tx);
+    }
 }
 
-/* ========== 解调器：每比特采样内简单能量/过零判 0/1 ，判断波形的抖动幅度========== */
+/* ========== 解调器：每比特采样内判 0/1（过零计数或正交相关能量检测）========== */
+
+#if defined(__GNUC__)
+/** 4 路 float 向量（GCC 向量扩展），在 x86 上编译为 SSE、在 ARM 上编译为 NEON */
+typedef float v4sf __attribute__((vector_size(16)));
+#endif
+
+/** 定时环路增益：每比特按早迟误差修正的比例，越小越平滑、越大收敛越快 */
+#define TIMING_LOOP_GAIN    0.25
+
+/**
+ * MSK/GMSK 定时环路增益：中点相位误差只在比特跳变处有信息，且相位噪声按 T/π 放大成采样误差，
+ * 用比早/迟门小得多的增益平均掉
+ */
+#define MSK_TIMING_GAIN     0.05
+
+/** 每比特定时修正上限（采样），防止噪声把时钟拉飞 */
+#define TIMING_MAX_STEP     1.0
+
+/**
+ * DPSK 积分窗判为有载波的门限：带内能量 |z|² 与 n·Σx² 之比，纯载波为 1/2，白噪声平均约 1/n。
+ * 低于门限（静音、只有噪声）时不更新定时，否则归一化的早/迟门误差会让定时在噪声上随机游走
+ */
+#define DPSK_CARRIER_MIN    0.125f
+
+struct modem_rx;
+
+/** 逐比特解调内核：从 remain_buf 里解出尽量多的比特（不超过 max_bits），返回比特数 */
+typedef int (*modem_rx_kernel_t)(struct modem_rx *rx, uint8_t *bits, int max_bits);
+
 struct modem_rx {
-    /* 可扩展：保存未处理完的采样用于下一段拼接 */
+    /**
+     * 跨块拼接：上次调用未用完的采样（含下一比特及早门所需的前导采样）
+     * 保留在 remain_buf 开头，本次新采样接在其后，保证流式处理不丢采样
+     */
     sample_t *remain_buf;
     int remain_len;
+    int remain_cap;      /* remain_buf 容量（采样数） */
+    double bit_pos;      /* 下一比特在 remain_buf 中的起始位置（分数定时，含小数） */
+    uint64_t abs_pos;    /* remain_buf[0] 的绝对采样序号，MSK 下变频需要连续的时间基准 */
+
+    struct modem_phy phy;      /* 采样率、波特率、频率及推出的参数 */
+    modem_rx_kernel_t kernel;  /* 创建时按 phy 选定：常见配置用特化内核，其余用通用内核 */
+
+    modem_mode_t mode;    /* 调制方式，须与发送端一致（FSK 与 CPFSK 可互通） */
+    mtone_rx_t *mt;       /* 多音模式 (MFSK / OFDM) 的接收引擎，二进制模式下为 NULL */
+    modem_demod_t demod;  /* FSK/CPFSK 的解调算法 */
+    uint32_t msk_step;    /* MSK 中心频率（DPSK 载波）每采样相位增量 */
+    float dpsk_re, dpsk_im;  /* DBPSK/DQPSK 上一符号的基带相量，差分检测的参考 */
+    int dpsk_carrier;        /* DBPSK/DQPSK 上一符号有载波；为 0 时下一个有载波的符号按载波起点重新捕获定时 */
+    /**
+     * 正交相关参考表（phy.spb 行，16 字节对齐），按采样交错存放 [cos0, sin0, cos1, sin1]，
+     * 一个采样与 4 路参考相乘正好是一条 4 路 SIMD 指令。
+     * MSK/GMSK/DPSK 模式下前两路为中心频率的 [cos, sin]，后两路为 0
+     */
+    float (*ref)[4];
+
+    modem_rx_quality_t q;  /* 解调质量累计（二进制模式），见 modem_rx_take_quality */
 };
 
-modem_rx_handle_t modem_rx_create(void)
+/** 按调制方式重建参考表 */
+static void rx_build_ref(struct modem_rx *rx)
+{
+    const struct modem_phy *p = &rx->phy;
+    int i;
+    double f0, f1;
+    int msk = (rx->mode == MODEM_MODE_MSK || rx->mode == MODEM_MODE_GMSK || mode_is_dpsk(rx->mode));
+
+    mode_tone_freqs(p, rx->mode, &f0, &f1);
+    if (msk)
+        f0 = p->center;
+    /* 参考表只算一次，之后每比特只做乘加 */
+    for (i = 0; i < p->spb; i++) {
+        double w0 = 2.0 * M_PI * f0 * i / p->rate;
+        double w1 = 2.0 * M_PI * f1 * i / p->rate;
+        rx->ref[i][0] = (float)cos(w0);
+        rx->ref[i][1] = (float)sin(w0);
+        rx->ref[i][2] = msk ? 0.0f : (float)cos(w1);
+        rx->ref[i][3] = msk ? 0.0f : (float)sin(w1);
+    }
+}
+
+static modem_rx_kernel_t rx_select_kernel(const struct modem_phy *p, int force_generic);
+
+modem_rx_handle_t modem_rx_create(const phy_config_t *cfg)
 {
     struct modem_rx *rx = (struct modem_rx *)calloc(1, sizeof(struct modem_rx));
+    int force_generic;
+
     if (!rx) return NULL;
-    /* 预分配一小段缓冲区，用于跨块拼接（此处简化，可不用） */
+    if (phy_from_config(cfg, &rx->phy, &force_generic) != 0) {
+        free(rx);
+        return NULL;
+    }
+    /* 每行 16 字节，行数即是对齐粒度的整数倍 */
+    rx->ref = (float (*)[4])aligned_alloc(16, (size_t)rx->phy.spb * sizeof(rx->ref[0]));
+    if (!rx->ref) {
+        free(rx);
+        return NULL;
+    }
+    rx->kernel = rx_select_kernel(&rx->phy, force_generic);
+    /* 跨块拼接缓冲区按需扩容，首次调用时分配 */
     rx->remain_buf = NULL;
     rx->remain_len = 0;
+    rx->remain_cap = 0;
+    rx->bit_pos = rx->phy.lookback;
+    rx->abs_pos = 0;
+    rx->demod = MODEM_DEMOD_CORR;
+    rx->msk_step = nco_step(rx->phy.center, rx->phy.rate);
+    rx->mode = MODEM_MODE_CPFSK;
+    rx_build_ref(rx);
     return (modem_rx_handle_t)rx;
 }
 
+int modem_rx_set_mode(modem_rx_handle_t h, modem_mode_t mode)
+{
+    struct modem_rx *rx = (struct modem_rx *)h;
+    mtone_rx_t *mt = NULL;
+
+    if (!rx || mode < MODEM_MODE_FSK || mode >= MODEM_MODE_COUNT)
+        return -1;
+    if (mtone_is_mode(mode)) {
+        mt = mtone_rx_create(mode);
+        if (!mt)
+            return -1;
+    }
+    mtone_rx_destroy(rx->mt);
+    rx->mt = mt;
+    rx->mode = mode;
+    if (!mt)
+        rx_build_ref(rx);
+    modem_rx_reset(rx);
+    memset(&rx->q, 0, sizeof(rx->q));
+    return 0;
+}
+
+int modem_rx_set_demod(modem_rx_handle_t h, modem_demod_t demod)
+{
+    struct modem_rx *rx = (struct modem_rx *)h;
+
+    if (!rx || (demod != MODEM_DEMOD_ZEROCROSS && demod != MODEM_DEMOD_CORR))
+        return -1;
+    rx->demod = demod;
+    return 0;
+}
+
+void modem_rx_reset(modem_rx_handle_t h)
+{
+    struct modem_rx *rx = (struct modem_rx *)h;
+
+    if (!rx) return;
+    rx->remain_len = 0;
+    rx->bit_pos = rx->phy.lookback;
+    rx->abs_pos = 0;
+    rx->dpsk_re = rx->dpsk_im = 0.0f;
+    rx->dpsk_carrier = 0;
+    mtone_rx_reset(rx->mt);
+}
+
+/*
+ * 以下直到 rx_select_kernel 都是内核的组成部分，一律强制内联：
+ * 特化内核里 p 的各字段是常量，窗口长度、早/迟门偏移等随之折叠，相关累加的循环次数也是常量
+ */
+#define RX_INLINE static inline __attribute__((always_inline))
+
 /**
- * 对 SAMPLES_PER_BIT 个采样判 0 或 1：比较 1200Hz 与 2400Hz 分量能量
+ * 对 spb 个采样判 0 或 1：比较 f0 与 f1 分量能量
  * 简化实现：用该段内“过零次数”近似区分低频(0)与高频(1)
  */
-static int demodulate_bit(const sample_t *samples, int nsamples)
+RX_INLINE int demodulate_bit(const struct modem_phy *p, const sample_t *samples, int nsamples)
 {
     int zeros = 0, i;
-    double avg_abs = 0;
     /* 过零计数：低频过零少，高频过零多 */
     for (i = 1; i < nsamples; i++) {
         if ((samples[i-1] >= 0 && samples[i] < 0) || (samples[i-1] < 0 && samples[i] >= 0))
             zeros++;
-        avg_abs += fabs(samples[i]);
     }
-    avg_abs /= nsamples;
-    /* 粗略阈值：过零多则判为 1 (高频) */
-    return (zeros > nsamples / 4) ? 1 : 0;
+    /**
+     * 阈值取两载波期望过零数的中点：频率 f 在 n 个采样内约过零 2*f*n/采样率 次，
+     * 中点为 (f0+f1)*n/采样率。过零多则判为 1 (高频)
+     */
+    return (zeros * p->rate > (p->f0 + p->f1) * nsamples) ? 1 : 0;
 }
 
+/**
+ * 4 路相关累加：acc[k] = Σ samples[i] * ref[i][k]
+ * 按采样序号模 4 分给 4 个独立的累加器，最后相加：单个累加器时每个采样都要等上一次加法的延迟。
+ * nsamples 为常量时（特化内核）尾部的处理在编译期就确定了
+ */
+RX_INLINE void corr4(const struct modem_rx *rx, const sample_t *samples, int nsamples, float acc_out[4])
+{
+    int i;
+
+#if defined(__GNUC__)
+    v4sf a0 = { 0.0f, 0.0f, 0.0f, 0.0f }, a1 = a0, a2 = a0, a3 = a0;
+    const v4sf *ref = (const v4sf *)rx->ref;
+
+    for (i = 0; i + 4 <= nsamples; i += 4) {
+        a0 += samples[i]     * ref[i];
+        a1 += samples[i + 1] * ref[i + 1];
+        a2 += samples[i + 2] * ref[i + 2];
+        a3 += samples[i + 3] * ref[i + 3];
+    }
+    for (; i < nsamples; i++)
+        a0 += samples[i] * ref[i];
+    a0 = (a0 + a1) + (a2 + a3);
+    __builtin_memcpy(acc_out, &a0, sizeof(a0));
+#else
+    acc_out[0] = acc_out[1] = acc_out[2] = acc_out[3] = 0.0f;
+    for (i = 0; i < nsamples; i++) {
+        acc_out[0] += samples[i] * rx->ref[i][0];
+        acc_out[1] += samples[i] * rx->ref[i][1];
+        acc_out[2] += samples[i] * rx->ref[i][2];
+        acc_out[3] += samples[i] * rx->ref[i][3];
+    }
+#endif
+}
+
+/**
+ * 正交相关：分别求该段信号与 f0 / f1 的 cos、sin 相关，
+ * 能量 E = I^2 + Q^2 与载波相位无关（非相干检测）。
+ * 噪声与参考正弦不相关，相关累加会把它平均掉，远比过零计数稳健。
+ */
+RX_INLINE void corr_energy(const struct modem_rx *rx, const sample_t *samples, int nsamples,
+                           float *e0, float *e1)
+{
+    float acc[4];
+    corr4(rx, samples, nsamples, acc);
+    *e0 = acc[0] * acc[0] + acc[1] * acc[1];
+    *e1 = acc[2] * acc[2] + acc[3] * acc[3];
+}
+
+/**
+ * 判决清晰度：窗口恰好对齐一个完整符号时 |E1-E0| 最大，
+ * 窗口跨两个不同符号时两路能量混在一起、差值变小。归一化后与信号幅度无关。
+ */
+RX_INLINE float timing_metric(const struct modem_rx *rx, const struct modem_phy *p, const sample_t *samples)
+{
+    float e0, e1;
+    corr_energy(rx, samples, p->spb, &e0, &e1);
+    return fabsf(e1 - e0) / (e1 + e0 + 1e-12f);
+}
+
+/**
+ * 基带相量：remain_buf[t0] 起 n 个采样下变频到基带并积分，
+ * z = e^{-jθ(t0)} Σ x[t0+i] e^{-jωi}，θ(t0) 按绝对采样序号计算，保证不同位置的相位可比。
+ */
+RX_INLINE void baseband_sum(const struct modem_rx *rx, int t0, int n, float *zr, float *zi)
+{
+    uint32_t th = (uint32_t)((rx->abs_pos + (uint64_t)t0) * rx->msk_step);
+    float acc[4], c = nco_cos(th), s = nco_sin(th);
+
+    corr4(rx, rx->remain_buf + t0, n, acc);
+    /* (I - jQ)(c - js) */
+    *zr = acc[0] * c - acc[1] * s;
+    *zi = -acc[0] * s - acc[1] * c;
+}
+
+/**
+ * MSK 基带相位：以 remain_buf[b] 为中心取 msk_win 个采样的基带相量。
+ * 比特内基带相位变化 +π/2 为 1、-π/2 为 0，与前后比特无关（1 比特差分检测）。
+ */
+RX_INLINE void msk_boundary(const struct modem_rx *rx, const struct modem_phy *p, int b, float *zr, float *zi)
+{
+    baseband_sum(rx, b - p->msk_win / 2, p->msk_win, zr, zi);
+}
+
+/** DPSK 积分窗 [t0, t0+n) 里是否有载波（z 为该窗的基带相量），见 DPSK_CARRIER_MIN */
+RX_INLINE int dpsk_has_carrier(const struct modem_rx *rx, int t0, int n, float zr, float zi)
+{
+    const sample_t *x = rx->remain_buf + t0;
+    float e = 0.0f;
+    int i;
+
+    for (i = 0; i < n; i++)
+        e += x[i] * x[i];
+    return zr * zr + zi * zi >= DPSK_CARRIER_MIN * (float)n * e;
+}
+
+/**
+ * 静音后载波起点的估计，即段首参考符号的起点：参考符号与上一段末尾同相，整个符号相位恒定，
+ * 积分窗从起点之前滑进来时带内能量由 0 升到平台。在 [lo, hi) 上找平台，取能量首次达到平台一半的位置 t，
+ * 这时约 1/√2 个窗口落在载波内，起点 ≈ t + (1 - 1/√2)·dpsk_win。只在静音后调用，逐采样搜索的开销可以忽略
+ */
+RX_INLINE double dpsk_onset(const struct modem_rx *rx, const struct modem_phy *p, int lo, int hi)
+{
+    float zr, zi, e, peak = 0.0f;
+    int t;
+
+    for (t = lo; t < hi; t++) {
+        baseband_sum(rx, t, p->dpsk_win, &zr, &zi);
+        e = zr * zr + zi * zi;
+        if (e > peak)
+            peak = e;
+    }
+    for (t = lo; t < hi; t++) {
+        baseband_sum(rx, t, p->dpsk_win, &zr, &zi);
+        if (zr * zr + zi * zi >= 0.5f * peak)
+            break;
+    }
+    return t + (1.0 - M_SQRT1_2) * p->dpsk_win;
+}
+
+/** 两个基带相量之间的相位差 arg(b · conj(a))，范围 (-π, π] */
+static float phase_diff(float ar, float ai, float br, float bi)
+{
+    return atan2f(bi * ar - br * ai, br * ar + bi * ai);
+}
+
+/**
+ * 逐比特判决并用早/迟门跟踪比特定时（内核的函数体，p 为物理层参数）。
+ * MSK/GMSK 用比特中点相位偏离首尾连线的程度估计定时误差；
+ * DBPSK/DQPSK 的早/迟门比较错开 ±d 后积分窗的能量（窗口滑进相位过渡段时能量下降）。
+ * 比特位置按 spb_f（分数）前进，判决窗口取 spb 个采样并居中于比特内。
+ * 每比特在 [pos-d, pos+d] 两个错开的窗口上比较判决清晰度，
+ * 迟门更清晰说明窗口偏早，位置后移；反之前移。连续相同比特时两门相等，不做修正。
+ * 未凑满一个比特（含迟门）的尾部采样留在 remain_buf 里。
+ */
+RX_INLINE int demod_symbols(struct modem_rx *rx, const struct modem_phy *p, uint8_t *bits, int max_bits)
+{
+    const int d = p->gate;
+    const double center = (p->spb_f - p->spb) / 2.0;
+    const int bps = dpsk_bits_per_symbol(rx->mode);
+    int nbits = 0;
+
+    /* 窗口 [start, start+spb) 判决，早迟门需要再多 d 个采样 */
+    while (nbits + bps <= max_bits) {
+        int start = (int)(rx->bit_pos + center + 0.5);
+        const sample_t *win = rx->remain_buf + start;
+        float e0, e1, early, late;
+        double step;
+        int bit;    /* 本符号的比特，DQPSK 时为 2 比特 (b0 b1) */
+
+        if ((int)(rx->bit_pos + 0.5) + p->spb_max + p->lookback > rx->remain_len)
+            break;
+
+        if (rx->mode == MODEM_MODE_MSK || rx->mode == MODEM_MODE_GMSK) {
+            float sr, si, mr, mi, er, ei, p1, p2, tau;
+            msk_boundary(rx, p, (int)(rx->bit_pos + 0.5), &sr, &si);
+            msk_boundary(rx, p, (int)(rx->bit_pos + p->spb_f / 2 + 0.5), &mr, &mi);
+            msk_boundary(rx, p, (int)(rx->bit_pos + p->spb_f + 0.5), &er, &ei);
+            p1 = phase_diff(sr, si, mr, mi);
+            p2 = phase_diff(mr, mi, er, ei);
+            bit = (p1 + p2 > 0.0f) ? 1 : 0;
+            /* 比特内相位变化理想为 ±π/2，偏离部分当作噪声 */
+            e0 = fabsf(p1 + p2) - (float)(M_PI / 2);
+            rx->q.signal += M_PI * M_PI / 4;
+            rx->q.noise += e0 * e0;
+            /*
+             * MSK 比特内相位线性变化。窗口晚了 τ 时，后段混入下一比特的斜率，
+             * 中点相位偏离首尾连线 τ·(a_k - a_{k+1})·π/(4T)；乘以判决 a_k 后
+             * 在有跳变时正比于 τ、无跳变时为 0，换算为采样数即定时误差
+             */
+            tau = (bit ? 1.0f : -1.0f) * (p1 - p2) * (float)(p->spb_f / M_PI);
+            step = -MSK_TIMING_GAIN * tau;
+        } else if (mode_is_dpsk(rx->mode)) {
+            float zr, zi, dr, di, er, ei, lr, li;
+            int s0 = (int)(rx->bit_pos + p->dpsk_offset + 0.5), carrier;
+            baseband_sum(rx, s0, p->dpsk_win, &zr, &zi);
+            carrier = dpsk_has_carrier(rx, s0, p->dpsk_win, zr, zi);
+            if (carrier && !rx->dpsk_carrier) {
+                /*
+                 * 静音后第一个有载波的符号：定时按载波起点重新捕获，不靠早/迟门从任意偏差慢慢拉回（要十几个符号，
+                 * 同步字早过去了）。往前从保留的采样开头、往后多看一个符号找起点，采样不够就等下次调用
+                 */
+                int lo = (int)(rx->bit_pos + 0.5) - p->lookback;
+                double pos;
+
+                if (lo < 0)
+                    lo = 0;
+                if (s0 + p->spb + p->dpsk_win > rx->remain_len)
+                    break;
+                pos = dpsk_onset(rx, p, lo, s0 + p->spb);
+                if ((int)(pos + 0.5) + p->spb_max + p->lookback > rx->remain_len)
+                    break;
+                rx->bit_pos = pos;
+                start = (int)(rx->bit_pos + center + 0.5);
+                s0 = (int)(rx->bit_pos + p->dpsk_offset + 0.5);
+                baseband_sum(rx, s0, p->dpsk_win, &zr, &zi);
+            }
+            rx->dpsk_carrier = carrier;
+            /* d = z_k · conj(z_{k-1})，只看相位差，与两声卡间的载波相位差无关 */
+            dr = zr * rx->dpsk_re + zi * rx->dpsk_im;
+            di = zi * rx->dpsk_re - zr * rx->dpsk_im;
+            if (bps == 1)
+                bit = (dr < 0.0f) ? 1 : 0;
+            else if (fabsf(dr) >= fabsf(di))
+                bit = (dr >= 0.0f) ? 0 : 3;   /* 0° → 00，180° → 11 */
+            else
+                bit = (di > 0.0f) ? 1 : 2;    /* +90° → 01，-90° → 10 */
+            /* 判决轴上的分量为信号，垂直分量为噪声（DBPSK 判决轴总是实轴） */
+            if (bps == 1 || fabsf(dr) >= fabsf(di)) {
+                rx->q.signal += dr * dr;
+                rx->q.noise += di * di;
+            } else {
+                rx->q.signal += di * di;
+                rx->q.noise += dr * dr;
+            }
+            rx->dpsk_re = zr;
+            rx->dpsk_im = zi;
+            baseband_sum(rx, s0 - d, p->dpsk_win, &er, &ei);
+            baseband_sum(rx, s0 + d, p->dpsk_win, &lr, &li);
+            early = er * er + ei * ei;
+            late  = lr * lr + li * li;
+            step  = carrier ? TIMING_LOOP_GAIN * d * (late - early) / (late + early + 1e-12f) : 0.0;
+        } else {
+            if (rx->demod == MODEM_DEMOD_CORR) {
+                corr_energy(rx, win, p->spb, &e0, &e1);
+                bit = (e1 > e0) ? 1 : 0;
+                /* 非相干检测：落选音的能量只有噪声，获胜音多出的部分是信号 */
+                rx->q.signal += fabsf(e1 - e0);
+                rx->q.noise += bit ? e0 : e1;
+            } else {
+                bit = demodulate_bit(p, win, p->spb);
+            }
+            early = timing_metric(rx, p, win - d);
+            late  = timing_metric(rx, p, win + d);
+            step  = TIMING_LOOP_GAIN * d * (late - early);
+        }
+        if (step >  TIMING_MAX_STEP) step =  TIMING_MAX_STEP;
+        if (step < -TIMING_MAX_STEP) step = -TIMING_MAX_STEP;
+        rx->bit_pos += p->spb_f + step;
+        if (rx->demod == MODEM_DEMOD_CORR || rx->mode == MODEM_MODE_MSK || rx->mode == MODEM_MODE_GMSK
+            || mode_is_dpsk(rx->mode)) {
+            rx->q.symbols++;
+            rx->q.timing_sq += (step / p->spb_f) * (step / p->spb_f);
+        }
+
+        bs_write(bits, (size_t)nbits, (uint64_t)bit, bps);
+        nbits += bps;
+    }
+    return nbits;
+}
+
+/** 通用内核：参数从句柄拷到局部，循环里不必担心与 rx->q 的写入别名而反复重读 */
+static int rx_kernel_generic(struct modem_rx *rx, uint8_t *bits, int max_bits)
+{
+    const struct modem_phy p = rx->phy;
+    return demod_symbols(rx, &p, bits, max_bits);
+}
+
+/** 为一组常量参数实例化一个特化内核 */
+#define RX_KERNEL(name, rate, baud, f0, f1) \
+    static int name(struct modem_rx *rx, uint8_t *bits, int max_bits) \
+    { \
+        const struct modem_phy p = phy_make(rate, baud, f0, f1); \
+        return demod_symbols(rx, &p, bits, max_bits); \
+    }
+
+RX_KERNEL(rx_kernel_44100, 44100, FSK_BAUD_RATE, FSK_FREQ_0, FSK_FREQ_1)
+RX_KERNEL(rx_kernel_48000, 48000, FSK_BAUD_RATE, FSK_FREQ_0, FSK_FREQ_1)
+
+/** 特化内核表：采样率、波特率、两音都相同才选用 */
+static const struct {
+    int rate, baud, f0, f1;
+    modem_rx_kernel_t kernel;
+} rx_kernels[] = {
+    { 44100, FSK_BAUD_RATE, FSK_FREQ_0, FSK_FREQ_1, rx_kernel_44100 },
+    { 48000, FSK_BAUD_RATE, FSK_FREQ_0, FSK_FREQ_1, rx_kernel_48000 },
+};
+
+static modem_rx_kernel_t rx_select_kernel(const struct modem_phy *p, int force_generic)
+{
+    size_t i;
+
+    for (i = 0; !force_generic && i < sizeof(rx_kernels) / sizeof(rx_kernels[0]); i++) {
+        if (rx_kernels[i].rate == p->rate && rx_kernels[i].baud == p->baud
+            && rx_kernels[i].f0 == p->f0 && rx_kernels[i].f1 == p->f1)
+            return rx_kernels[i].kernel;
+    }
+    return rx_kernel_generic;
+}
+
+int modem_rx_specialized(modem_rx_handle_t h)
+{
+    struct modem_rx *rx = (struct modem_rx *)h;
+
+    return rx && rx->kernel != rx_kernel_generic;
+}
+
+/**
+ * 流式解调：新采样接在上次剩余采样之后，由创建时选定的内核逐比特判决（见 demod_symbols），
+ * 未凑满一个比特（含迟门）的尾部采样留到下次调用，不丢弃。
+ */
 int modem_rx_demodulate(modem_rx_handle_t h, const sample_t *samples, int nsamples,
                         uint8_t *bits, int max_bits)
 {
     struct modem_rx *rx = (struct modem_rx *)h;
-    int nbits = 0;
-    int i, byte_idx, bit_in_byte;
+    int nbits, keep_from;
 
-    if (!rx || !samples || !bits || nsamples < SAMPLES_PER_BIT || max_bits <= 0)
+    if (!rx || !samples || !bits || nsamples <= 0 || max_bits <= 0)
         return 0;
+    if (rx->mt)
+        return mtone_rx_demodulate(rx->mt, samples, nsamples, bits, max_bits);
 
-    for (i = 0; i + SAMPLES_PER_BIT <= nsamples && nbits < max_bits; i += SAMPLES_PER_BIT) {
-        int bit = demodulate_bit(samples + i, SAMPLES_PER_BIT);
-        byte_idx   = nbits / 8;
-        bit_in_byte = 7 - (nbits % 8);
-        if (bit)
-            bits[byte_idx] |= (1 << bit_in_byte);
-        else
-            bits[byte_idx] &= ~(1 << bit_in_byte);
-        nbits++;
+    /* 1. 新采样拼接到剩余采样之后 */
+    if (rx->remain_len + nsamples > rx->remain_cap) {
+        int cap = rx->remain_len + nsamples + 2 * rx->phy.spb_max;
+        sample_t *p = (sample_t *)realloc(rx->remain_buf, (size_t)cap * sizeof(sample_t));
+        if (!p)
+            return 0;
+        rx->remain_buf = p;
+        rx->remain_cap = cap;
+    }
+    memcpy(rx->remain_buf + rx->remain_len, samples, (size_t)nsamples * sizeof(sample_t));
+    rx->remain_len += nsamples;
+
+    /* 2. 逐比特判决 */
+    nbits = rx->kernel(rx, bits, max_bits);
+
+    /* 3. 保留下一比特之前 lookback 个采样及之后的全部采样，位置随之平移 */
+    keep_from = (int)(rx->bit_pos + 0.5) - rx->phy.lookback;
+    if (keep_from > rx->remain_len)
+        keep_from = rx->remain_len;
+    if (keep_from > 0) {
+        rx->remain_len -= keep_from;
+        memmove(rx->remain_buf, rx->remain_buf + keep_from,
+                (size_t)rx->remain_len * sizeof(sample_t));
+        rx->bit_pos -= keep_from;
+        rx->abs_pos += (uint64_t)keep_from;
     }
     return nbits;
 }
 
+void modem_rx_take_quality(modem_rx_handle_t h, modem_rx_quality_t *q)
+{
+    struct modem_rx *rx = (struct modem_rx *)h;
+
+    if (!rx || !q) return;
+    if (rx->mt) {
+        mtone_rx_take_quality(rx->mt, q);
+        return;
+    }
+    *q = rx->q;
+    memset(&rx->q, 0, sizeof(rx->q));
+}
+
 void modem_rx_destroy(modem_rx_handle_t h)
 {
     struct modem_rx *rx = (struct modem_rx *)h;
     if (rx) {
+        mtone_rx_destroy(rx->mt);
         free(rx->remain_buf);
+        free(rx->ref);
         free(rx);
     }
 }
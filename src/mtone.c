@@ -0,0 +1,543 @@
+/**
+ * mtone.c - 多音调制引擎实现：MFSK 与 OFDM
+ *
+ * MFSK：每个符号 MFSK_FFT_SIZE 个采样，发 FFT 频点 MFSK_FIRST_BIN + tone 上的一个音，
+ *       符号值按格雷码映射到音，相邻音误判只错 1 比特；各音共用一个相位累加器（连续相位）。
+ *       接收端对窗口做 FFT 取能量最大的音，早/迟门（能量集中度）跟踪符号定时，与二进制 FSK 同理。
+ * OFDM：每个符号 OFDM_FFT_SIZE 点 IFFT，前加 OFDM_CP_LEN 个循环前缀；每个子载波与上一符号
+ *       做差分 (DBPSK/DQPSK)，不需要载波相位恢复，两块声卡的相位差、固定时延都在差分中抵消。
+ *       接收端用循环前缀与符号尾部的相关性找符号起点（未同步时搜一整个符号，同步后 ±OFDM_TRACK 跟踪），
+ *       FFT 窗口挪动 δ 个采样时，把上一符号各子载波按 e^{j2πkδ/N} 旋转补偿，差分相位不受影响。
+ */
+
+#include "mtone.h"
+#include "fft.h"
+#include "nco.h"
+#include "bitstream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MFSK_MAX_TONES     32
+
+/** MFSK 振幅，与二进制 FSK 相同 */
+#define MFSK_AMPLITUDE     0.3f
+
+/** MFSK 早/迟门偏移（采样） */
+#define MFSK_GATE_OFFSET   (MFSK_FFT_SIZE / 8)
+
+/** MFSK 定时环路增益与每符号修正上限（采样） */
+#define MFSK_TIMING_GAIN   0.25
+#define MFSK_MAX_STEP      2.0
+
+/** OFDM 一个符号的采样数（循环前缀 + FFT） */
+#define OFDM_SYMBOL_LEN    (OFDM_CP_LEN + OFDM_FFT_SIZE)
+
+/**
+ * OFDM 输出均方根幅度。多载波叠加峰均比约 10 dB，RMS 0.1 时峰值约 0.4，与 FSK 的 0.3 同量级且不削顶
+ */
+#define OFDM_RMS           0.1f
+
+/** FFT 窗口起点相对符号起点的偏移：落在循环前缀 3/4 处，前后各留余量给定时误差与回声 */
+#define OFDM_WIN_OFFSET    (OFDM_CP_LEN * 3 / 4)
+
+/** 已同步时每符号在预期起点 ±OFDM_TRACK 采样内重新找循环前缀峰 */
+#define OFDM_TRACK         8
+
+/** 归一化循环前缀相关度门限：高于此值认为有 OFDM 信号（干净信号为 1，纯噪声约 0） */
+#define OFDM_LOCK_THRESH   0.5f
+
+/** 连续这么多个符号相关度低于门限才判失锁，避免低信噪比时单个符号抖动 */
+#define OFDM_LOST_SYMBOLS  3
+
+struct mtone_tx {
+    modem_mode_t mode;
+    int bps;                               /* 每符号比特数 */
+
+    /* MFSK */
+    nco_t tone[MFSK_MAX_TONES];            /* 各音的相位增量 */
+    uint32_t phase;                        /* 各音共用的相位 */
+
+    /* OFDM */
+    fft_plan_t *fft;
+    uint32_t carrier_phase[OFDM_NUM_CARRIERS];  /* 各子载波当前相位 (2^32 = 2π) */
+    float re[OFDM_FFT_SIZE];
+    float im[OFDM_FFT_SIZE];
+};
+
+struct mtone_rx {
+    modem_mode_t mode;
+    int bps;
+    fft_plan_t *fft;
+
+    /** 跨块拼接缓冲区，与 modem_rx 相同：未用完的采样留在开头 */
+    sample_t *buf;
+    int len;
+    int cap;
+    double pos;          /* 下一符号起点在 buf 中的位置（OFDM 为循环前缀起点） */
+
+    /* OFDM 同步与差分参考 */
+    int locked;
+    int missed;          /* 连续低相关度符号数 */
+    int have_prev;
+    float prev_re[OFDM_NUM_CARRIERS];
+    float prev_im[OFDM_NUM_CARRIERS];
+
+    float re[OFDM_FFT_SIZE];  /* FFT 工作区，MFSK 只用前 MFSK_FFT_SIZE 个 */
+    float im[OFDM_FFT_SIZE];
+
+    modem_rx_quality_t q;     /* 解调质量累计，见 modem_rx_take_quality */
+};
+
+/* ========== 公共 ========== */
+
+int mtone_is_mode(modem_mode_t mode)
+{
+    return mode == MODEM_MODE_MFSK16 || mode == MODEM_MODE_MFSK32 ||
+           mode == MODEM_MODE_OFDM_DBPSK || mode == MODEM_MODE_OFDM_DQPSK;
+}
+
+static int is_ofdm(modem_mode_t mode)
+{
+    return mode == MODEM_MODE_OFDM_DBPSK || mode == MODEM_MODE_OFDM_DQPSK;
+}
+
+int mtone_bits_per_symbol(modem_mode_t mode)
+{
+    switch (mode) {
+    case MODEM_MODE_MFSK16:     return 4;
+    case MODEM_MODE_MFSK32:     return 5;
+    case MODEM_MODE_OFDM_DBPSK: return OFDM_NUM_CARRIERS;
+    case MODEM_MODE_OFDM_DQPSK: return 2 * OFDM_NUM_CARRIERS;
+    default:                    return 0;
+    }
+}
+
+int mtone_symbol_samples(modem_mode_t mode)
+{
+    if (is_ofdm(mode))
+        return OFDM_SYMBOL_LEN;
+    return mtone_is_mode(mode) ? MFSK_FFT_SIZE : 0;
+}
+
+int mtone_tx_max_samples(modem_mode_t mode, int nbits)
+{
+    int bps = mtone_bits_per_symbol(mode);
+    int nsym;
+
+    if (bps <= 0 || nbits <= 0)
+        return 0;
+    nsym = (nbits + bps - 1) / bps;
+    if (is_ofdm(mode))
+        nsym++;  /* 参考符号 */
+    return nsym * mtone_symbol_samples(mode);
+}
+
+/** 取 idx 起 n 个比特（高位在前），超出 nbits 的部分补 0 */
+static int get_bits(const uint8_t *bits, int nbits, int idx, int n)
+{
+    if (idx + n <= nbits)
+        return (int)bs_read(bits, (size_t)idx, n);
+    if (idx >= nbits)
+        return 0;
+    return (int)bs_read(bits, (size_t)idx, nbits - idx) << (idx + n - nbits);
+}
+
+/** 格雷码解码：g ^ (g >> 1) 的逆 */
+static int gray_decode(int g)
+{
+    int shift;
+    for (shift = 1; shift < 8; shift <<= 1)
+        g ^= g >> shift;
+    return g;
+}
+
+/** DQPSK 两比特 ↔ 相位增量（四分之一周）按格雷码：00→0，01→1，11→2，10→3 */
+static const int g_dqpsk_quarter[4] = { 0, 1, 3, 2 };
+static const int g_dqpsk_bits[4] = { 0, 1, 3, 2 };
+
+/* ========== 发送 ========== */
+
+/** 参考符号的子载波相位：Newman 二次相位 π·c²/C，避免全部同相叠成一个尖峰 */
+static void ofdm_reset_phases(struct mtone_tx *tx)
+{
+    int c;
+    for (c = 0; c < OFDM_NUM_CARRIERS; c++)
+        tx->carrier_phase[c] = (uint32_t)((uint64_t)c * c * 2147483648ULL / OFDM_NUM_CARRIERS);
+}
+
+mtone_tx_t *mtone_tx_create(modem_mode_t mode)
+{
+    struct mtone_tx *tx;
+    int t;
+
+    if (!mtone_is_mode(mode))
+        return NULL;
+    tx = (struct mtone_tx *)calloc(1, sizeof(struct mtone_tx));
+    if (!tx) return NULL;
+    tx->mode = mode;
+    tx->bps = mtone_bits_per_symbol(mode);
+
+    if (is_ofdm(mode)) {
+        tx->fft = fft_create(OFDM_FFT_SIZE);
+        if (!tx->fft) {
+            free(tx);
+            return NULL;
+        }
+    } else {
+        for (t = 0; t < (1 << tx->bps); t++)
+            nco_init(&tx->tone[t], (double)(MFSK_FIRST_BIN + t) * SAMPLE_RATE / MFSK_FFT_SIZE, SAMPLE_RATE);
+    }
+    return tx;
+}
+
+/** 按当前各子载波相位生成一个 OFDM 符号（含循环前缀） */
+static void ofdm_gen_symbol(struct mtone_tx *tx, sample_t *out)
+{
+    const float scale = OFDM_RMS / sqrtf(OFDM_NUM_CARRIERS / 2.0f);
+    int c, i;
+
+    memset(tx->re, 0, sizeof(tx->re));
+    memset(tx->im, 0, sizeof(tx->im));
+    for (c = 0; c < OFDM_NUM_CARRIERS; c++) {
+        tx->re[OFDM_FIRST_BIN + c] = nco_cos(tx->carrier_phase[c]);
+        tx->im[OFDM_FIRST_BIN + c] = nco_sin(tx->carrier_phase[c]);
+    }
+    /* 只填正频率，取实部即得实信号 Σ cos(2πkn/N + φ_k) */
+    fft_inverse(tx->fft, tx->re, tx->im);
+    for (i = 0; i < OFDM_FFT_SIZE; i++)
+        out[OFDM_CP_LEN + i] = scale * tx->re[i];
+    memcpy(out, out + OFDM_FFT_SIZE, OFDM_CP_LEN * sizeof(sample_t));
+}
+
+int mtone_tx_symbol(mtone_tx_t *tx, const uint8_t *bits, int nbits, int idx, sample_t *out)
+{
+    int c, b = idx;
+
+    if (!is_ofdm(tx->mode)) {
+        int sym;
+        nco_t *osc;
+
+        if (idx < 0)
+            return 0;   /* MFSK 没有参考符号 */
+        sym = get_bits(bits, nbits, idx, tx->bps);
+        osc = &tx->tone[sym ^ (sym >> 1)];
+        osc->phase = tx->phase;
+        nco_generate(osc, MFSK_AMPLITUDE, MFSK_FFT_SIZE, out);
+        tx->phase = osc->phase;
+        return MFSK_FFT_SIZE;
+    }
+
+    if (idx < 0) {
+        ofdm_reset_phases(tx);
+    } else {
+        for (c = 0; c < OFDM_NUM_CARRIERS; c++) {
+            int q;
+            if (tx->mode == MODEM_MODE_OFDM_DBPSK) {
+                q = get_bits(bits, nbits, b++, 1) ? 2 : 0;
+            } else {
+                q = g_dqpsk_quarter[get_bits(bits, nbits, b, 2)];
+                b += 2;
+            }
+            tx->carrier_phase[c] += (uint32_t)q << 30;
+        }
+    }
+    ofdm_gen_symbol(tx, out);
+    return OFDM_SYMBOL_LEN;
+}
+
+void mtone_tx_destroy(mtone_tx_t *tx)
+{
+    if (!tx) return;
+    fft_destroy(tx->fft);
+    free(tx);
+}
+
+/* ========== 接收 ========== */
+
+mtone_rx_t *mtone_rx_create(modem_mode_t mode)
+{
+    struct mtone_rx *rx;
+
+    if (!mtone_is_mode(mode))
+        return NULL;
+    rx = (struct mtone_rx *)calloc(1, sizeof(struct mtone_rx));
+    if (!rx) return NULL;
+    rx->mode = mode;
+    rx->bps = mtone_bits_per_symbol(mode);
+    rx->fft = fft_create(is_ofdm(mode) ? OFDM_FFT_SIZE : MFSK_FFT_SIZE);
+    if (!rx->fft) {
+        free(rx);
+        return NULL;
+    }
+    mtone_rx_reset(rx);
+    return rx;
+}
+
+void mtone_rx_reset(mtone_rx_t *rx)
+{
+    if (!rx) return;
+    rx->len = 0;
+    rx->pos = is_ofdm(rx->mode) ? 0 : MFSK_GATE_OFFSET;
+    rx->locked = 0;
+    rx->missed = 0;
+    rx->have_prev = 0;
+}
+
+void mtone_rx_take_quality(mtone_rx_t *rx, modem_rx_quality_t *q)
+{
+    if (!rx || !q) return;
+    *q = rx->q;
+    memset(&rx->q, 0, sizeof(rx->q));
+}
+
+void mtone_rx_destroy(mtone_rx_t *rx)
+{
+    if (!rx) return;
+    fft_destroy(rx->fft);
+    free(rx->buf);
+    free(rx);
+}
+
+/**
+ * MFSK：对 MFSK_FFT_SIZE 个采样做 FFT，返回能量最大的音；
+ * *metric 为最大音能量占全部音能量的比例（窗口与符号对齐时最接近 1）
+ * quality 非零时把本符号计入质量累计：信号为最大音超出其余音平均的能量，噪声为其余音的平均能量
+ */
+static int mfsk_detect(struct mtone_rx *rx, const sample_t *samples, float *metric, int quality)
+{
+    const int ntones = 1 << rx->bps;
+    float best = -1.0f, sum = 0.0f;
+    int i, best_tone = 0;
+
+    for (i = 0; i < MFSK_FFT_SIZE; i++) {
+        rx->re[i] = samples[i];
+        rx->im[i] = 0.0f;
+    }
+    fft_forward(rx->fft, rx->re, rx->im);
+    for (i = 0; i < ntones; i++) {
+        int k = MFSK_FIRST_BIN + i;
+        float e = rx->re[k] * rx->re[k] + rx->im[k] * rx->im[k];
+        sum += e;
+        if (e > best) {
+            best = e;
+            best_tone = i;
+        }
+    }
+    *metric = best / (sum + 1e-12f);
+    if (quality) {
+        float rest = (sum - best) / (ntones - 1);
+        rx->q.signal += best - rest;
+        rx->q.noise += rest;
+    }
+    return best_tone;
+}
+
+static int mfsk_demodulate(struct mtone_rx *rx, uint8_t *bits, int max_bits)
+{
+    const int d = MFSK_GATE_OFFSET;
+    int nbits = 0;
+
+    while (nbits + rx->bps <= max_bits) {
+        int start = (int)(rx->pos + 0.5);
+        int tone, sym;
+        float m, early, late;
+        double step;
+
+        if (start + MFSK_FFT_SIZE + d > rx->len)
+            break;
+        tone = mfsk_detect(rx, rx->buf + start, &m, 1);
+        mfsk_detect(rx, rx->buf + start - d, &early, 0);
+        mfsk_detect(rx, rx->buf + start + d, &late, 0);
+
+        step = MFSK_TIMING_GAIN * d * (late - early);
+        if (step >  MFSK_MAX_STEP) step =  MFSK_MAX_STEP;
+        if (step < -MFSK_MAX_STEP) step = -MFSK_MAX_STEP;
+        rx->pos += MFSK_FFT_SIZE + step;
+        rx->q.symbols++;
+        rx->q.timing_sq += (step / MFSK_FFT_SIZE) * (step / MFSK_FFT_SIZE);
+
+        sym = gray_decode(tone);
+        bs_write(bits, (size_t)nbits, (uint64_t)sym, rx->bps);
+        nbits += rx->bps;
+    }
+    return nbits;
+}
+
+/**
+ * 在起点 [from, to) 中找循环前缀相关度最大的位置：
+ * m(θ) = Σ r[θ+i]·r[θ+i+N] / (½ Σ (r[θ+i]² + r[θ+i+N]²))，i < OFDM_CP_LEN
+ * 相关和与能量和随 θ 滑动增量更新，每个候选位置 O(1)
+ */
+static int ofdm_cp_search(const struct mtone_rx *rx, int from, int to, float *metric)
+{
+    const sample_t *r = rx->buf;
+    const int n = OFDM_FFT_SIZE;
+    double p = 0.0, e = 0.0;
+    float best_m = -2.0f;
+    int i, th, best = from;
+
+    for (i = 0; i < OFDM_CP_LEN; i++) {
+        p += (double)r[from + i] * r[from + i + n];
+        e += (double)r[from + i] * r[from + i] + (double)r[from + i + n] * r[from + i + n];
+    }
+    for (th = from; th < to; th++) {
+        float m = (float)(p / (0.5 * e + 1e-12));
+        int a = th, b = th + OFDM_CP_LEN;
+        if (m > best_m) {
+            best_m = m;
+            best = th;
+        }
+        p += (double)r[b] * r[b + n] - (double)r[a] * r[a + n];
+        e += (double)r[b] * r[b] + (double)r[b + n] * r[b + n]
+           - (double)r[a] * r[a] - (double)r[a + n] * r[a + n];
+    }
+    *metric = best_m;
+    return best;
+}
+
+/** 解一个 OFDM 符号的差分比特；delta 为本符号 FFT 窗口相对名义位置的挪动（采样） */
+static int ofdm_demod_symbol(struct mtone_rx *rx, int start, int delta, uint8_t *bits, int nbits)
+{
+    const sample_t *x = rx->buf + start + OFDM_WIN_OFFSET;
+    double sig = 0.0, noise = 0.0;
+    int i, c, out = 0;
+
+    for (i = 0; i < OFDM_FFT_SIZE; i++) {
+        rx->re[i] = x[i];
+        rx->im[i] = 0.0f;
+    }
+    fft_forward(rx->fft, rx->re, rx->im);
+
+    for (c = 0; c < OFDM_NUM_CARRIERS; c++) {
+        const int k = OFDM_FIRST_BIN + c;
+        float cr = rx->re[k], ci = rx->im[k];
+
+        if (rx->have_prev) {
+            float pr = rx->prev_re[c], pi = rx->prev_im[c], dr, di;
+            if (delta != 0) {
+                /* 窗口晚 δ 个采样，本符号多出 e^{j2πkδ/N}，参考符号转同样角度 */
+                uint32_t ph = (uint32_t)((int64_t)k * delta * (int64_t)(4294967296LL / OFDM_FFT_SIZE));
+                float c0 = nco_cos(ph), s0 = nco_sin(ph);
+                float t = pr * c0 - pi * s0;
+                pi = pr * s0 + pi * c0;
+                pr = t;
+            }
+            /* d = cur · conj(prev) */
+            dr = cr * pr + ci * pi;
+            di = ci * pr - cr * pi;
+            if (rx->mode == MODEM_MODE_OFDM_DBPSK) {
+                bs_put_bit(bits, (size_t)(nbits + out++), dr < 0.0f);
+                sig += dr * dr;
+                noise += di * di;
+            } else {
+                int q;
+                if (fabsf(dr) >= fabsf(di))
+                    q = dr >= 0.0f ? 0 : 2;
+                else
+                    q = di >= 0.0f ? 1 : 3;
+                bs_write(bits, (size_t)(nbits + out), (uint64_t)g_dqpsk_bits[q], 2);
+                out += 2;
+                sig += (q & 1) ? di * di : dr * dr;
+                noise += (q & 1) ? dr * dr : di * di;
+            }
+        }
+        rx->prev_re[c] = cr;
+        rx->prev_im[c] = ci;
+    }
+    if (rx->have_prev) {
+        rx->q.symbols++;
+        rx->q.signal += sig;
+        rx->q.noise += noise;
+        rx->q.timing_sq += ((double)delta / OFDM_SYMBOL_LEN) * ((double)delta / OFDM_SYMBOL_LEN);
+    }
+    rx->have_prev = 1;
+    return out;
+}
+
+static int ofdm_demodulate(struct mtone_rx *rx, uint8_t *bits, int max_bits)
+{
+    int nbits = 0;
+
+    for (;;) {
+        int start = (int)rx->pos, best, delta;
+        float m;
+
+        if (!rx->locked) {
+            /* 搜索一整个符号长度内的起点，需要两个符号的采样 */
+            if (start + 2 * OFDM_SYMBOL_LEN > rx->len)
+                break;
+            best = ofdm_cp_search(rx, start, start + OFDM_SYMBOL_LEN, &m);
+            if (m >= OFDM_LOCK_THRESH) {
+                rx->locked = 1;
+                rx->missed = 0;
+                rx->have_prev = 0;
+                rx->pos = best;
+            } else {
+                rx->pos += OFDM_SYMBOL_LEN;
+            }
+            continue;
+        }
+
+        if (start + OFDM_SYMBOL_LEN + OFDM_TRACK > rx->len)
+            break;
+        if (rx->have_prev && nbits + rx->bps > max_bits)
+            break;
+
+        best = ofdm_cp_search(rx, start > OFDM_TRACK ? start - OFDM_TRACK : 0, start + OFDM_TRACK + 1, &m);
+        if (m < OFDM_LOCK_THRESH) {
+            if (++rx->missed >= OFDM_LOST_SYMBOLS) {
+                rx->locked = 0;
+                rx->have_prev = 0;
+                continue;
+            }
+        } else {
+            rx->missed = 0;
+        }
+        /* 每符号最多挪 1 个采样，够跟上声卡间的时钟偏差，又不被单个符号的噪声带跑 */
+        delta = best - start;
+        if (delta > 1) delta = 1;
+        if (delta < -1) delta = -1;
+        start += delta;
+
+        nbits += ofdm_demod_symbol(rx, start, delta, bits, nbits);
+        rx->pos = start + OFDM_SYMBOL_LEN;
+    }
+    return nbits;
+}
+
+int mtone_rx_demodulate(mtone_rx_t *rx, const sample_t *samples, int nsamples,
+                        uint8_t *bits, int max_bits)
+{
+    int nbits, keep_from, lookback;
+
+    if (!rx || !samples || !bits || nsamples <= 0 || max_bits <= 0)
+        return 0;
+    lookback = is_ofdm(rx->mode) ? OFDM_TRACK : MFSK_GATE_OFFSET;
+
+    if (rx->len + nsamples > rx->cap) {
+        int new_cap = rx->len + nsamples;
+        sample_t *p = (sample_t *)realloc(rx->buf, (size_t)new_cap * sizeof(sample_t));
+        if (!p) return 0;
+        rx->buf = p;
+        rx->cap = new_cap;
+    }
+    memcpy(rx->buf + rx->len, samples, (size_t)nsamples * sizeof(sample_t));
+    rx->len += nsamples;
+
+    if (is_ofdm(rx->mode))
+        nbits = ofdm_demodulate(rx, bits, max_bits);
+    else
+        nbits = mfsk_demodulate(rx, bits, max_bits);
+
+    /* 保留下一符号起点之前 lookback 个采样及之后的全部采样 */
+    keep_from = (int)(rx->pos + 0.5) - lookback;
+    if (keep_from > rx->len)
+        keep_from = rx->len;
+    if (keep_from > 0) {
+        rx->len -= keep_from;
+        memmove(rx->buf, rx->buf + keep_from, (size_t)rx->len * sizeof(sample_t));
+        rx->pos -= keep_from;
+    }
+    return nbits;
+}
@@ -0,0 +1,123 @@
+/**
+ * nco.c - 数控振荡器实现
+ *
+ * 查表：1024 点正弦表（多一个保护点便于插值），相位高 10 位作下标、随后 16 位作插值系数，
+ *       线性插值误差约 (π/1024)^2/8 ≈ 1.2e-6（约 -118 dBc），远低于 16 bit 量化噪声。
+ * SIMD：4 路相位错开 step 的复振荡器 (cos, sin)，每次乘以 e^{j·4·step} 旋转（旋转因子在
+ *       nco_init 时用双精度算好），一次迭代出 4 个采样；每 NCO_RESEED 个采样从整数相位
+ *       查表重新定标，避免幅度/相位漂移。
+ */
+
+#include "nco.h"
+#include <math.h>
+#include <pthread.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define NCO_LUT_BITS   10
+#define NCO_LUT_SIZE   (1 << NCO_LUT_BITS)
+#define NCO_FRAC_BITS  16
+
+/** 递推振荡器连续运行的最大采样数，之后从整数相位重新定标 */
+#define NCO_RESEED     256
+
+static float g_sin_lut[NCO_LUT_SIZE + 1];
+static pthread_once_t g_lut_once = PTHREAD_ONCE_INIT;
+
+static void lut_init(void)
+{
+    int i;
+    for (i = 0; i <= NCO_LUT_SIZE; i++)
+        g_sin_lut[i] = (float)sin(2.0 * M_PI * i / NCO_LUT_SIZE);
+}
+
+uint32_t nco_step(double freq, int sample_rate)
+{
+    double cycles = freq / sample_rate;
+    cycles -= floor(cycles);  /* 归到 [0, 1)，负频率即反向旋转 */
+    return (uint32_t)(int64_t)(cycles * 4294967296.0 + 0.5);
+}
+
+void nco_init(nco_t *nco, double freq, int sample_rate)
+{
+    double w4 = 2.0 * M_PI * 4.0 * freq / sample_rate;
+
+    pthread_once(&g_lut_once, lut_init);
+    nco->phase = 0;
+    nco->step  = nco_step(freq, sample_rate);
+    nco->rot_c = (float)cos(w4);
+    nco->rot_s = (float)sin(w4);
+}
+
+float nco_sin(uint32_t phase)
+{
+    uint32_t idx = phase >> (32 - NCO_LUT_BITS);
+    float frac = (float)((phase >> (32 - NCO_LUT_BITS - NCO_FRAC_BITS)) & ((1u << NCO_FRAC_BITS) - 1))
+                 * (1.0f / (1u << NCO_FRAC_BITS));
+
+    pthread_once(&g_lut_once, lut_init);
+    return g_sin_lut[idx] + frac * (g_sin_lut[idx + 1] - g_sin_lut[idx]);
+}
+
+float nco_cos(uint32_t phase)
+{
+    return nco_sin(phase + 0x40000000u);  /* cos θ = sin(θ + π/2) */
+}
+
+void nco_generate_scalar(nco_t *nco, float amp, int n, sample_t *out)
+{
+    uint32_t phase = nco->phase;
+    const uint32_t step = nco->step;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = amp * nco_sin(phase);
+        phase += step;
+    }
+    nco->phase = phase;
+}
+
+#if defined(__GNUC__)
+/** 4 路 float 向量（GCC 向量扩展），在 x86 上编译为 SSE、在 ARM 上编译为 NEON */
+typedef float v4sf __attribute__((vector_size(16)));
+
+void nco_generate(nco_t *nco, float amp, int n, sample_t *out)
+{
+    const uint32_t step = nco->step;
+    const v4sf vrc = { nco->rot_c, nco->rot_c, nco->rot_c, nco->rot_c };
+    const v4sf vrs = { nco->rot_s, nco->rot_s, nco->rot_s, nco->rot_s };
+    const v4sf vamp = { amp, amp, amp, amp };
+    int i = 0;
+
+    while (n - i >= 4) {
+        int k, seg = n - i;
+        v4sf c, s;
+
+        if (seg > NCO_RESEED) seg = NCO_RESEED;
+        seg &= ~3;
+        /* 定标：4 路相位分别为 phase + k*step */
+        for (k = 0; k < 4; k++) {
+            c[k] = nco_cos(nco->phase + (uint32_t)k * step);
+            s[k] = nco_sin(nco->phase + (uint32_t)k * step);
+        }
+        for (k = 0; k < seg; k += 4) {
+            v4sf y = s * vamp, nc;
+            __builtin_memcpy(out + i + k, &y, sizeof(y));
+            nc = c * vrc - s * vrs;
+            s  = s * vrc + c * vrs;
+            c  = nc;
+        }
+        i += seg;
+        nco->phase += (uint32_t)seg * step;
+    }
+    /* 不足 4 个的尾部逐个查表 */
+    nco_generate_scalar(nco, amp, n - i, out + i);
+}
+#else
+void nco_generate(nco_t *nco, float amp, int n, sample_t *out)
+{
+    nco_generate_scalar(nco, amp, n, out);
+}
+#endif
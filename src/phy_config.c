@@ -0,0 +1,169 @@
+/**
+ * phy_config.c - 物理层 / 帧参数的运行时配置：默认值、描述串与配置文件解析、约束检查
+ */
+
+#include "phy_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+void phy_config_default(phy_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->sample_rate = SAMPLE_RATE;
+    cfg->baud_rate   = FSK_BAUD_RATE;
+    cfg->freq0       = FSK_FREQ_0;
+    cfg->freq1       = FSK_FREQ_1;
+    cfg->max_payload = MAX_FRAME_PAYLOAD;
+    cfg->channels    = 1;
+}
+
+/** 解析一个正整数，全部消费完返回 0 */
+static int parse_int(const char *s, int *v)
+{
+    char *end;
+    long x = strtol(s, &end, 10);
+
+    if (end == s || *end != '\0' || x <= 0 || x > 1000000)
+        return -1;
+    *v = (int)x;
+    return 0;
+}
+
+/** 去掉首尾空白，返回新的开头；s 会被改写 */
+static char *trim(char *s)
+{
+    char *end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return s;
+}
+
+/** 解析一个 键=值（= 两侧可有空白），tok 会被改写 */
+static int parse_pair(phy_config_t *cfg, char *tok)
+{
+    char *val = strchr(tok, '=');
+
+    if (!val) return -1;
+    *val++ = '\0';
+    tok = trim(tok);
+    val = trim(val);
+    if (strcmp(tok, "rate") == 0)
+        return parse_int(val, &cfg->sample_rate);
+    if (strcmp(tok, "baud") == 0)
+        return parse_int(val, &cfg->baud_rate);
+    if (strcmp(tok, "f0") == 0)
+        return parse_int(val, &cfg->freq0);
+    if (strcmp(tok, "f1") == 0)
+        return parse_int(val, &cfg->freq1);
+    if (strcmp(tok, "payload") == 0)
+        return parse_int(val, &cfg->max_payload);
+    if (strcmp(tok, "channels") == 0)
+        return parse_int(val, &cfg->channels);
+    if (strcmp(tok, "kernel") == 0) {
+        if (strcmp(val, "auto") == 0)
+            cfg->force_generic = 0;
+        else if (strcmp(val, "generic") == 0)
+            cfg->force_generic = 1;
+        else
+            return -1;
+        return 0;
+    }
+    return -1;
+}
+
+int phy_config_parse(phy_config_t *cfg, const char *spec)
+{
+    char buf[PHY_CONFIG_LINE_MAX], *tok, *save = NULL;
+
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "phy: spec too long\n");
+        return -1;
+    }
+    strcpy(buf, spec);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char copy[PHY_CONFIG_LINE_MAX];
+
+        strcpy(copy, tok);
+        if (parse_pair(cfg, tok) != 0) {
+            fprintf(stderr, "phy: bad option '%s' (rate=HZ,baud=N,f0=HZ,f1=HZ,payload=BYTES,channels=N,kernel=auto|generic)\n", copy);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int phy_config_load(phy_config_t *cfg, const char *path)
+{
+    char line[PHY_CONFIG_LINE_MAX];
+    FILE *fp = fopen(path, "r");
+    int lineno = 0;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *p, *hash = strchr(line, '#');
+
+        lineno++;
+        if (hash)
+            *hash = '\0';
+        p = trim(line);
+        if (*p == '\0')
+            continue;
+        if (parse_pair(cfg, p) != 0) {
+            fprintf(stderr, "%s:%d: bad line (rate=HZ, baud=N, f0=HZ, f1=HZ, payload=BYTES, channels=N, kernel=auto|generic)\n",
+                    path, lineno);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+int phy_config_check(const phy_config_t *cfg)
+{
+    int nyquist = cfg->sample_rate / 2;
+    int center = (cfg->freq0 + cfg->freq1) / 2;
+    int spb = cfg->baud_rate > 0 ? cfg->sample_rate / cfg->baud_rate : 0;
+
+    if (cfg->sample_rate < PHY_RATE_MIN || cfg->sample_rate > PHY_RATE_MAX) {
+        fprintf(stderr, "phy: sample rate %d out of range %d..%d\n", cfg->sample_rate, PHY_RATE_MIN, PHY_RATE_MAX);
+        return -1;
+    }
+    if (spb < PHY_MIN_SAMPLES_PER_BIT) {
+        fprintf(stderr, "phy: baud %d too high for %d Hz (need >= %d samples per bit)\n",
+                cfg->baud_rate, cfg->sample_rate, PHY_MIN_SAMPLES_PER_BIT);
+        return -1;
+    }
+    if (cfg->freq0 == cfg->freq1 || cfg->freq0 >= nyquist || cfg->freq1 >= nyquist) {
+        fprintf(stderr, "phy: tones %d / %d Hz must differ and stay below %d Hz\n", cfg->freq0, cfg->freq1, nyquist);
+        return -1;
+    }
+    if (4 * center <= cfg->baud_rate || 4 * center + cfg->baud_rate >= 4 * nyquist) {
+        fprintf(stderr, "phy: MSK tones %d +- %d/4 Hz out of band\n", center, cfg->baud_rate);
+        return -1;
+    }
+    /* 同 modem.c 里 phy_make 算出的 struct modem_phy.dpsk_win：下变频后 2 倍载波镜像周期的 2 倍 */
+    if (2 * ((cfg->sample_rate + center) / (2 * center)) > spb) {
+        fprintf(stderr, "phy: carrier %d Hz too low for %d baud (DPSK window exceeds a symbol)\n",
+                center, cfg->baud_rate);
+        return -1;
+    }
+    if (cfg->max_payload < 1 || cfg->max_payload > MAX_FRAME_PAYLOAD) {
+        fprintf(stderr, "phy: payload %d out of range 1..%d\n", cfg->max_payload, MAX_FRAME_PAYLOAD);
+        return -1;
+    }
+    if (cfg->channels < 1 || cfg->channels > AUDIO_MAX_CHANNELS) {
+        fprintf(stderr, "phy: %d channels out of range 1..%d\n", cfg->channels, AUDIO_MAX_CHANNELS);
+        return -1;
+    }
+    return 0;
+}
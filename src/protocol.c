@@ -1,19 +1,179 @@
 /**
  * protocol.c - 帧封装与解析实现
  *
- * 帧格式: [SYNC_BYTE x SYNC_LEN][长度 2 字节 大端][载荷][CRC16 2 字节 大端]
+ * 帧格式: [SYNC_BYTE x SYNC_LEN][长度 2 字节 大端][类型 1 字节][帧头校验 1 字节][载荷][CRC 大端]
  * 长度字段 = 载荷字节数（不含头与 CRC），便于接收端分配缓冲区并校验 CRC。
+ * 类型字段为 FRAME_AGGREGATE 等标志位的组合（见 common.h），普通帧为 0。
+ * 帧头校验为长度与类型字段的 CRC-8；接收端帧头校验不对、长度越界或类型是发送端不会发的组合时，当作假同步。
+ * 聚合帧类型字段带 FRAME_AGGREGATE，载荷为 [子长度 1/2 字节][包] 的序列。
+ * 压缩帧类型字段带 FRAME_COMPRESSED，载荷（聚合后的整体）为 LZ 压缩数据，长度字段与 CRC 按压缩后的字节数算。
+ * ARQ 帧类型字段带 FRAME_ARQ，载荷为 [ARQ 头][子长度 1/2 字节][包] 的序列（见 arq.h），压缩时 ARQ 头一起压。
+ * CRC 对「帧头字段+载荷」计算：载荷不少于 CRC32C_MIN_PAYLOAD 字节时为 CRC-32C（4 字节），否则 CRC-16（2 字节）。
+ * 开启纠错时线路上为 [SYNC_BYTE x SYNC_LEN][帧头字段卷积编码][载荷 + CRC 按纠错方式编码]（见 fec.h），
+ * 接收端译码后还原成上面的帧再校验 CRC。
  */
 
 #include "protocol.h"
 #include "utils.h"
+#include "bitstream.h"
+#include "lzcomp.h"
+#include "fec.h"
+#include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/** 「帧头字段+载荷」的 CRC：长帧 CRC-32C，短帧 CRC-16 */
+static uint32_t frame_crc(const uint8_t *hdr_field, int payload_len)
+{
+    if (FRAME_CRC_BYTES(payload_len) == CRC32C_BYTES)
+        return crc32c(hdr_field, HDR_FIELD_BYTES + (size_t)payload_len);
+    return crc16(hdr_field, HDR_FIELD_BYTES + (size_t)payload_len);
+}
+
+/** 长度与类型字段的 CRC-8（多项式 0x07，初值 0），只有三个字节，逐比特算即可 */
+static uint8_t hdr_check(const uint8_t *hdr_field)
+{
+    uint8_t c = 0;
+    int i, b;
+
+    for (i = 0; i < LEN_FIELD_BYTES + TYPE_FIELD_BYTES; i++) {
+        c ^= hdr_field[i];
+        for (b = 0; b < 8; b++)
+            c = (uint8_t)(c & 0x80 ? (c << 1) ^ 0x07 : c << 1);
+    }
+    return c;
+}
+
+/** 帧头类型字段 */
+static int frame_type(const uint8_t *frame)
+{
+    return frame[SYNC_LEN + LEN_FIELD_BYTES];
+}
+
+/**
+ * 检查帧头字段（frame + SYNC_LEN 起 HDR_FIELD_BYTES 字节）
+ * 类型只接受发送端会发的组合：没有未定义的位，控制帧不带其他标志，ARQ 帧不带聚合标志（子包序列是隐含的）
+ * @return 载荷字节数；帧头校验错、长度越界或类型非法返回 -1
+ */
+static int frame_header_len(const uint8_t *frame)
+{
+    int len = (frame[SYNC_LEN] << 8) | frame[SYNC_LEN + 1];
+    int flags = frame_type(frame);
+
+    if (frame[SYNC_LEN + LEN_FIELD_BYTES + TYPE_FIELD_BYTES] != hdr_check(frame + SYNC_LEN))
+        return -1;
+    if (len <= 0 || len > MAX_FRAME_PAYLOAD)
+        return -1;
+    if (flags & ~FRAME_TYPE_MASK)
+        return -1;
+    if ((flags & FRAME_CONTROL) && flags != FRAME_CONTROL)
+        return -1;
+    if ((flags & FRAME_ARQ) && (flags & FRAME_AGGREGATE))
+        return -1;
+    return len;
+}
+
+/* ========== 载荷压缩 ========== */
+
+static atomic_int g_compress;
+
+/** 压缩计数，字段含义同 protocol_comp_stats_t；封装线程与接收线程各写各的字段 */
+static struct {
+    atomic_ulong tx_frames, tx_compressed, tx_bytes_in, tx_bytes_out, tx_ns;
+    atomic_ulong rx_frames, rx_bytes_in, rx_bytes_out, rx_ns;
+} g_comp_stats;
+
+static unsigned long comp_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+static void comp_count(atomic_ulong *c, unsigned long n)
+{
+    atomic_fetch_add_explicit(c, n, memory_order_relaxed);
+}
+
+void protocol_set_compression(int enable)
+{
+    atomic_store(&g_compress, enable != 0);
+}
+
+void protocol_get_comp_stats(protocol_comp_stats_t *st)
+{
+    if (!st) return;
+    st->tx_frames     = atomic_load(&g_comp_stats.tx_frames);
+    st->tx_compressed = atomic_load(&g_comp_stats.tx_compressed);
+    st->tx_bytes_in   = atomic_load(&g_comp_stats.tx_bytes_in);
+    st->tx_bytes_out  = atomic_load(&g_comp_stats.tx_bytes_out);
+    st->tx_ns         = atomic_load(&g_comp_stats.tx_ns);
+    st->rx_frames     = atomic_load(&g_comp_stats.rx_frames);
+    st->rx_bytes_in   = atomic_load(&g_comp_stats.rx_bytes_in);
+    st->rx_bytes_out  = atomic_load(&g_comp_stats.rx_bytes_out);
+    st->rx_ns         = atomic_load(&g_comp_stats.rx_ns);
+}
+
+/**
+ * 压缩开关打开时，试压 frame_out + FRAME_HEADER_LEN 处的载荷，变短则原地替换
+ * @return 替换后的载荷字节数（未压缩时不变），*flags 相应加上 FRAME_COMPRESSED
+ */
+static int frame_compress(uint8_t *frame_out, int payload_len, int *flags)
+{
+    uint8_t buf[MAX_FRAME_PAYLOAD];
+    unsigned long t0;
+    int n = 0;
+
+    if (!atomic_load_explicit(&g_compress, memory_order_relaxed))
+        return payload_len;
+    if (payload_len >= LZ_MIN_INPUT) {
+        t0 = comp_now_ns();
+        n = lz_compress(frame_out + FRAME_HEADER_LEN, payload_len, buf, payload_len - 1);
+        comp_count(&g_comp_stats.tx_ns, comp_now_ns() - t0);
+    }
+    comp_count(&g_comp_stats.tx_frames, 1);
+    comp_count(&g_comp_stats.tx_bytes_in, (unsigned long)payload_len);
+    if (n > 0) {
+        memcpy(frame_out + FRAME_HEADER_LEN, buf, n);
+        comp_count(&g_comp_stats.tx_compressed, 1);
+        *flags |= FRAME_COMPRESSED;
+        payload_len = n;
+    }
+    comp_count(&g_comp_stats.tx_bytes_out, (unsigned long)payload_len);
+    return payload_len;
+}
 
 /**
- * 封装：同步字 + 长度(大端) + 载荷 + CRC16(大端)
+ * 载荷已放在 frame_out + FRAME_HEADER_LEN 处：补上同步字、长度字段、类型字段（flags）、帧头校验与帧尾 CRC
+ * @return 帧总字节数
  */
+static int frame_finish(uint8_t *frame_out, int payload_len, int flags)
+{
+    uint32_t crc;
+    int i, crc_bytes;
+
+    /* 1. 同步字 */
+    for (i = 0; i < SYNC_LEN; i++)
+        frame_out[i] = SYNC_BYTE;
+
+    /* 2. 长度（大端）、类型、帧头校验 */
+    frame_out[SYNC_LEN]     = (payload_len >> 8) & 0xFF;
+    frame_out[SYNC_LEN + 1] = payload_len & 0xFF;
+    frame_out[SYNC_LEN + LEN_FIELD_BYTES] = (uint8_t)flags;
+    frame_out[SYNC_LEN + LEN_FIELD_BYTES + TYPE_FIELD_BYTES] = hdr_check(frame_out + SYNC_LEN);
+
+    /* 3. CRC：对「帧头字段+载荷」计算，放在帧尾（大端） */
+    crc_bytes = FRAME_CRC_BYTES(payload_len);
+    crc = frame_crc(frame_out + SYNC_LEN, payload_len);
+    for (i = 0; i < crc_bytes; i++)
+        frame_out[FRAME_HEADER_LEN + payload_len + i] = (crc >> (8 * (crc_bytes - 1 - i))) & 0xFF;
+
+    return FRAME_HEADER_LEN + payload_len + crc_bytes;
+}
+
  /**
-  * 封装：同步字 + 长度(大端) + 载荷 + CRC16(大端)
+  * 封装：同步字 + 长度(大端) + 类型 + 帧头校验 + 载荷 + CRC(大端)
   * @param payload 载荷，即要封装的IP包数据
   * @param payload_len 载荷长度
   * @param frame_out 输出帧缓冲区
@@ -21,29 +181,134 @@
   */
 int protocol_encapsulate(const uint8_t *payload, int payload_len, uint8_t *frame_out)
 {
-    uint16_t crc;
-    int i;
+    int flags = 0;
 
     if (!payload || !frame_out || payload_len <= 0 || payload_len > MAX_FRAME_PAYLOAD)
         return 0;
 
-    /* 1. 同步字 */
-    for (i = 0; i < SYNC_LEN; i++)
-        frame_out[i] = SYNC_BYTE; /** 这个是*(frame_out + i)的简写,改的是内容 */
+    memcpy(frame_out + FRAME_HEADER_LEN, payload, payload_len); /** 拷贝载荷到帧缓冲区 ，从第6个字节开始，长度为payload_len*/
+    payload_len = frame_compress(frame_out, payload_len, &flags);
+    return frame_finish(frame_out, payload_len, flags);
+}
+
+/**
+ * 聚合封装：各包前加子长度（1 或 2 字节）依次排进载荷，类型字段带 FRAME_AGGREGATE
+ */
+int protocol_encapsulate_multi(const uint8_t *const *payloads, const int *lens, int count,
+                               uint8_t *frame_out)
+{
+    uint8_t *p;
+    int i, total = 0, flags = FRAME_AGGREGATE;
+
+    if (!payloads || !lens || !frame_out || count <= 0)
+        return 0;
+    if (count == 1)
+        return protocol_encapsulate(payloads[0], lens[0], frame_out);
+
+    for (i = 0; i < count; i++) {
+        if (!payloads[i] || lens[i] <= 0 || lens[i] > MAX_FRAME_PAYLOAD)
+            return 0;
+        total += AGG_ENTRY_BYTES(lens[i]);
+    }
+    if (total > MAX_FRAME_PAYLOAD)
+        return 0;
+
+    p = frame_out + FRAME_HEADER_LEN;
+    for (i = 0; i < count; i++) {
+        if (lens[i] < AGG_SHORT_LEN) {
+            *p++ = (uint8_t)lens[i];
+        } else {
+            *p++ = (uint8_t)(0x80 | (lens[i] >> 8));
+            *p++ = (uint8_t)(lens[i] & 0xFF);
+        }
+        memcpy(p, payloads[i], lens[i]);
+        p += lens[i];
+    }
+    total = frame_compress(frame_out, total, &flags);
+    return frame_finish(frame_out, total, flags);
+}
+
+/**
+ * ARQ 封装：ARQ 头之后各包带子长度排进载荷（一个包也带），类型字段带 FRAME_ARQ
+ */
+int protocol_encapsulate_arq(const uint8_t *hdr, const uint8_t *const *payloads, const int *lens,
+                             int count, uint8_t *frame_out)
+{
+    uint8_t *p;
+    int i, total = ARQ_HDR_BYTES, flags = FRAME_ARQ;
+
+    if (!hdr || !frame_out || count < 0 || (count > 0 && (!payloads || !lens)))
+        return 0;
+    for (i = 0; i < count; i++) {
+        if (!payloads[i] || lens[i] <= 0 || lens[i] > MAX_FRAME_PAYLOAD)
+            return 0;
+        total += AGG_ENTRY_BYTES(lens[i]);
+    }
+    if (total > MAX_FRAME_PAYLOAD)
+        return 0;
+
+    p = frame_out + FRAME_HEADER_LEN;
+    memcpy(p, hdr, ARQ_HDR_BYTES);
+    p += ARQ_HDR_BYTES;
+    for (i = 0; i < count; i++) {
+        if (lens[i] < AGG_SHORT_LEN) {
+            *p++ = (uint8_t)lens[i];
+        } else {
+            *p++ = (uint8_t)(0x80 | (lens[i] >> 8));
+            *p++ = (uint8_t)(lens[i] & 0xFF);
+        }
+        memcpy(p, payloads[i], lens[i]);
+        p += lens[i];
+    }
+    total = frame_compress(frame_out, total, &flags);
+    return frame_finish(frame_out, total, flags);
+}
+
+/**
+ * 控制帧：载荷原样放入，类型字段带 FRAME_CONTROL（消息很短，不试压缩）
+ */
+int protocol_encapsulate_control(const uint8_t *body, int len, uint8_t *frame_out)
+{
+    if (!body || !frame_out || len <= 0 || len > MAX_FRAME_PAYLOAD)
+        return 0;
+    memcpy(frame_out + FRAME_HEADER_LEN, body, len);
+    return frame_finish(frame_out, len, FRAME_CONTROL);
+}
+
+/** 帧头类型字段是否带 ARQ 标志 */
+static int frame_is_arq(const uint8_t *frame)
+{
+    return (frame_type(frame) & FRAME_ARQ) != 0;
+}
 
-    /* 2. 长度（大端） */
-    frame_out[SYNC_LEN]     = (payload_len >> 8) & 0xFF; /** 取高位+位与掩码0xFF */
-    frame_out[SYNC_LEN + 1] = payload_len & 0xFF; /** 取低位+位与掩码0xFF */
+/** 帧头类型字段是否带控制帧标志 */
+static int frame_is_control(const uint8_t *frame)
+{
+    return (frame_type(frame) & FRAME_CONTROL) != 0;
+}
 
-    /* 3. 拷贝载荷 */
-    memcpy(frame_out + FRAME_HEADER_LEN, payload, payload_len); /** 拷贝载荷到帧缓冲区 ，从第4个字节开始，长度为payload_len*/
+int protocol_frame_is_aggregate(const uint8_t *frame)
+{
+    return (frame_type(frame) & FRAME_AGGREGATE) != 0;
+}
 
-    /* 4. CRC：对「长度+载荷」计算，放在帧尾（大端） */
-    crc = crc16(frame_out + SYNC_LEN, LEN_FIELD_BYTES + payload_len);
-    frame_out[FRAME_HEADER_LEN + payload_len]     = (crc >> 8) & 0xFF;
-    frame_out[FRAME_HEADER_LEN + payload_len + 1] = crc & 0xFF;
+int protocol_aggregate_next(const uint8_t *body, int body_len, int *pos, const uint8_t **pkt)
+{
+    int p = *pos, len;
 
-    return FRAME_HEADER_LEN + payload_len + CRC_BYTES;
+    if (p >= body_len)
+        return 0;
+    len = body[p++];
+    if (len & 0x80) {
+        if (p >= body_len)
+            return -1;
+        len = (len & 0x7F) << 8 | body[p++];
+    }
+    if (len <= 0 || len > body_len - p)
+        return -1;
+    *pkt = body + p;
+    *pos = p + len;
+    return len;
 }
 
 /**
@@ -57,29 +322,188 @@ int protocol_encapsulate(const uint8_t *payload, int payload_len, uint8_t *frame
 int protocol_decapsulate(const uint8_t *frame, int frame_len,
                          uint8_t *payload_out, int max_payload)
 {
-    uint16_t len_u16, crc_stored, crc_computed;
+    int len_u16;
+    uint32_t crc_stored = 0, crc_computed;
+    unsigned long t0;
+    int i, n, crc_bytes;
 
     if (!frame || !payload_out || frame_len < FRAME_HEADER_LEN + CRC_BYTES)
         return -1;
 
-    /* 长度（大端） */
-    len_u16 = (frame[SYNC_LEN] << 8) | frame[SYNC_LEN + 1];
-    if (len_u16 <= 0 || len_u16 > MAX_FRAME_PAYLOAD)
-        return -1;
-    if (frame_len < FRAME_HEADER_LEN + len_u16 + CRC_BYTES)
+    /* 长度（大端），连同帧头校验与标志位组合一起检查 */
+    len_u16 = frame_header_len(frame);
+    if (len_u16 <= 0)
         return -1;
-    if (len_u16 > max_payload)
+    crc_bytes = FRAME_CRC_BYTES(len_u16);
+    if (frame_len < FRAME_HEADER_LEN + len_u16 + crc_bytes)
         return -1;
 
-    /* 校验 CRC：对「长度+载荷」计算，与帧尾两字节比较 */
-    crc_computed = crc16(frame + SYNC_LEN, LEN_FIELD_BYTES + len_u16);
-    crc_stored   = (frame[FRAME_HEADER_LEN + len_u16] << 8)
-                   | frame[FRAME_HEADER_LEN + len_u16 + 1];
+    /* 校验 CRC：对「帧头字段+载荷」计算，与帧尾 2 / 4 字节比较 */
+    crc_computed = frame_crc(frame + SYNC_LEN, len_u16);
+    for (i = 0; i < crc_bytes; i++)
+        crc_stored = (crc_stored << 8) | frame[FRAME_HEADER_LEN + len_u16 + i];
     if (crc_computed != crc_stored)
         return -1;  /* CRC 错误，丢弃 */
 
-    memcpy(payload_out, frame + FRAME_HEADER_LEN, len_u16); /** 拷贝载荷到输出缓冲区 ，从第4个字节开始，长度为len_u16*/
-    return (int)len_u16;
+    if (frame_type(frame) & FRAME_COMPRESSED) {
+        t0 = comp_now_ns();
+        n = lz_decompress(frame + FRAME_HEADER_LEN, len_u16, payload_out,
+                          max_payload < MAX_FRAME_PAYLOAD ? max_payload : MAX_FRAME_PAYLOAD);
+        comp_count(&g_comp_stats.rx_ns, comp_now_ns() - t0);
+        if (n <= 0)
+            return -1;
+        comp_count(&g_comp_stats.rx_frames, 1);
+        comp_count(&g_comp_stats.rx_bytes_in, (unsigned long)len_u16);
+        comp_count(&g_comp_stats.rx_bytes_out, (unsigned long)n);
+        return n;
+    }
+    if (len_u16 > max_payload)
+        return -1;
+    memcpy(payload_out, frame + FRAME_HEADER_LEN, len_u16); /** 拷贝载荷到输出缓冲区 ，从第6个字节开始，长度为len_u16*/
+    return len_u16;
+}
+
+/**
+ * 纠错编码：同步字原样，帧头字段单独卷积编码，载荷 + CRC 按 fec 编码
+ */
+int protocol_fec_encode(int fec, const uint8_t *frame, int frame_len, uint8_t *out)
+{
+    int len, body, o = SYNC_LEN;
+
+    if (!frame || !out || frame_len < FRAME_HEADER_LEN + CRC_BYTES || !FEC_MODE_VALID(fec))
+        return 0;
+    len = frame_header_len(frame);
+    body = len + FRAME_CRC_BYTES(len);
+    if (len <= 0 || frame_len < FRAME_HEADER_LEN + body)
+        return 0;
+    if (fec == FEC_NONE) {
+        memcpy(out, frame, (size_t)(FRAME_HEADER_LEN + body));
+        return FRAME_HEADER_LEN + body;
+    }
+    memcpy(out, frame, SYNC_LEN);
+    o += fec_encode(FEC_CONV, frame + SYNC_LEN, HDR_FIELD_BYTES, out + o);
+    return o + fec_encode(fec, frame + FRAME_HEADER_LEN, body, out + o);
+}
+
+/* ========== 同步字相关器：移位寄存器 + 汉明距离 ========== */
+
+/** 同步字比特数（SYNC_LEN 个 SYNC_BYTE） */
+#define SYNC_BITS  (SYNC_LEN * 8)
+#define SYNC_MASK  ((1ULL << SYNC_BITS) - 1)
+
+#if SYNC_BITS > 32
+#error "sync correlator assumes SYNC_LEN <= 4 (window of 64 bits holds >= 33 start offsets)"
+#endif
+
+/** SYNC_LEN 个 SYNC_BYTE 拼成的同步字，与窗口中 SYNC_BITS 位比较 */
+static uint64_t sync_word(void)
+{
+    uint64_t w = 0;
+    int i;
+    for (i = 0; i < SYNC_LEN; i++)
+        w = (w << 8) | SYNC_BYTE;
+    return w;
+}
+
+static int popcount64(uint64_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * 一个右对齐的比特窗口里所有起点一起与同步字比较（位并行）：窗口最低位是最新的比特，共 SYNC_BITS - 1 + ncand 个有效比特，
+ * 第 k 个起点（0 最旧）对应 (win >> (ncand - 1 - k)) 的低 SYNC_BITS 位，在返回值里是第 ncand - 1 - k 位。
+ * 同步字每一位与窗口对应移位后的比特比较，得到各起点在这一位上是否出错：精确匹配时同或相与即可；
+ * 容错时错误数按位切片累加（c[0..2] 是计数的 3 个二进制位，满 8 记入 over），最后逐位与 max_errors 比较。
+ * 每个窗口 SYNC_BITS 轮移位与逻辑运算，不逐起点做 popcount
+ * @param max_errors 0 ~ 7
+ * @return 汉明距离不超过 max_errors 的起点的位图
+ */
+static uint64_t sync_hits(uint64_t win, int ncand, int max_errors)
+{
+    const uint64_t sync = sync_word();
+    uint64_t hit = (ncand >= 64) ? ~0ULL : (1ULL << ncand) - 1;
+    uint64_t c[3] = { 0, 0, 0 }, over = 0, gt, eq;
+    int j, b;
+
+    if (max_errors == 0) {
+        for (j = 0; j < SYNC_BITS; j++)
+            hit &= ((sync >> j) & 1 ? win : ~win) >> j;
+        return hit;
+    }
+    for (j = 0; j < SYNC_BITS; j++) {
+        uint64_t m = ((sync >> j) & 1 ? ~win : win) >> j;   /* 这一位出错的起点 */
+        for (b = 0; b < 3; b++) {
+            uint64_t carry = c[b] & m;
+            c[b] ^= m;
+            m = carry;
+        }
+        over |= m;
+    }
+    /* 错误数大于 max_errors 的起点：从计数的高位往低位比 */
+    gt = over;
+    eq = ~over;
+    for (b = 2; b >= 0; b--) {
+        if ((max_errors >> b) & 1) {
+            eq &= c[b];
+        } else {
+            gt |= eq & c[b];
+            eq &= ~c[b];
+        }
+    }
+    return hit & ~gt;
+}
+
+/** sync_hits 位图里最旧的起点，没有返回 -1 */
+static int sync_oldest(uint64_t hit, int ncand)
+{
+    int s;
+
+    if (!hit)
+        return -1;
+#if defined(__GNUC__)
+    s = 63 - __builtin_clzll(hit);
+#else
+    for (s = 63; !((hit >> s) & 1); s--)
+        ;
+#endif
+    return ncand - 1 - s;
+}
+
+/**
+ * 在一个右对齐的比特窗口里找同步字（窗口约定见 sync_hits）
+ * @param first 从第几个起点开始比较（前面的起点比特不全）
+ * @return      第一个与同步字汉明距离不超过 max_errors 的起点，没有返回 -1
+ */
+static int sync_scan(uint64_t win, int first, int ncand, int max_errors)
+{
+    const uint64_t sync = sync_word();
+    int k;
+
+    if (max_errors < 8) {
+        /* 去掉 first 之前的起点，即位图中第 ncand - first 位及以上 */
+        uint64_t keep = (ncand - first >= 64) ? ~0ULL : (1ULL << (ncand - first)) - 1;
+        return sync_oldest(sync_hits(win, ncand, max_errors) & keep, ncand);
+    }
+    for (k = first; k < ncand; k++)
+        if (popcount64(((win >> (ncand - 1 - k)) ^ sync) & SYNC_MASK) <= max_errors)
+            return k;
+    return -1;
+}
+
+/** sync_scan 的精确匹配（max_errors 为 0），从第 0 个起点比 */
+static int sync_scan_exact(uint64_t win, int ncand)
+{
+    return sync_oldest(sync_hits(win, ncand, 0), ncand);
 }
 
 /**
@@ -88,27 +512,513 @@ int protocol_decapsulate(const uint8_t *frame, int frame_len,
  */
 int protocol_find_sync(const uint8_t *bits, int nbits)
 {
-    int i, j, k;
-    int need_bits = SYNC_LEN * 8;
+    return protocol_find_sync_tolerant(bits, nbits, 0);
+}
+
+/**
+ * 每次从 p 起读一个 64 比特窗口，比较其中 64 - SYNC_BITS + 1 个起点，再整体前移
+ */
+int protocol_find_sync_tolerant(const uint8_t *bits, int nbits, int max_errors)
+{
+    const int step = 64 - SYNC_BITS + 1;
+    int p;
+
+    if (!bits || nbits < SYNC_BITS || max_errors < 0)
+        return -1;
+
+    for (p = 0; p <= nbits - SYNC_BITS; p += step) {
+        int n = (nbits - p) < 64 ? (nbits - p) : 64;
+        int k = sync_scan(bs_read(bits, (size_t)p, n), 0, n - SYNC_BITS + 1, max_errors);
+        if (k >= 0)
+            return p + k;
+    }
+    return -1;
+}
+
+/* ========== 接收端组帧器：比特环 + 状态机 ========== */
+
+/** 比特环容量（比特，2 的幂），放得下一帧（纠错编码后）最大长度加一次 push */
+#define RX_RING_BITS  65536
+#define RX_RING_MASK  (RX_RING_BITS - 1)
+
+#if RX_RING_BITS < 2 * FEC_MAX_FRAME_LEN * 8
+#error "RX_RING_BITS must hold two maximum-length coded frames"
+#endif
+
+/**
+ * 开启纠错时帧头字段编码比特与译码结果重新编码的差异上限，超过即视为假同步：
+ * 卷积码译什么都能译出一个长度，假同步会让组帧器白等一整帧的编码比特（链路空闲时一直等下去）；
+ * 自由距离 10，真帧头在可纠范围内的差异不超过 4，随机比特落进 3 以内的概率约 2^-14
+ */
+#define RX_FEC_HDR_MAX_ERRORS  3
+
+/** 搜同步时一次移入的比特数上限：移位寄存器里要同时留住上一个同步字长度减 1 的旧比特 */
+#define HUNT_CHUNK  (64 - SYNC_BITS + 1)
+
+typedef enum {
+    RX_HUNT,     /* 新比特成块移入移位寄存器，与同步字逐起点比较 */
+    RX_HEADER,   /* 等帧头字段（长度 + 类型 + 帧头校验） */
+    RX_PAYLOAD,  /* 等载荷（开启纠错时等载荷 + CRC 的编码并译码） */
+    RX_CRC       /* 等 CRC 并校验（开启纠错时 CRC 已随载荷译出） */
+} rx_state_t;
+
+struct protocol_rx {
+    uint8_t ring[RX_RING_BITS / 8];
+    /**
+     * 比特序号均为自开始以来的累计值（无符号 32 位，回绕后相减仍正确），环内位置 = 序号 & RX_RING_MASK。
+     * wr：下一个写入的比特；rd：状态机下一个要看的比特；frame_start：候选帧同步字的第一个比特。
+     * 环中 [frame_start, wr)（搜同步时为 [rd, wr)）不能被覆盖
+     */
+    uint32_t wr;
+    uint32_t rd;
+    uint32_t frame_start;
+    uint32_t probe;       /* 拼帧时等比特期间，frame_start 之后下一个要看是否另有一帧的起点 */
+    uint32_t longest;     /* 收到过的最长一帧占的比特数（同步字到 CRC，开启纠错时为编码后），见 rx_later_frame */
+    rx_state_t state;
+    uint64_t shreg;       /* 搜同步：最近移入的比特，最低位最新 */
+    int shreg_bits;       /* 移位寄存器中的有效比特数（到 SYNC_BITS 为止），满 SYNC_BITS 的起点才比较 */
+    int max_errors;       /* 同步字容许的错误比特数 */
+    int payload_len;      /* 长度字段（载荷字节数） */
+    int agg_len;          /* 聚合帧：frame 中还有子包待取时为载荷字节数，否则 0 */
+    int agg_pos;          /* 聚合帧：下一个子长度字段在载荷中的位置（ARQ 帧从 ARQ 头之后开始） */
+    uint8_t frame[MAX_FRAME_LEN];  /* 拼好的帧，同步字部分创建时填好 */
+    uint8_t body[MAX_FRAME_PAYLOAD]; /* 聚合帧 / ARQ 帧解封装（含解压）后的载荷 */
+    int fec;              /* 纠错方式，须与发送端一致 */
+    int coded_len;        /* 开启纠错时载荷 + CRC 编码后的字节数 */
+    unsigned long pending_bit_errors;  /* 当前帧译码纠正的比特，CRC 对了才计入 */
+    unsigned long frames; /* CRC 通过的帧数 */
+    protocol_fec_stats_t fec_stats;
+    fec_viterbi_t *vit;   /* 卷积译码器，开启纠错时创建 */
+    uint8_t coded[FEC_MAX_FRAME_LEN];  /* 收到的编码比特（帧头字段或载荷 + CRC） */
+    uint8_t recoded[FEC_MAX_FRAME_LEN]; /* 译码结果重新编码，与收到的比较得出纠正的比特数 */
+    uint8_t probe_frame[MAX_FRAME_LEN]; /* rx_frame_at 拼出的候选帧 */
+};
+
+/** 从环中序号 pos 起取 nbits 比特到 dst（可能跨环尾，分两段） */
+static void ring_read(const struct protocol_rx *rx, uint32_t pos, uint8_t *dst, int nbits)
+{
+    size_t off = pos & RX_RING_MASK, first = RX_RING_BITS - off;
+
+    if (first >= (size_t)nbits) {
+        bs_copy(dst, 0, rx->ring, off, (size_t)nbits);
+    } else {
+        bs_copy(dst, 0, rx->ring, off, first);
+        bs_copy(dst, first, rx->ring, 0, (size_t)nbits - first);
+    }
+}
+
+/** 假同步（长度非法或 CRC 错）：回到同步字第一个比特之后重新搜 */
+static void rx_resync(struct protocol_rx *rx)
+{
+    rx->rd = rx->frame_start + 1;
+    rx->state = RX_HUNT;
+    rx->shreg_bits = 0;
+}
+
+protocol_rx_t *protocol_rx_create(void)
+{
+    struct protocol_rx *rx = (struct protocol_rx *)calloc(1, sizeof(struct protocol_rx));
+    int i;
+
+    if (!rx) return NULL;
+    for (i = 0; i < SYNC_LEN; i++)
+        rx->frame[i] = SYNC_BYTE;
+    rx->max_errors = SYNC_MAX_ERRORS;
+    protocol_rx_reset(rx);
+    return rx;
+}
+
+void protocol_rx_set_sync_tolerance(protocol_rx_t *rx, int max_errors)
+{
+    if (!rx) return;
+    if (max_errors < 0)
+        max_errors = 0;
+    if (max_errors > SYNC_BITS / 4)
+        max_errors = SYNC_BITS / 4;
+    rx->max_errors = max_errors;
+}
 
-    if (!bits || nbits < need_bits)
+int protocol_rx_set_fec(protocol_rx_t *rx, int fec)
+{
+    if (!rx || !FEC_MODE_VALID(fec)) return -1;
+    if (fec != FEC_NONE && !rx->vit && !(rx->vit = fec_viterbi_create()))
         return -1;
+    rx->fec = fec;
+    protocol_rx_reset(rx);
+    return 0;
+}
+
+void protocol_rx_get_fec_stats(const protocol_rx_t *rx, protocol_fec_stats_t *st)
+{
+    if (!rx || !st) return;
+    *st = rx->fec_stats;
+}
+
+/** 把 n 字节译码结果按 mode 重新编码，与收到的编码比较，返回不同的比特数 */
+static unsigned long rx_count_bit_errors(struct protocol_rx *rx, int mode, const uint8_t *plain, int n,
+                                         const uint8_t *coded)
+{
+    unsigned long errs = 0;
+    int i, m = fec_encode(mode, plain, n, rx->recoded);
+
+    for (i = 0; i < m; i++)
+        errs += (unsigned long)popcount64(rx->recoded[i] ^ coded[i]);
+    return errs;
+}
+
+void protocol_rx_reset(protocol_rx_t *rx)
+{
+    if (!rx) return;
+    rx->wr = rx->rd = rx->frame_start = 0;
+    rx->state = RX_HUNT;
+    rx->shreg = 0;
+    rx->shreg_bits = 0;
+    rx->agg_len = 0;
+    rx->longest = 0;
+}
+
+void protocol_rx_push(protocol_rx_t *rx, const uint8_t *bits, int nbits)
+{
+    size_t src_pos = 0, off, first;
+    uint32_t oldest;
+
+    if (!rx || !bits || nbits <= 0)
+        return;
+    if (nbits > RX_RING_BITS) {
+        /* 一次给的比环还多，只有最后 RX_RING_BITS 个比特还有用 */
+        src_pos = (size_t)(nbits - RX_RING_BITS);
+        rx->wr += (uint32_t)src_pos;
+        nbits = RX_RING_BITS;
+    }
+
+    oldest = (rx->state == RX_HUNT) ? rx->rd : rx->frame_start;
+    if (rx->wr - oldest + (uint32_t)nbits > RX_RING_BITS) {
+        /* 溢出：放弃正在拼的帧，仍不够再丢最旧的未处理比特 */
+        if (rx->state != RX_HUNT) {
+            rx->state = RX_HUNT;
+            rx->shreg_bits = 0;
+        }
+        if (rx->wr - rx->rd + (uint32_t)nbits > RX_RING_BITS) {
+            rx->rd = rx->wr + (uint32_t)nbits - RX_RING_BITS;
+            rx->shreg_bits = 0;
+        }
+    }
 
-    for (i = 0; i <= nbits - need_bits; i++) {
-        for (j = 0; j < SYNC_LEN; j++) {
-            int byte_val = 0;
-            for (k = 0; k < 8; k++) {
-                int bit_idx = i + j * 8 + k;
-                int byte_idx = bit_idx / 8;
-                int bit_in_byte = 7 - (bit_idx % 8);
-                if (bits[byte_idx] & (1 << bit_in_byte))
-                    byte_val |= (1 << (7 - k));
+    off = rx->wr & RX_RING_MASK;
+    first = RX_RING_BITS - off;
+    if (first >= (size_t)nbits) {
+        bs_copy(rx->ring, off, bits, src_pos, (size_t)nbits);
+    } else {
+        bs_copy(rx->ring, off, bits, src_pos, first);
+        bs_copy(rx->ring, 0, bits, src_pos + first, (size_t)nbits - first);
+    }
+    rx->wr += (uint32_t)nbits;
+}
+
+/**
+ * 在环中 [from, to) 里找精确匹配的同步字
+ * @return 找到时为同步字第一个比特的序号并置 *found；否则为下一次该从哪里接着找（最后不足一个同步字的比特留到下次）
+ */
+static uint32_t ring_find_sync(const struct protocol_rx *rx, uint32_t from, uint32_t to, int *found)
+{
+    *found = 0;
+    while (to - from >= SYNC_BITS) {
+        size_t off = from & RX_RING_MASK;
+        int n = (to - from) < 64 ? (int)(to - from) : 64;
+        int k;
+
+        if ((size_t)n > RX_RING_BITS - off)
+            n = (int)(RX_RING_BITS - off);
+        if (n < SYNC_BITS) {
+            /* 跨环尾的一个窗口：两段拼起来 */
+            uint8_t win[8];
+            n = (to - from) < 64 ? (int)(to - from) : 64;
+            ring_read(rx, from, win, n);
+            k = sync_scan_exact(bs_read(win, 0, n), n - SYNC_BITS + 1);
+        } else {
+            k = sync_scan_exact(bs_read(rx->ring, off, n), n - SYNC_BITS + 1);
+        }
+        if (k >= 0) {
+            *found = 1;
+            return from + (uint32_t)k;
+        }
+        from += (uint32_t)(n - SYNC_BITS + 1);
+    }
+    return from;
+}
+
+/**
+ * 环中从 pos（同步字第一个比特）起是否是一个完整的真帧：帧头校验通过、整帧已收到且 CRC 正确。
+ * 拼到 rx->probe_frame，不动正在拼的帧与纠错计数
+ * @return 1 是；0 帧头有效但还没收全；-1 不是
+ */
+static int rx_frame_at(struct protocol_rx *rx, uint32_t pos)
+{
+    uint8_t *f = rx->probe_frame;
+    uint32_t p = pos + SYNC_BITS, crc = 0;
+    int len, body, coded, i;
+
+    if (rx->fec != FEC_NONE) {
+        if (rx->wr - p < FEC_HDR_BYTES * 8)
+            return 0;
+        ring_read(rx, p, rx->coded, FEC_HDR_BYTES * 8);
+        fec_decode(rx->vit, FEC_CONV, rx->coded, HDR_FIELD_BYTES, f + SYNC_LEN);
+        if (rx_count_bit_errors(rx, FEC_CONV, f + SYNC_LEN, HDR_FIELD_BYTES, rx->coded) > RX_FEC_HDR_MAX_ERRORS)
+            return -1;
+        p += FEC_HDR_BYTES * 8;
+    } else {
+        if (rx->wr - p < HDR_FIELD_BYTES * 8)
+            return 0;
+        ring_read(rx, p, f + SYNC_LEN, HDR_FIELD_BYTES * 8);
+        p += HDR_FIELD_BYTES * 8;
+    }
+    len = frame_header_len(f);
+    if (len <= 0)
+        return -1;
+    body = len + FRAME_CRC_BYTES(len);
+    coded = FEC_CODED_BYTES(rx->fec, body);
+    if (rx->wr - p < (uint32_t)coded * 8)
+        return 0;
+    if (rx->fec != FEC_NONE) {
+        ring_read(rx, p, rx->coded, coded * 8);
+        if (fec_decode(rx->vit, rx->fec, rx->coded, body, f + FRAME_HEADER_LEN) < 0)
+            return -1;
+    } else {
+        ring_read(rx, p, f + FRAME_HEADER_LEN, body * 8);
+    }
+    for (i = len; i < body; i++)
+        crc = (crc << 8) | f[FRAME_HEADER_LEN + i];
+    return frame_crc(f + SYNC_LEN, len) == crc ? 1 : -1;
+}
+
+/**
+ * 正在拼的帧还在等比特：环中它的同步字之后若已有另一个完整的真帧，当前这个多半是假同步
+ * （随机比特碰巧通过了帧头检查），不再等它的长度——OFDM 静默时不出比特，等下去链路空闲后最后几帧就一直交不出。
+ * 拼帧期间每个比特都要过一遍，只找精确的同步字（位并行，比容错比较便宜得多）；后面的帧同步字恰有错比特时
+ * 仍要等当前帧收满或 CRC 错才会被找到。rx->probe 记着看到哪里，每个起点只看一次；候选帧还没收全时停在它那里，下次再看。
+ * 真帧等的比特数不会超过它自己的长度，逐比特探查对它们是白花的（比状态机本身还贵），所以只在当前帧已经等得
+ * 比收到过的最长一帧还久时才探查（一帧都还没收到时总是探查），探查从 frame_start 之后补看
+ * @return 1 应放弃当前帧
+ */
+static int rx_later_frame(struct protocol_rx *rx)
+{
+    int found, r;
+
+    if (rx->wr - rx->frame_start <= rx->longest)
+        return 0;
+    for (;;) {
+        rx->probe = ring_find_sync(rx, rx->probe, rx->wr, &found);
+        if (!found)
+            return 0;
+        r = rx_frame_at(rx, rx->probe);
+        if (r != -1)
+            return r;
+        rx->probe++;
+    }
+}
+
+/**
+ * 组帧并取载荷；kind 为 NULL 时 ARQ 帧跳过 ARQ 头按聚合帧拆包、控制帧丢弃，否则两者整帧交出并置 *kind
+ */
+static int rx_next(struct protocol_rx *rx, uint8_t *payload_out, int max_payload, protocol_rx_kind_t *kind)
+{
+    for (;;) {
+        uint32_t avail = rx->wr - rx->rd;
+        int n, k = -1;
+
+        /* 上一个聚合帧里还有包：先逐个交出，再看新比特 */
+        while (rx->agg_len > 0) {
+            const uint8_t *pkt;
+
+            n = protocol_aggregate_next(rx->body, rx->agg_len, &rx->agg_pos, &pkt);
+            if (n <= 0) {
+                rx->agg_len = 0;       /* 取完，或子长度越界（CRC 已对，只可能是发送端的错），丢弃余下部分 */
+                break;
             }
-            if (byte_val != SYNC_BYTE)
+            if (n <= max_payload) {
+                memcpy(payload_out, pkt, n);
+                return n;
+            }
+        }
+
+        switch (rx->state) {
+        case RX_HUNT:
+            /* 新比特一次最多移入 HUNT_CHUNK 个（不跨环尾），每个起点一次移位 + 比较 */
+            while (avail > 0 && k < 0) {
+                size_t off = rx->rd & RX_RING_MASK;
+                int first = SYNC_BITS - 1 - rx->shreg_bits;
+
+                n = avail < HUNT_CHUNK ? (int)avail : HUNT_CHUNK;
+                if ((size_t)n > RX_RING_BITS - off)
+                    n = (int)(RX_RING_BITS - off);
+                rx->shreg = (rx->shreg << n) | bs_read(rx->ring, off, n);
+                k = sync_scan(rx->shreg, first > 0 ? first : 0, n, rx->max_errors);
+                if (k >= 0)
+                    n = k + 1;   /* 只消耗到同步字末尾，后面是帧头 */
+                rx->rd += (uint32_t)n;
+                avail -= (uint32_t)n;
+                rx->shreg_bits = (rx->shreg_bits + n < SYNC_BITS) ? rx->shreg_bits + n : SYNC_BITS;
+            }
+            if (k < 0)
+                return 0;
+            rx->frame_start = rx->rd - SYNC_BITS;
+            rx->probe = rx->frame_start + 1;
+            rx->state = RX_HEADER;
+            break;
+
+        case RX_HEADER:
+            if (rx->fec != FEC_NONE) {
+                /* 帧头字段单独卷积编码：先译出长度才知道后面的编码有多长 */
+                if (avail < FEC_HDR_BYTES * 8)
+                    return 0;
+                ring_read(rx, rx->rd, rx->coded, FEC_HDR_BYTES * 8);
+                rx->rd += FEC_HDR_BYTES * 8;
+                fec_decode(rx->vit, FEC_CONV, rx->coded, HDR_FIELD_BYTES, rx->frame + SYNC_LEN);
+                rx->pending_bit_errors = rx_count_bit_errors(rx, FEC_CONV, rx->frame + SYNC_LEN,
+                                                             HDR_FIELD_BYTES, rx->coded);
+                if (rx->pending_bit_errors > RX_FEC_HDR_MAX_ERRORS) {
+                    rx_resync(rx);
+                    break;
+                }
+            } else {
+                if (avail < HDR_FIELD_BYTES * 8)
+                    return 0;
+                ring_read(rx, rx->rd, rx->frame + SYNC_LEN, HDR_FIELD_BYTES * 8);
+                rx->rd += HDR_FIELD_BYTES * 8;
+            }
+            rx->payload_len = frame_header_len(rx->frame);
+            if (rx->payload_len <= 0) {
+                rx_resync(rx);
+                break;
+            }
+            rx->coded_len = FEC_CODED_BYTES(rx->fec, rx->payload_len + FRAME_CRC_BYTES(rx->payload_len));
+            rx->state = RX_PAYLOAD;
+            break;
+
+        case RX_PAYLOAD:
+            if (rx->fec != FEC_NONE) {
+                n = rx->payload_len + FRAME_CRC_BYTES(rx->payload_len);
+                if (avail < (uint32_t)rx->coded_len * 8) {
+                    if (!rx_later_frame(rx))
+                        return 0;
+                    rx_resync(rx);
+                    break;
+                }
+                ring_read(rx, rx->rd, rx->coded, rx->coded_len * 8);
+                rx->rd += (uint32_t)rx->coded_len * 8;
+                k = fec_decode(rx->vit, rx->fec, rx->coded, n, rx->frame + FRAME_HEADER_LEN);
+                if (k < 0) {
+                    rx->fec_stats.failed++;
+                    rx_resync(rx);
+                    break;
+                }
+                rx->fec_stats.rs_fixed += (unsigned long)k;
+                rx->pending_bit_errors += rx_count_bit_errors(rx, rx->fec, rx->frame + FRAME_HEADER_LEN, n,
+                                                              rx->coded);
+                rx->state = RX_CRC;
+                break;
+            }
+            if (avail < (uint32_t)rx->payload_len * 8) {
+                if (!rx_later_frame(rx))
+                    return 0;
+                rx_resync(rx);
+                break;
+            }
+            ring_read(rx, rx->rd, rx->frame + FRAME_HEADER_LEN, rx->payload_len * 8);
+            rx->rd += (uint32_t)rx->payload_len * 8;
+            rx->state = RX_CRC;
+            break;
+
+        case RX_CRC:
+            n = FRAME_CRC_BYTES(rx->payload_len);
+            if (rx->fec == FEC_NONE) {
+                if (avail < (uint32_t)n * 8) {
+                    if (!rx_later_frame(rx))
+                        return 0;
+                    rx_resync(rx);
+                    break;
+                }
+                ring_read(rx, rx->rd, rx->frame + FRAME_HEADER_LEN + rx->payload_len, n * 8);
+                rx->rd += (uint32_t)n * 8;
+            }
+            if (protocol_frame_is_aggregate(rx->frame) || frame_is_arq(rx->frame))
+                n = protocol_decapsulate(rx->frame, FRAME_HEADER_LEN + rx->payload_len + n,
+                                         rx->body, MAX_FRAME_PAYLOAD);
+            else
+                n = protocol_decapsulate(rx->frame, FRAME_HEADER_LEN + rx->payload_len + n,
+                                         payload_out, max_payload);
+            if (n <= 0) {
+                rx_resync(rx);
+                break;
+            }
+            rx->state = RX_HUNT;
+            rx->shreg_bits = 0;
+            rx->frames++;
+            if (rx->rd - rx->frame_start > rx->longest)
+                rx->longest = rx->rd - rx->frame_start;
+            if (rx->fec != FEC_NONE) {
+                rx->fec_stats.frames++;
+                rx->fec_stats.coded_bits += (unsigned long)(FEC_HDR_BYTES + rx->coded_len) * 8;
+                rx->fec_stats.bit_errors += rx->pending_bit_errors;
+            }
+            if (frame_is_control(rx->frame)) {
+                if (!kind)
+                    break;
+                *kind = PROTOCOL_RX_CONTROL;
+                return n;
+            }
+            if (frame_is_arq(rx->frame)) {
+                if (n < ARQ_HDR_BYTES)
+                    break;             /* ARQ 头不完整（CRC 已对，只可能是发送端的错） */
+                if (kind) {
+                    if (n > max_payload)
+                        break;
+                    memcpy(payload_out, rx->body, n);
+                    *kind = PROTOCOL_RX_ARQ;
+                    return n;
+                }
+                rx->agg_len = n;
+                rx->agg_pos = ARQ_HDR_BYTES;
                 break;
+            }
+            if (protocol_frame_is_aggregate(rx->frame)) {
+                rx->agg_len = n;       /* 子包序列在 body 里，回到循环开头拆包 */
+                rx->agg_pos = 0;
+                break;
+            }
+            return n;
         }
-        if (j == SYNC_LEN)
-            return i;
     }
-    return -1;
+}
+
+int protocol_rx_next(protocol_rx_t *rx, uint8_t *payload_out, int max_payload)
+{
+    if (!rx || !payload_out)
+        return 0;
+    return rx_next(rx, payload_out, max_payload, NULL);
+}
+
+int protocol_rx_next_link(protocol_rx_t *rx, uint8_t *payload_out, int max_payload, protocol_rx_kind_t *kind)
+{
+    if (!rx || !payload_out || !kind)
+        return 0;
+    *kind = PROTOCOL_RX_PACKET;
+    return rx_next(rx, payload_out, max_payload, kind);
+}
+
+int protocol_rx_in_frame(const protocol_rx_t *rx)
+{
+    return rx && rx->state != RX_HUNT;
+}
+
+unsigned long protocol_rx_frame_count(const protocol_rx_t *rx)
+{
+    return rx ? rx->frames : 0;
+}
+
+void protocol_rx_destroy(protocol_rx_t *rx)
+{
+    if (!rx) return;
+    fec_viterbi_destroy(rx->vit);
+    free(rx);
 }
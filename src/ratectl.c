@@ -0,0 +1,501 @@
+/**
+ * ratectl.c - 速率自适应实现
+ *
+ * 发送方向：tx_rung 为新帧所用的档，next_rung 与之不同时有一次换档等宣告（宣告用旧档发，发出后才换）；
+ *           tx_epoch 每次换档加 1，只理会回显了当前纪元的对端报告。
+ * 接收方向：rx_rung / rx_epoch 为最近一次宣告；丢帧率在同纪元的两个报告之间算（发帧数之差够 RATECTL_LOSS_FRAMES 才算）：
+ *           1 - 本端收到的帧数 / 对端报告的发帧数之差。
+ */
+
+#include "ratectl.h"
+#include "fec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+/** 报告有效位 */
+#define REPORT_QUALITY  0x01
+#define REPORT_LOSS     0x02
+#define REPORT_STEPPED  0x04
+
+const ratectl_rung_t ratectl_default_ladder[] = {
+    { MODEM_MODE_MFSK16,     FEC_RS_CONV | FEC_INTERLEAVE, 0.0  },
+    { MODEM_MODE_DQPSK,      FEC_CONV | FEC_INTERLEAVE,    2.0  },
+    { MODEM_MODE_DQPSK,      FEC_RS,                       5.0  },
+    { MODEM_MODE_OFDM_DBPSK, FEC_CONV | FEC_INTERLEAVE,    14.0 },
+    { MODEM_MODE_OFDM_DQPSK, FEC_CONV | FEC_INTERLEAVE,    17.0 },
+    { MODEM_MODE_OFDM_DQPSK, FEC_RS,                       19.0 },
+    { MODEM_MODE_OFDM_DQPSK, FEC_NONE,                     24.0 },
+};
+const int ratectl_default_ladder_len = (int)(sizeof(ratectl_default_ladder) / sizeof(ratectl_default_ladder[0]));
+
+/**
+ * 判决域信噪比比信道信噪比（全带宽）高出的 dB 数，按调制方式：单载波 / MFSK 只占一小段带宽，
+ * 判决时滤掉了带外噪声；OFDM 的发送功率比 FSK 低约 6.5 dB、能量又分散在全部子载波上，为负。
+ * 信道信噪比以 FSK 的信号功率为参考（各档之间才可比），在 bench/modem_bench --adapt 的 AWGN 信道上标定。信噪比高到一定程度后
+ * 判决域的值不再跟着涨（码间干扰、量化），换算出的信道信噪比只会偏低，不会偏高
+ */
+static const double g_mode_gain_db[MODEM_MODE_COUNT] = {
+    [MODEM_MODE_FSK]        = 12.0,
+    [MODEM_MODE_CPFSK]      = 12.5,
+    [MODEM_MODE_MSK]        = 10.0,
+    [MODEM_MODE_GMSK]       = 8.0,
+    [MODEM_MODE_MFSK16]     = 18.0,
+    [MODEM_MODE_MFSK32]     = 18.0,
+    [MODEM_MODE_OFDM_DBPSK] = -5.0,
+    [MODEM_MODE_OFDM_DQPSK] = -5.0,
+    [MODEM_MODE_DBPSK]      = 10.8,
+    [MODEM_MODE_DQPSK]      = 10.8,
+};
+
+struct ratectl {
+    pthread_mutex_t lock;
+    ratectl_rung_t rungs[RATECTL_MAX_RUNGS];
+    int count;
+
+    /* 发送方向 */
+    int      tx_rung;
+    int      next_rung;
+    int      announce;        /* 有换档要尽快宣告（旧档宣告完才换），或跟随对端后要在新档宣告 */
+    uint8_t  msg[RATECTL_REPORT_BYTES];  /* 正在连发的一组报告 */
+    int      copies;          /* 这组还要发的份数 */
+    uint32_t group_frames;    /* 上一组报告写出时的发帧数 */
+    int      msg_rung;        /* 这组报告用的档 */
+    uint8_t  tx_epoch;
+    uint32_t tx_frames;       /* 累计发帧数（含报告） */
+    int64_t  next_report_ns;
+    int64_t  last_peer_ns;    /* 最近一次有效报告；换档时也重置，给对端留出回显的时间 */
+    int      good;            /* 连续好报告数 */
+    int64_t  hold_until_ns;   /* 此前不升档 */
+    int64_t  hold_ms;         /* 下次降档后的等待时间 */
+    int64_t  climb_ns;        /* 最近一次升档的时刻，试探期过后清零 */
+    int      have_peer;       /* 已按对端的报告选过档 */
+    uint32_t peer_frames;     /* 那个报告里对端的发帧数：同一组的其余副本不再重复选档 */
+
+    /* 接收方向 */
+    int      rx_rung;
+    uint8_t  rx_epoch;
+    int      rx_stepped;      /* 接收档是静音超时自己降的，还没收到对端的宣告 */
+    int64_t  last_rx_ns;      /* 最近一个 CRC 正确的帧 */
+    int64_t  rx_step_ns;      /* 最近一次静音降档；last_rx_ns 不跟着重置，发送方向还要看 */
+    modem_rx_quality_t q;     /* 自上次发报告以来的解调质量 */
+    int      have_base;       /* 已有同纪元的上一个报告作丢帧率的起点 */
+    uint32_t base_tx;         /* 起点报告里的发帧数 */
+    unsigned long rx_since;   /* 起点报告之后收到的帧数（含当前报告） */
+    int      loss_valid;
+    double   loss;            /* 最近测得的对端 → 本端丢帧率，下一个报告带出 */
+
+    ratectl_stats_t st;
+};
+
+int ratectl_parse_ladder(const char *spec, ratectl_rung_t *rungs)
+{
+    char buf[512], *tok, *save = NULL;
+    int count = 0;
+
+    if (!spec || !rungs || strlen(spec) >= sizeof(buf))
+        return -1;
+    strcpy(buf, spec);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *fec = strchr(tok, ':'), *snr, *end;
+
+        if (!fec || count == RATECTL_MAX_RUNGS) goto bad;
+        *fec++ = '\0';
+        if ((snr = strchr(fec, ':')) != NULL)
+            *snr++ = '\0';
+        if (modem_mode_from_name(tok, &rungs[count].mode) != 0 || fec_mode_from_name(fec, &rungs[count].fec) != 0)
+            goto bad;
+        rungs[count].snr_db = 0.0;
+        if (snr) {
+            rungs[count].snr_db = strtod(snr, &end);
+            if (end == snr || *end) goto bad;
+        }
+        count++;
+    }
+    return count > 0 ? count : -1;
+
+bad:
+    fprintf(stderr, "ratectl: bad rung '%s' in \"%s\"\n", tok ? tok : "", spec);
+    return -1;
+}
+
+ratectl_t *ratectl_create(const ratectl_rung_t *rungs, int count, int64_t now_ns)
+{
+    ratectl_t *rc;
+
+    if (!rungs || count <= 0 || count > RATECTL_MAX_RUNGS)
+        return NULL;
+    rc = (ratectl_t *)calloc(1, sizeof(*rc));
+    if (!rc) return NULL;
+    if (pthread_mutex_init(&rc->lock, NULL) != 0) {
+        free(rc);
+        return NULL;
+    }
+    memcpy(rc->rungs, rungs, (size_t)count * sizeof(*rungs));
+    rc->count = count;
+    rc->next_report_ns = now_ns;
+    rc->last_peer_ns = now_ns;
+    rc->last_rx_ns = now_ns;
+    rc->rx_step_ns = now_ns - (int64_t)RATECTL_SILENCE_MS * 2000000;
+    rc->hold_ms = RATECTL_HOLD_MS;
+    return rc;
+}
+
+void ratectl_destroy(ratectl_t *rc)
+{
+    if (!rc) return;
+    pthread_mutex_destroy(&rc->lock);
+    free(rc);
+}
+
+const ratectl_rung_t *ratectl_rung(const ratectl_t *rc, int i)
+{
+    return (rc && i >= 0 && i < rc->count) ? &rc->rungs[i] : NULL;
+}
+
+int ratectl_tx_rung(ratectl_t *rc)
+{
+    int r;
+
+    pthread_mutex_lock(&rc->lock);
+    r = rc->tx_rung;
+    pthread_mutex_unlock(&rc->lock);
+    return r;
+}
+
+int ratectl_rx_rung(ratectl_t *rc)
+{
+    int r;
+
+    pthread_mutex_lock(&rc->lock);
+    r = rc->rx_rung;
+    pthread_mutex_unlock(&rc->lock);
+    return r;
+}
+
+/**
+ * 发送方向换到 rung 档（调用者持锁）：纪元加 1，尽快发报告宣告
+ * @param now_flag 非 0 时立即换、在新档宣告（跟随对端、静音降档）；否则在旧档宣告、发出后才换
+ */
+static void tx_change(ratectl_t *rc, int rung, int64_t now_ns, int now_flag)
+{
+    if (rung == rc->tx_rung && rung == rc->next_rung)
+        return;
+    rc->tx_epoch++;
+    rc->next_rung = rung;
+    if (now_flag)
+        rc->tx_rung = rung;
+    rc->announce = 1;
+    rc->good = 0;
+    rc->last_peer_ns = now_ns;
+}
+
+/**
+ * 降档或退回前调用（调用者持锁）：升档后试探期内就降下来算试探失败，等待时间加倍；此后 hold_ms 内不升档
+ */
+static void tx_backoff(ratectl_t *rc, int64_t now_ns)
+{
+    if (rc->climb_ns) {
+        rc->climb_ns = 0;
+        rc->hold_ms = rc->hold_ms * 2 < RATECTL_HOLD_MAX_MS ? rc->hold_ms * 2 : RATECTL_HOLD_MAX_MS;
+    }
+    rc->hold_until_ns = now_ns + rc->hold_ms * 1000000;
+}
+
+/** 跟随对端的接收档（调用者持锁）：对端在那一档上听，立即换过去、在新档宣告 */
+static void tx_follow(ratectl_t *rc, int rung, int64_t now_ns)
+{
+    if (rung < rc->tx_rung) {
+        tx_backoff(rc, now_ns);
+        rc->st.steps_down++;
+    } else {
+        rc->st.steps_up++;
+    }
+    tx_change(rc, rung, now_ns, 1);
+}
+
+/** 写出一组报告（调用者持锁）：本端对对端信号的测量，之后测量重新累计 */
+static void tx_build_report(ratectl_t *rc)
+{
+    uint8_t *msg = rc->msg;
+    int16_t snr;
+    uint16_t jitter, loss;
+    uint8_t flags = 0;
+
+    /* 对端信号的测量：符号太少就不带信噪比与抖动 */
+    snr = 0;
+    jitter = 0;
+    if (rc->q.symbols >= RATECTL_MIN_SYMBOLS && rc->q.signal > 0.0) {
+        double db = 10.0 * log10(rc->q.signal / (rc->q.noise + 1e-30))
+                    - g_mode_gain_db[rc->rungs[rc->rx_rung].mode];
+        double j = sqrt(rc->q.timing_sq / rc->q.symbols);
+
+        db = db < -100.0 ? -100.0 : db > 100.0 ? 100.0 : db;
+        snr = (int16_t)lrint(db * 4);
+        jitter = (uint16_t)(j >= 6.5 ? 65000 : lrint(j * 10000));
+        flags |= REPORT_QUALITY;
+    }
+    memset(&rc->q, 0, sizeof(rc->q));
+    if (rc->rx_stepped)
+        flags |= REPORT_STEPPED;
+    loss = 0;
+    if (rc->loss_valid) {
+        loss = (uint16_t)lrint(rc->loss * 10000);
+        flags |= REPORT_LOSS;
+        rc->loss_valid = 0;
+    }
+
+    /*
+     * 宣告、或上一组之后没发过数据帧（报告前后都是静音，孤立帧容易丢）时连发 RATECTL_REPORT_COPIES 份，
+     * 夹在数据帧中间的例行报告发一份就够。整组一次计入发帧数：对端收到其中任何一个都以同一个发帧数为丢帧率的起点
+     */
+    rc->copies = (rc->announce || rc->tx_frames == rc->group_frames) ? RATECTL_REPORT_COPIES : 1;
+    rc->tx_frames += rc->copies;
+    rc->group_frames = rc->tx_frames;
+    msg[0]  = RATECTL_MSG_REPORT;
+    msg[1]  = (uint8_t)rc->next_rung;
+    msg[2]  = rc->tx_epoch;
+    msg[3]  = (uint8_t)rc->rx_rung;
+    msg[4]  = rc->rx_epoch;
+    msg[5]  = (uint8_t)(rc->tx_frames >> 24);
+    msg[6]  = (uint8_t)(rc->tx_frames >> 16);
+    msg[7]  = (uint8_t)(rc->tx_frames >> 8);
+    msg[8]  = (uint8_t)rc->tx_frames;
+    msg[9]  = flags;
+    msg[10] = (uint8_t)((uint16_t)snr >> 8);
+    msg[11] = (uint8_t)snr;
+    msg[12] = (uint8_t)(jitter >> 8);
+    msg[13] = (uint8_t)jitter;
+    msg[14] = (uint8_t)(loss >> 8);
+    msg[15] = (uint8_t)loss;
+    rc->msg_rung = rc->tx_rung;
+    rc->announce = 0;
+}
+
+int ratectl_tx_poll(ratectl_t *rc, int64_t now_ns, uint8_t *msg, int *rung)
+{
+    if (!rc || !msg || !rung)
+        return 0;
+    pthread_mutex_lock(&rc->lock);
+    if ((rc->tx_rung != 0 || rc->next_rung != 0)
+        && now_ns - rc->last_peer_ns >= (int64_t)RATECTL_SILENCE_MS * 2000000
+        && now_ns - rc->last_rx_ns >= (int64_t)RATECTL_SILENCE_MS * 2000000) {
+        /*
+         * 对端的帧一个也收不到（收得到时对端的报告会带来它自己降的接收档，跟随即可）：降一档、在新档宣告。
+         * 两端都收不到时接收档在 1、3、5… 倍 RATECTL_SILENCE_MS 降，发送档在 2、4… 倍降，
+         * 每次发送档降完两端的收发档又对齐
+         */
+        tx_backoff(rc, now_ns);
+        tx_change(rc, rc->tx_rung > 0 ? rc->tx_rung - 1 : 0, now_ns, 1);
+        rc->st.fallbacks++;
+    }
+    if (!rc->copies) {
+        if (!rc->announce && now_ns < rc->next_report_ns) {
+            pthread_mutex_unlock(&rc->lock);
+            return 0;
+        }
+        tx_build_report(rc);
+        rc->next_report_ns = now_ns + (int64_t)RATECTL_REPORT_MS * 1000000;
+    }
+
+    memcpy(msg, rc->msg, RATECTL_REPORT_BYTES);
+    *rung = rc->msg_rung;
+    /* 一组发完才换到宣告的档；组中间又换过档（纪元变了）时由那次换档自己宣告 */
+    if (--rc->copies == 0 && rc->msg[2] == rc->tx_epoch)
+        rc->tx_rung = rc->next_rung;
+    rc->st.reports_tx++;
+    pthread_mutex_unlock(&rc->lock);
+    return RATECTL_REPORT_BYTES;
+}
+
+void ratectl_tx_frame(ratectl_t *rc)
+{
+    if (!rc) return;
+    pthread_mutex_lock(&rc->lock);
+    rc->tx_frames++;
+    pthread_mutex_unlock(&rc->lock);
+}
+
+void ratectl_rx_frames(ratectl_t *rc, unsigned long n, int64_t now_ns)
+{
+    if (!rc || n == 0) return;
+    pthread_mutex_lock(&rc->lock);
+    rc->rx_since += n;
+    rc->last_rx_ns = now_ns;
+    pthread_mutex_unlock(&rc->lock);
+}
+
+void ratectl_rx_quality(ratectl_t *rc, const modem_rx_quality_t *q)
+{
+    if (!rc || !q) return;
+    pthread_mutex_lock(&rc->lock);
+    rc->q.symbols   += q->symbols;
+    rc->q.signal    += q->signal;
+    rc->q.noise     += q->noise;
+    rc->q.timing_sq += q->timing_sq;
+    pthread_mutex_unlock(&rc->lock);
+}
+
+/** 接收方向重新开始测量（调用者持锁）：换档后旧档的质量与丢帧计数都作废 */
+static void rx_restart(ratectl_t *rc, uint32_t base_tx)
+{
+    memset(&rc->q, 0, sizeof(rc->q));
+    rc->have_base = 1;
+    rc->base_tx = base_tx;
+    rc->rx_since = 0;
+    rc->loss_valid = 0;
+}
+
+/**
+ * 按对端对本端信号的测量选发送档（调用者持锁）
+ * 降档：丢帧多、抖动大或信噪比低于本档门限减回差；有信噪比时直接降到够得着的最高档。
+ * 升档：连续 RATECTL_UP_REPORTS 个报告信噪比够下一档门限、抖动小、几乎不丢帧，且过了等待期
+ */
+static void tx_evaluate(ratectl_t *rc, int flags, double snr, double jitter, double loss, int64_t now_ns)
+{
+    int cur = rc->tx_rung, target, bad, good;
+
+    if (rc->climb_ns && now_ns - rc->climb_ns >= (int64_t)RATECTL_PROBE_MS * 1000000) {
+        rc->climb_ns = 0;              /* 升档站住了 */
+        rc->hold_ms = RATECTL_HOLD_MS;
+    }
+
+    bad = ((flags & REPORT_LOSS) && loss > RATECTL_LOSS_DOWN)
+          || ((flags & REPORT_QUALITY)
+              && (jitter > RATECTL_JITTER_MAX || (cur > 0 && snr < rc->rungs[cur].snr_db - RATECTL_HYST_DB)));
+    if (bad) {
+        rc->good = 0;
+        if (cur == 0)
+            return;
+        target = cur - 1;
+        if ((flags & REPORT_QUALITY) && jitter <= RATECTL_JITTER_MAX)
+            while (target > 0 && snr < rc->rungs[target].snr_db - RATECTL_HYST_DB)
+                target--;
+        tx_backoff(rc, now_ns);
+        rc->st.steps_down++;
+        tx_change(rc, target, now_ns, 0);
+        return;
+    }
+
+    good = cur + 1 < rc->count && (flags & REPORT_QUALITY) && snr >= rc->rungs[cur + 1].snr_db
+           && (!(flags & REPORT_LOSS) || loss <= RATECTL_LOSS_UP);
+    if (!good) {
+        rc->good = 0;
+        return;
+    }
+    if (++rc->good >= RATECTL_UP_REPORTS && now_ns >= rc->hold_until_ns) {
+        rc->climb_ns = now_ns;
+        rc->st.steps_up++;
+        tx_change(rc, cur + 1, now_ns, 0);
+    }
+}
+
+int ratectl_rx_report(ratectl_t *rc, const uint8_t *msg, int len, int64_t now_ns)
+{
+    int tx_rung, rx_rung, flags, changed = 0;
+    uint8_t tx_epoch, rx_epoch;
+    uint32_t tx_frames;
+    double snr, jitter, loss;
+
+    if (!rc || !msg || len < RATECTL_REPORT_BYTES || msg[0] != RATECTL_MSG_REPORT)
+        return -1;
+    tx_rung   = msg[1];
+    tx_epoch  = msg[2];
+    rx_rung   = msg[3];
+    rx_epoch  = msg[4];
+    tx_frames = (uint32_t)msg[5] << 24 | (uint32_t)msg[6] << 16 | (uint32_t)msg[7] << 8 | msg[8];
+    flags     = msg[9];
+    snr       = (int16_t)(msg[10] << 8 | msg[11]) / 4.0;
+    jitter    = (msg[12] << 8 | msg[13]) / 10000.0;
+    loss      = (msg[14] << 8 | msg[15]) / 10000.0;
+    if (tx_rung >= rc->count || rx_rung >= rc->count)
+        return -1;                     /* 两端档位表不一致 */
+
+    pthread_mutex_lock(&rc->lock);
+    rc->st.reports_rx++;
+    rc->last_rx_ns = now_ns;
+
+    /* 接收方向：宣告换档（或纪元变了）就从这个报告起重新测量，否则算这一段的丢帧率 */
+    if (tx_rung != rc->rx_rung || tx_epoch != rc->rx_epoch || !rc->have_base) {
+        changed = tx_rung != rc->rx_rung;
+        rc->rx_rung = tx_rung;
+        rc->rx_epoch = tx_epoch;
+        rc->rx_stepped = 0;
+        rx_restart(rc, tx_frames);
+    } else {
+        uint32_t sent = tx_frames - rc->base_tx;
+
+        if (sent >= 0x80000000u) {
+            rx_restart(rc, tx_frames);
+        } else if (sent >= RATECTL_LOSS_FRAMES) {
+            double l = 1.0 - (double)rc->rx_since / sent;
+
+            rc->loss = l < 0.0 ? 0.0 : l;
+            rc->loss_valid = 1;
+            rc->base_tx = tx_frames;
+            rc->rx_since = 0;
+        }
+    }
+
+    /*
+     * 发送方向：对端的接收档是它静音超时自己降的，就跟到那一档（不论纪元：对端没见到本端的宣告才会降，
+     * 本端后来又降了档时它可能比本端还高）；其余只理会回显了当前纪元、且没有换档在等宣告时的报告，
+     * 同一组的其余副本只算收到
+     */
+    if ((flags & REPORT_STEPPED) && rx_rung != rc->tx_rung) {
+        tx_follow(rc, rx_rung, now_ns);
+    } else if (rx_epoch == rc->tx_epoch && rc->next_rung == rc->tx_rung
+        && !(rc->have_peer && tx_frames == rc->peer_frames)) {
+        rc->last_peer_ns = now_ns;
+        rc->have_peer = 1;
+        rc->peer_frames = tx_frames;
+        rc->st.peer_valid |= flags & (REPORT_QUALITY | REPORT_LOSS);
+        if (flags & REPORT_QUALITY) {
+            rc->st.peer_snr_db = snr;
+            rc->st.peer_jitter = jitter;
+        }
+        if (flags & REPORT_LOSS)
+            rc->st.peer_loss = loss;
+        if (rx_rung != rc->tx_rung)
+            tx_follow(rc, rx_rung, now_ns);    /* 对端已在别的档上听 */
+        else
+            tx_evaluate(rc, flags, snr, jitter, loss, now_ns);
+    }
+    pthread_mutex_unlock(&rc->lock);
+    return changed;
+}
+
+int ratectl_rx_poll(ratectl_t *rc, int64_t now_ns)
+{
+    int changed = 0;
+
+    if (!rc) return 0;
+    pthread_mutex_lock(&rc->lock);
+    if (now_ns - rc->last_rx_ns >= (int64_t)RATECTL_SILENCE_MS * 1000000
+        && now_ns - rc->rx_step_ns >= (int64_t)RATECTL_SILENCE_MS * 2000000) {
+        rc->rx_step_ns = now_ns;
+        if (rc->rx_rung != 0) {
+            rc->rx_rung--;                     /* 还收不到就隔 2 倍时长再降 */
+            rc->rx_stepped = 1;
+            rc->have_base = 0;
+            memset(&rc->q, 0, sizeof(rc->q));
+            rc->loss_valid = 0;
+            rc->st.fallbacks++;
+            changed = 1;
+        }
+    }
+    pthread_mutex_unlock(&rc->lock);
+    return changed;
+}
+
+void ratectl_get_stats(ratectl_t *rc, ratectl_stats_t *st)
+{
+    if (!rc || !st) return;
+    pthread_mutex_lock(&rc->lock);
+    *st = rc->st;
+    st->tx_rung = rc->tx_rung;
+    st->rx_rung = rc->rx_rung;
+    pthread_mutex_unlock(&rc->lock);
+}
@@ -0,0 +1,95 @@
+/**
+ * sample_ring.c - 单生产者单消费者无锁采样环
+ *
+ * head / tail 为累计采样数（回绕后相减仍正确），只靠 C11 原子变量的 acquire / release；
+ * 两者分在不同缓存行，避免读写两个线程互相踢缓存行。
+ */
+
+#include "sample_ring.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct sample_ring {
+    _Atomic size_t head;                  /* 写端：已写入 */
+    char pad0[64 - sizeof(size_t)];
+    _Atomic size_t tail;                  /* 读端：已读出 */
+    char pad1[64 - sizeof(size_t)];
+    size_t size;                          /* 容量，2 的幂 */
+    size_t mask;
+    sample_t *buf;
+};
+
+sample_ring_t *sample_ring_create(size_t min_samples)
+{
+    sample_ring_t *r;
+    size_t size = 1;
+
+    while (size < min_samples)
+        size <<= 1;
+    r = (sample_ring_t *)calloc(1, sizeof(sample_ring_t));
+    if (!r) return NULL;
+    r->buf = (sample_t *)calloc(size, sizeof(sample_t));
+    if (!r->buf) {
+        free(r);
+        return NULL;
+    }
+    r->size = size;
+    r->mask = size - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return r;
+}
+
+void sample_ring_destroy(sample_ring_t *r)
+{
+    if (!r) return;
+    free(r->buf);
+    free(r);
+}
+
+size_t sample_ring_capacity(const sample_ring_t *r)
+{
+    return r->size;
+}
+
+size_t sample_ring_readable(const sample_ring_t *r)
+{
+    return atomic_load_explicit(&((sample_ring_t *)r)->head, memory_order_acquire)
+         - atomic_load_explicit(&((sample_ring_t *)r)->tail, memory_order_relaxed);
+}
+
+size_t sample_ring_writable(const sample_ring_t *r)
+{
+    return r->size - (atomic_load_explicit(&((sample_ring_t *)r)->head, memory_order_relaxed)
+                      - atomic_load_explicit(&((sample_ring_t *)r)->tail, memory_order_acquire));
+}
+
+size_t sample_ring_write(sample_ring_t *r, const sample_t *src, size_t n)
+{
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t space = r->size - (head - atomic_load_explicit(&r->tail, memory_order_acquire));
+    size_t off = head & r->mask, first;
+
+    if (n > space) n = space;
+    /* 分两段拷贝（可能跨环尾） */
+    first = r->size - off < n ? r->size - off : n;
+    memcpy(r->buf + off, src, first * sizeof(sample_t));
+    memcpy(r->buf, src + first, (n - first) * sizeof(sample_t));
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+    return n;
+}
+
+size_t sample_ring_read(sample_ring_t *r, sample_t *dst, size_t n)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t avail = atomic_load_explicit(&r->head, memory_order_acquire) - tail;
+    size_t off = tail & r->mask, first;
+
+    if (n > avail) n = avail;
+    first = r->size - off < n ? r->size - off : n;
+    memcpy(dst, r->buf + off, first * sizeof(sample_t));
+    memcpy(dst + first, r->buf, (n - first) * sizeof(sample_t));
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
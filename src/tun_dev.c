@@ -48,6 +48,31 @@ int tun_open(const char *name)
     return fd;
 }
 
+/** 接口的 MTU 只能经套接字 ioctl 设置，TUN 描述符本身不行 */
+int tun_set_mtu(const char *name, int mtu)
+{
+    int sock;
+    struct ifreq ifr;
+
+    if (!name || !name[0] || mtu <= 0)
+        return -1;
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("tun_set_mtu: socket");
+        return -1;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+    ifr.ifr_mtu = mtu;
+    if (ioctl(sock, SIOCSIFMTU, &ifr) < 0) {
+        perror("tun_set_mtu: ioctl SIOCSIFMTU");
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    return 0;
+}
+
 int tun_read(int fd, uint8_t *buf, int maxlen)
 {
     ssize_t n;
@@ -9,11 +9,12 @@
 
 /**
  * 帧转比特流
- * @param frame    帧数据
+ * 比特流约定（高位先发，见 include/bitstream.h）下帧字节本身就是比特流，不做拷贝，直接返回 frame
+ * @param frame     帧数据
  * @param frame_len 帧字节数
- * @param bits_out 输出比特流（按字节存，每字节 8 比特）
  * @param nbits_out 输出总比特数（= frame_len * 8）
+ * @return          比特流（即 frame，按字节存，每字节 8 比特）
  */
-void frame_to_bits(const uint8_t *frame, int frame_len, uint8_t *bits_out, int *nbits_out);
+const uint8_t *frame_to_bits(const uint8_t *frame, int frame_len, int *nbits_out);
 
 #endif /* FRAME_TO_BITS_H */
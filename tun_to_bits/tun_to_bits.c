@@ -137,7 +137,7 @@ static int run_encapsulate(void)
 static int run_to_bits(void)
 {
     uint8_t frame_buf[MAX_FRAME_LEN];
-    uint8_t bits_buf[MAX_FRAME_LEN + 1];
+    const uint8_t *bits;
     FILE *fp;
     int frame_len, nbits;
 
@@ -153,14 +153,14 @@ static int run_to_bits(void)
         return -1;
     }
 
-    frame_to_bits(frame_buf, frame_len, bits_buf, &nbits);
+    bits = frame_to_bits(frame_buf, frame_len, &nbits);
 
     fp = fopen(BITS_OUT_PATH, "wb");
     if (!fp) {
         fprintf(stderr, "Cannot write %s\n", BITS_OUT_PATH);
         return -1;
     }
-    fwrite(bits_buf, 1, (size_t)((nbits + 7) / 8), fp);
+    fwrite(bits, 1, (size_t)((nbits + 7) / 8), fp);
     fclose(fp);
 
     printf("Convert frame to bits successfully: Frame %d bytes -> %d bits -> %s\n", frame_len, nbits, BITS_OUT_PATH);
@@ -172,7 +172,7 @@ static int run_test(void)
 {
     uint8_t ip_buf[MAX_FRAME_PAYLOAD];
     uint8_t frame_buf[MAX_FRAME_LEN];
-    uint8_t bits_buf[MAX_FRAME_LEN + 1];
+    const uint8_t *bits;
     int ip_len, frame_len, nbits;
     FILE *fp;
 
@@ -202,7 +202,7 @@ static int run_test(void)
         return -1;
     }
 
-    frame_to_bits(frame_buf, frame_len, bits_buf, &nbits);
+    bits = frame_to_bits(frame_buf, frame_len, &nbits);
 
     printf("\n========== Frame result (Frame) ==========\n");
     print_hex("Frame (hex)", frame_buf, frame_len);
@@ -211,7 +211,7 @@ static int run_test(void)
     {
         int show = (nbits + 7) / 8;
         if (show > 64) show = 64;
-        print_hex("Bits (hex)", bits_buf, show);
+        print_hex("Bits (hex)", bits, show);
         if ((nbits + 7) / 8 > 64)
             printf("... (total %d bytes, %d bits)\n", (nbits + 7) / 8, nbits);
     }
@@ -230,7 +230,7 @@ static int run_test(void)
     }
     fp = fopen(BITS_OUT_PATH, "wb");
     if (fp) {
-        fwrite(bits_buf, 1, (size_t)((nbits + 7) / 8), fp);
+        fwrite(bits, 1, (size_t)((nbits + 7) / 8), fp);
         fclose(fp);
         printf("Wrote bits to %s\n", BITS_OUT_PATH);
     }
@@ -244,7 +244,7 @@ static int run_full(int argc, char *argv[])
 {
     uint8_t ip_buf[MAX_FRAME_PAYLOAD];
     uint8_t frame_buf[MAX_FRAME_LEN];
-    uint8_t bits_buf[MAX_FRAME_LEN + 1];
+    const uint8_t *bits;
     int tun_fd, ip_len, frame_len, nbits;
     const char *tun_name = (argc >= 2) ? argv[1] : TUN_DEV_NAME;
 
@@ -269,7 +269,7 @@ static int run_full(int argc, char *argv[])
         return 1;
     }
 
-    frame_to_bits(frame_buf, frame_len, bits_buf, &nbits);
+    bits = frame_to_bits(frame_buf, frame_len, &nbits);
 
     printf("\n========== 帧结果 (Frame) ==========\n");
     print_hex("Frame (hex)", frame_buf, frame_len);
@@ -278,7 +278,7 @@ static int run_full(int argc, char *argv[])
     {
         int show = (nbits + 7) / 8;
         if (show > 64) show = 64;
-        print_hex("Bits (hex)", bits_buf, show);
+        print_hex("Bits (hex)", bits, show);
         if ((nbits + 7) / 8 > 64)
             printf("... (total %d bytes)\n", (nbits + 7) / 8);
     }
@@ -1,9 +1,10 @@
 /**
- * bits_to_wav.c - 比特流 → FSK 调制 → WAV 文件
+ * bits_to_wav.c - 比特流 → 调制 → WAV 文件
  *
  * 用法：
- *   bits_to_wav <input.bin> <output.wav>  从文件读比特流，调制后写 WAV
- *   bits_to_wav --test                    内置测试：生成短比特流，写入 output/test.wav
+ *   bits_to_wav [--mode M] <input.bin> <output.wav>  从文件读比特流，调制后写 WAV
+ *   bits_to_wav [--mode M] --test                    内置测试：生成短比特流，写入 output/test.wav
+ * M 为调制方式名（cpfsk 默认，另有 fsk、msk、gmsk、dbpsk、dqpsk、mfsk16、mfsk32、ofdm-dbpsk、ofdm-dqpsk）
  *
  * 比特流文件格式：原始字节，每字节 8 比特，高位先发（与 modem 约定一致）。
  */
@@ -30,8 +31,8 @@ static int read_bits_from_file(const char *path, uint8_t *bits_out, int max_byte
     return 0;
 }
 
-/** 内置测试：写入较长比特流，调制后写 output/test.wav */
-static int run_test(void)
+/** 内置测试：写入较长比特流，按 mode 调制后写 output/test.wav */
+static int run_test(modem_mode_t mode)
 {
 #define TEST_BITS_BUF_SIZE  1024
     uint8_t bits_buf[TEST_BITS_BUF_SIZE];
@@ -61,13 +62,14 @@ static int run_test(void)
     }
     nbits = TEST_BITS_BUF_SIZE * 8;
 
-    mod_tx = modem_tx_create();
-    if (!mod_tx) {
+    mod_tx = modem_tx_create(NULL);
+    if (!mod_tx || modem_tx_set_mode(mod_tx, mode) != 0) {
+        if (mod_tx) modem_tx_destroy(mod_tx);
         fprintf(stderr, "modem_tx_create failed\n");
         return -1;
     }
 
-    max_samples = (size_t)nbits * SAMPLES_PER_BIT;
+    max_samples = (size_t)modem_tx_max_samples(mod_tx, nbits);
     samples_buf = (sample_t *)malloc(max_samples * sizeof(sample_t));
     if (!samples_buf) {
         modem_tx_destroy(mod_tx);
@@ -101,14 +103,26 @@ int main(int argc, char *argv[])
     modem_tx_handle_t mod_tx;
     int nbits = 0, nsamples, max_bytes;
     size_t max_samples;
+    modem_mode_t mode = MODEM_MODE_CPFSK;
+    const char *prog = argv[0];
+
+    /* 可选的 --mode 放在最前面，其后参数与原用法相同 */
+    if (argc >= 3 && strcmp(argv[1], "--mode") == 0) {
+        if (modem_mode_from_name(argv[2], &mode) != 0) {
+            fprintf(stderr, "Unknown modem mode: %s\n", argv[2]);
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
 
     if (argc >= 2 && (strcmp(argv[1], "--test") == 0 || strcmp(argv[1], "-t") == 0)) {
-        return run_test() == 0 ? 0 : 1;
+        return run_test(mode) == 0 ? 0 : 1;
     }
 
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <input.bin> <output.wav>\n", argv[0]);
-        fprintf(stderr, "   or: %s --test\n", argv[0]);
+        fprintf(stderr, "Usage: %s [--mode M] <input.bin> <output.wav>\n", prog);
+        fprintf(stderr, "   or: %s [--mode M] --test\n", prog);
         return 1;
     }
 
@@ -125,14 +139,15 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    mod_tx = modem_tx_create();
-    if (!mod_tx) {
+    mod_tx = modem_tx_create(NULL);
+    if (!mod_tx || modem_tx_set_mode(mod_tx, mode) != 0) {
+        if (mod_tx) modem_tx_destroy(mod_tx);
         free(bits_buf);
         fprintf(stderr, "modem_tx_create failed\n");
         return 1;
     }
 
-    max_samples = (size_t)nbits * SAMPLES_PER_BIT;
+    max_samples = (size_t)modem_tx_max_samples(mod_tx, nbits);
     samples_buf = (sample_t *)malloc(max_samples * sizeof(sample_t));
     if (!samples_buf) {
         modem_tx_destroy(mod_tx);